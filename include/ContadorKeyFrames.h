@@ -0,0 +1,79 @@
+/*
+ * ContadorKeyFrames.h
+ *
+ *  Created on: 17 oct. 2026
+ *      Author: alejandro
+ */
+
+#ifndef INCLUDE_CONTADORKEYFRAMES_H_
+#define INCLUDE_CONTADORKEYFRAMES_H_
+
+#include <vector>
+#include "KeyFrame.h"
+
+namespace ORB_SLAM2{
+
+/**
+ * Contador de votos por keyframe, en arreglos planos indexados por KeyFrame::mnId.
+ *
+ * Reemplaza a los map<KeyFrame*,int> que Tracking::UpdateLocalKeyFrames y KeyFrame::UpdateConnections
+ * construían en cada invocación, con una inserción en el árbol por cada observación.
+ *
+ * Cada casillero tiene un sello de época.  Iniciar comienza una época nueva, lo que invalida todos los casilleros
+ * sin recorrerlos: un casillero con sello viejo vale cero.
+ * Los arreglos crecen con el mayor mnId visto y se reutilizan, de modo que contar no asigna memoria.
+ *
+ * No es thread safe: cada hilo debe usar su propia instancia.
+ */
+class ContadorKeyFrames{
+public:
+	/** Comienza una cuenta nueva, con todos los contadores en cero.*/
+	void Iniciar();
+
+	/**
+	 * Suma un voto al keyframe.
+	 * @param pKF Keyframe votado.
+	 */
+	void Incrementar(KeyFrame *pKF){
+		const long unsigned int id = pKF->mnId;
+		if(id >= mvEpoca.size()){
+			mvEpoca.resize(id+1, 0);
+			mvContador.resize(id+1, 0);
+		}
+		if(mvEpoca[id] != mnEpoca){
+			mvEpoca[id] = mnEpoca;
+			mvContador[id] = 0;
+			mvpKeyFrames.push_back(pKF);
+		}
+		mvContador[id]++;
+	}
+
+	/** Votos del keyframe en la cuenta actual.*/
+	int Valor(const KeyFrame *pKF) const{
+		const long unsigned int id = pKF->mnId;
+		return (id < mvEpoca.size() && mvEpoca[id] == mnEpoca)? mvContador[id] : 0;
+	}
+
+	/** Keyframes con al menos un voto, en el orden en que recibieron el primero.*/
+	const std::vector<KeyFrame*> &KeyFrames() const {return mvpKeyFrames;}
+
+	/** Indica si ningún keyframe recibió votos.*/
+	bool empty() const {return mvpKeyFrames.empty();}
+
+protected:
+	/** Votos por mnId.  Válido sólo si el sello de mvEpoca coincide con mnEpoca.*/
+	std::vector<int> mvContador;
+
+	/** Sello de época de cada casillero.*/
+	std::vector<unsigned int> mvEpoca;
+
+	/** Época actual.  0 se reserva para casilleros nunca usados.*/
+	unsigned int mnEpoca = 0;
+
+	/** Keyframes votados en la época actual.*/
+	std::vector<KeyFrame*> mvpKeyFrames;
+};
+
+}// namespace ORB_SLAM2
+
+#endif /* INCLUDE_CONTADORKEYFRAMES_H_ */
@@ -0,0 +1,122 @@
+/*
+ * ControlPresupuesto.h
+ *
+ *  Created on: 17 oct. 2026
+ *      Author: alejandro
+ */
+
+#ifndef INCLUDE_CONTROLPRESUPUESTO_H_
+#define INCLUDE_CONTROLPRESUPUESTO_H_
+
+namespace ORB_SLAM2{
+
+/**
+ * Controlador de lazo cerrado del presupuesto de extracción, para respetar un plazo por cuadro.
+ *
+ * ORBextractor.nFeatures y ORBextractor.nLevels se fijan al inicio.
+ * Cuando LocalMapping compite por los núcleos, el tiempo por cuadro crece y en los flujos en tiempo real (CAM, VIDEO_RT)
+ * el tracking se atrasa y pierde cuadros.
+ *
+ * Tracking informa con Registrar el tiempo medido de cada cuadro y la cantidad de inliers,
+ * y el controlador decide para el cuadro siguiente:
+ * - la cantidad de puntos singulares a extraer (Features),
+ * - la cantidad de niveles de la pirámide en los que se detectan (Niveles),
+ * - un factor para los radios de búsqueda por proyección (FactorRadio).
+ *
+ * La calidad del tracking tiene prioridad sobre el plazo:
+ * con pocos inliers o tracking perdido se vuelve al presupuesto configurado.
+ * Excedido el plazo se reducen primero los puntos singulares, hasta un mínimo, y luego los niveles.
+ * Con holgura se recuperan en orden inverso.
+ *
+ * El tiempo se suaviza con un promedio exponencial, para no reaccionar a cuadros aislados.
+ *
+ * Inactivo (plazo 0) devuelve siempre el presupuesto configurado y factor 1.
+ */
+class ControlPresupuesto{
+public:
+	/** Última decisión del controlador.*/
+	enum Decision {MANTENER=0, REDUCIR, AUMENTAR, RECUPERAR_CALIDAD};
+
+	/**
+	 * Telemetría: mediciones y decisiones del último cuadro.
+	 * Se muestra en la barra de FrameDrawer.
+	 */
+	struct Telemetria{
+		/** Indica si el controlador está activo.*/
+		bool activo = false;
+
+		/** Plazo por cuadro, en milisegundos.*/
+		float plazo = 0;
+
+		/** Tiempo medido del último cuadro, en milisegundos.*/
+		float tiempo = 0;
+
+		/** Tiempo suavizado, en milisegundos.*/
+		float tiempoSuavizado = 0;
+
+		/** Inliers del último cuadro.*/
+		int inliers = 0;
+
+		/** Puntos singulares a extraer en el cuadro siguiente.*/
+		int features = 0;
+
+		/** Niveles de la pirámide a usar en el cuadro siguiente.*/
+		int niveles = 0;
+
+		/** Factor de los radios de búsqueda.*/
+		float factorRadio = 1;
+
+		/** Decisión tomada.*/
+		Decision decision = MANTENER;
+	};
+
+	/**
+	 * Configura el controlador.
+	 *
+	 * @param plazo Plazo por cuadro en milisegundos.  0 desactiva el controlador.
+	 * @param nFeatures Presupuesto configurado de puntos singulares, el máximo.
+	 * @param nNiveles Niveles configurados de la pirámide, el máximo.
+	 */
+	void Configurar(const float plazo, const int nFeatures, const int nNiveles);
+
+	/** Indica si el controlador está activo.*/
+	bool Activo() const {return mTelemetria.activo;}
+
+	/**
+	 * Registra las mediciones de un cuadro y decide el presupuesto del siguiente.
+	 *
+	 * @param tiempo Tiempo del cuadro, en milisegundos.
+	 * @param inliers Puntos del mapa rastreados como inliers.
+	 * @param trackingOk Indica si el estado de Tracking es OK.
+	 */
+	void Registrar(const float tiempo, const int inliers, const bool trackingOk);
+
+	/** Puntos singulares a extraer.*/
+	int Features() const {return mTelemetria.features;}
+
+	/** Niveles de la pirámide a usar.*/
+	int Niveles() const {return mTelemetria.niveles;}
+
+	/** Factor a aplicar a los radios de búsqueda por proyección.*/
+	float FactorRadio() const {return mTelemetria.factorRadio;}
+
+	/** Telemetría del último cuadro.*/
+	const Telemetria &GetTelemetria() const {return mTelemetria;}
+
+protected:
+	/** Presupuesto configurado.*/
+	int mnFeaturesMax = 0, mnNivelesMax = 0;
+
+	/** Mínimos a los que puede reducir.*/
+	int mnFeaturesMin = 0, mnNivelesMin = 0;
+
+	/** Indica si aún no se registró ningún cuadro, para iniciar el promedio.*/
+	bool mbPrimero = true;
+
+	/** Estado y decisiones.*/
+	Telemetria mTelemetria;
+};
+
+}// namespace ORB_SLAM2
+
+#endif /* INCLUDE_CONTROLPRESUPUESTO_H_ */
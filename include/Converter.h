@@ -22,6 +22,8 @@
 #define CONVERTER_H
 
 #include<opencv2/core/core.hpp>
+#include"Descriptores.h"
+#include"SE3f.h"
 
 #include<eigen3/Eigen/Dense>	//#include<eigen3/Eigen/Dense>
 #include"../Thirdparty/g2o/g2o/types/types_six_dof_expmap.h"	//#include "../Thirdparty/g2o/g2o/types/types_six_dof_expmap.h"
@@ -43,6 +45,12 @@ public:
 	/** Convierte una matriz Mat de descriptores en un vector de descriptores Mat.*/
     static std::vector<cv::Mat> toDescriptorVector(const cv::Mat &Descriptors);
 
+    /**
+     * Convierte un buffer de descriptores en un vector de descriptores Mat, como los espera DBoW2.
+     * Cada Mat es una vista sobre el buffer, sin copiar datos.
+     */
+    static std::vector<cv::Mat> toDescriptorVector(const ORB_SLAM2::Descriptores &Descriptors);
+
     /** Convierte un Mat a SE3Quat.*/
     static g2o::SE3Quat toSE3Quat(const cv::Mat &cvT);
 
@@ -76,6 +84,21 @@ public:
     /** Convierte Mat a Eigen.*/
     static Eigen::Matrix<double,3,3> toMatrix3d(const cv::Mat &cvMat3);
 
+    /** Convierte un vector 3D de Eigen float a Mat.*/
+    static cv::Mat toCvMat(const Eigen::Vector3f &v);
+
+    /** Convierte una matriz 3x3 de Eigen float a Mat.*/
+    static cv::Mat toCvMat(const Eigen::Matrix3f &m);
+
+    /** Convierte una pose SE3f a Mat de 4x4.*/
+    static cv::Mat toCvMat(const SE3f &T);
+
+    /** Convierte un vector 3D de Mat a Eigen float.*/
+    static Eigen::Vector3f toVector3f(const cv::Mat &cvVector);
+
+    /** Convierte una pose Mat de 4x4 (o 3x4) a SE3f.*/
+    static SE3f toSE3f(const cv::Mat &cvT);
+
     /** Convierte Mat a vector.*/
     static std::vector<float> toQuaternion(const cv::Mat &M);
 };
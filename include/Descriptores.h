@@ -0,0 +1,121 @@
+/*
+ * Descriptores.h
+ *
+ *  Created on: 17 oct. 2026
+ *      Author: alejandro
+ */
+
+#ifndef INCLUDE_DESCRIPTORES_H_
+#define INCLUDE_DESCRIPTORES_H_
+
+#include <opencv2/core/core.hpp>
+#include <cstring>
+
+namespace ORB_SLAM2{
+
+/**
+ * Descriptor ORB de 256 bits.
+ *
+ * Es un valor: se copia con una simple asignación de 32 bytes, sin reservar memoria.
+ * Usado en MapPoint::mDescriptor.
+ *
+ * No se declara alignas(32) porque en C++11 new no respeta alineaciones mayores a 16 bytes,
+ * y MapPoint se crea con new.  Los núcleos de ORBmatcher usan cargas no alineadas.
+ */
+struct Descriptor{
+	/** Tamaño en bytes de un descriptor ORB.*/
+	static const int BYTES = 32;
+
+	/** Bits del descriptor.*/
+	uchar datos[BYTES];
+
+	/** Descriptor en cero.*/
+	Descriptor(){memset(datos, 0, BYTES);}
+
+	/** Copia el descriptor apuntado.*/
+	explicit Descriptor(const uchar *p){memcpy(datos, p, BYTES);}
+
+	/**
+	 * Conversión desde cv::Mat de una fila por 32 columnas CV_8U.
+	 * Usado sólo en los bordes, como Osmap.
+	 */
+	explicit Descriptor(const cv::Mat &m);
+
+	const uchar* ptr() const {return datos;}
+	uchar* ptr() {return datos;}
+
+	/**
+	 * Vista cv::Mat de 1x32 sobre los datos, sin copiarlos.
+	 * Usado sólo en los bordes, como Osmap.
+	 */
+	cv::Mat toMat() const {return cv::Mat(1, BYTES, CV_8U, const_cast<uchar*>(datos));}
+};
+
+/**
+ * Buffer contiguo de descriptores ORB.
+ *
+ * Reemplaza a la matriz cv::Mat de N x 32 en CaracteristicasFrame::mDescriptors y KeyFrame::mDescriptors.
+ * Cada descriptor ocupa un registro de 256 bits, y el buffer está alineado a 32 bytes,
+ * de modo que cada descriptor se puede cargar con una única instrucción AVX2 alineada.
+ *
+ * ptr(i) es la vista de un descriptor: un puntero a sus 32 bytes, sin el costo de crear un cv::Mat con Mat::row().
+ * ORBmatcher trabaja directamente con esos punteros.
+ *
+ * La copia es profunda, como lo era el clone() de la matriz.
+ * toMat() y el constructor desde cv::Mat son para los bordes: ORBextractor, la conversión a vector de DBoW2 y Osmap.
+ */
+class Descriptores{
+public:
+	/** Buffer vacío.*/
+	Descriptores();
+
+	/** Buffer de n descriptores sin inicializar.*/
+	explicit Descriptores(int n);
+
+	/** Conversión desde cv::Mat de N x 32 CV_8U.  Copia los datos.*/
+	explicit Descriptores(const cv::Mat &m);
+
+	Descriptores(const Descriptores &otro);
+	Descriptores(Descriptores &&otro);
+	Descriptores& operator=(const Descriptores &otro);
+	Descriptores& operator=(Descriptores &&otro);
+	~Descriptores();
+
+	/**
+	 * Redimensiona el buffer a n descriptores.
+	 * Sólo reserva memoria si la capacidad no alcanza.  El contenido queda indefinido.
+	 */
+	void create(int n);
+
+	/** Libera la memoria.*/
+	void release();
+
+	/** Cantidad de descriptores.*/
+	int rows() const {return mnFilas;}
+
+	bool empty() const {return mnFilas==0;}
+
+	/** Descriptor i, 32 bytes alineados.*/
+	const uchar* ptr(int i) const {return mpDatos + i*Descriptor::BYTES;}
+	uchar* ptr(int i) {return mpDatos + i*Descriptor::BYTES;}
+
+	/**
+	 * Vista cv::Mat de N x 32 sobre el buffer, sin copiar datos.
+	 * La vista es válida mientras el buffer no se redimensione ni se destruya.
+	 */
+	cv::Mat toMat() const;
+
+protected:
+	/** Datos, alineados a 32 bytes.*/
+	uchar *mpDatos;
+
+	/** Cantidad de descriptores.*/
+	int mnFilas;
+
+	/** Cantidad de descriptores para la que hay memoria reservada.*/
+	int mnCapacidad;
+};
+
+}// namespace ORB_SLAM2
+
+#endif /* INCLUDE_DESCRIPTORES_H_ */
@@ -22,24 +22,66 @@
 #define FRAME_H
 
 #include <vector>
+#include <memory>
 
 #include "MapPoint.h"
-#include "../Thirdparty/DBoW2/DBoW2/BowVector.h"
-#include "../Thirdparty/DBoW2/DBoW2/FeatureVector.h"
+#include "VectorBow.h"
 #include "ORBVocabulary.h"
 #include "ORBextractor.h"
+#include "Descriptores.h"
+#include "Grilla.h"
+#include "TablaAntidistorsion.h"
+#include "SE3f.h"
 
 #include <opencv2/opencv.hpp>
 
 namespace ORB_SLAM2
 {
-#define FRAME_GRID_ROWS 48
-#define FRAME_GRID_COLS 64
 
 class MapPoint;
 class KeyFrame;
 class ORBextractor;
 
+/**
+ * Datos de un cuadro que no cambian después de su construcción: puntos singulares, descriptores y grilla.
+ *
+ * Frame los mantiene en un bloque compartido con conteo de referencias.
+ * Copiar un Frame, como en mLastFrame = Frame(mCurrentFrame) de Tracking, sólo incrementa el contador:
+ * no copia puntos singulares, descriptores ni grilla.
+ *
+ * Sólo el constructor de Frame escribe el bloque, antes de que haya copias.
+ */
+struct CaracteristicasFrame{
+    // Vector of keypoints (original for visualization) and undistorted (actually used by the system).
+    // In the stereo case, mvKeysUn is redundant as images must be rectified.
+    // In the RGB-D case, RGB images can be distorted.
+    /**
+     * Vector de puntos singulares obtenidos por el detector, tal como los devuelve opencv.
+     *
+     * Sus coordenadas están en píxeles, en el sistema de referencia de la imagen.
+     */
+    std::vector<cv::KeyPoint> mvKeys;
+
+	/**
+	 * Vector de puntos antidistorsionados, mvKeys corregidos según los coeficientes de distorsión.
+	 *
+	 * Este vector está apareado con mvKeys, ambos de tamaño N.
+	 *
+	 * Sus coordenadas están en píxeles, en el sistema de referencia de la imagen antidistorsionada.
+	 * Los puntos se obtienen con cv::undistortPoints, reaplicando la matriz K de cámara.
+	 */
+    std::vector<cv::KeyPoint> mvKeysUn;
+
+	/**
+	 * Descriptores ORB, en un buffer contiguo y alineado.  Descriptores::ptr(i) es el descriptor de mvKeys[i].
+	 */
+    // ORB descriptor, each row associated to a keypoint.
+    Descriptores mDescriptors;
+
+    /** Grilla de puntos singulares, en formato CSR.  Se copia tal cual al KeyFrame.*/
+    Grilla mGrid;
+};
+
 /**
  * Frame representa un cuadro, una imagen, con los puntos singulares detectados.
  *
@@ -87,6 +129,18 @@ public:
     // Copy constructor.
     Frame(const Frame &frame);
 
+    /**
+     * Constructor de movimiento.  Toma los vectores y el bloque de características de frame sin copiarlos.
+     * Usado por Tracking al asignar un Frame temporal a mCurrentFrame o mLastFrame.
+     */
+    Frame(Frame &&frame) = default;
+
+    /** Asignación por copia, miembro a miembro.  El bloque de características se comparte.*/
+    Frame& operator=(const Frame &frame) = default;
+
+    /** Asignación por movimiento, miembro a miembro.*/
+    Frame& operator=(Frame &&frame) = default;
+
     /**
      * Constructor que crea un Frame y lo llena con los argumentos.
      * @param timeStamp Marca de tiempo, para registro.  ORB-SLAM no la utiliza.
@@ -94,28 +148,49 @@ public:
      *
      * Se distinguen dos modos de cámara: normal si se proporcionan los coeficientes de distorsión, o fisheye sin coeficientes si se proporciona noArray().
      *
+     * @param mascara Regiones de interés para la extracción, CV_8U del tamaño de la imagen.  Vacía extrae en toda la imagen.
+     *
      * Invocado sólo desde Tracling::GrabImageMonocular.
      */
     // Constructor for Monocular cameras.
-    Frame(const cv::Mat &imGray, const double &timeStamp, ORBextractor* extractor,ORBVocabulary* voc, cv::Mat &K, cv::Mat &distCoef);//, const float &bf, const float &thDepth);
+    Frame(const cv::Mat &imGray, const double &timeStamp, ORBextractor* extractor,ORBVocabulary* voc, cv::Mat &K, cv::Mat &distCoef, const cv::Mat &mascara = cv::Mat());//, const float &bf, const float &thDepth);
     //Frame(const cv::Mat &imGray, const double &timeStamp, ORBextractor* extractor, ORBVocabulary* voc, const float &thDepth);
 
+    /**
+     * Constructor por flujo óptico: crea un cuadro sin extraer ORB, con puntos singulares de anterior seguidos por Lucas-Kanade.
+     *
+     * Cada punto singular i es el punto vIndices[i] de anterior, desplazado a vPuntos[i], con su octava, ángulo y descriptor,
+     * y asociado al mismo punto del mapa.  Antidistorsiona los puntos y construye la grilla como el constructor normal.
+     *
+     * El cuadro no tiene BoW, y no se usa para crear keyframes: sólo para estimar la pose.
+     * La pose no se inicializa.
+     *
+     * @param anterior Cuadro de donde provienen los puntos singulares.
+     * @param vIndices Índices de los puntos singulares en anterior.
+     * @param vPuntos Posiciones en la imagen nueva, distorsionadas, paralelo a vIndices.
+     * @param timeStamp Marca de tiempo de la imagen nueva.
+     *
+     * Invocado sólo desde Tracking::RastrearFlujo.
+     */
+    Frame(const Frame &anterior, const std::vector<int> &vIndices, const std::vector<cv::Point2f> &vPuntos, const double &timeStamp);
+
     /**
      * Procede con la extracción de descriptores ORB.
      *
      * @param flag false para monocular, o para cámara izquierda.  true para cámara derecha.  Siempre se invoca con false.
      * @param im Imagen sobre la que extraer los descriptores.
+     * @param mascara Regiones de interés, o vacía para toda la imagen.
      *
-     * Los descriptores se conservan en Frame::mDescriptors.
+     * Los descriptores se conservan en CaracteristicasFrame::mDescriptors.
      *
      * Invocado sólo desde el constructor.
      */
     // Extract ORB on the image. 0 for left image and 1 for right image.
-    void ExtractORB(int flag, const cv::Mat &im);
+    void ExtractORB(int flag, const cv::Mat &im, const cv::Mat &mascara = cv::Mat());
 
     /**
      * Computa BoW para todos los descriptores del cuadro.
-     * Los guarda en la propiedad mBowVec, que es del tipo BowVector, y en mFeatVec, del tipo FeatureVector.
+     * Los guarda en la propiedad mBowVec, que es del tipo VectorBow, y en mFeatVec, del tipo VectorFeatures.
      *
      * Si mBowVec no está vacío el método retorna sin hacer nada, evitando el recómputo.
      *
@@ -146,9 +221,9 @@ public:
     void SetPose(cv::Mat Tcw);
 
     /**
-     * Calcula las matrices de posición mRcw, mtcw y mOw a partir de la pose mTcw.
-     * Estas matrices son una manera de exponer la pose, no se utilizan en la operación de ORB-SLAM.
-     * UpdatePoseMatrices() extrae la inforamción de mTcw, la matriz que combina la pose completa.
+     * Calcula mTcw3f y mOw a partir de la pose mTcw.
+     * UpdatePoseMatrices() extrae la inforamción de mTcw, la matriz que combina la pose completa,
+     * en tipos de tamaño fijo que se usan para proyectar puntos sin asignar memoria.
      *
      */
     // Computes rotation, translation and camera center matrices from the camera pose.
@@ -156,8 +231,16 @@ public:
 
     /** Devuelve el vector de la posición de la cámara, el centro de la cámara.*/
     // Returns the camera center.
-    inline cv::Mat GetCameraCenter(){
-        return mOw.clone();
+    cv::Mat GetCameraCenter();
+
+    /** Pose de tamaño fijo, equivalente a mTcw.  Para proyectar puntos sin asignar memoria.*/
+    const SE3f &GetPose3f() const {
+        return mTcw3f;
+    }
+
+    /** Centro de la cámara en tamaño fijo, equivalente a GetCameraCenter.*/
+    const Eigen::Vector3f &GetCameraCenter3f() const {
+        return mOw;
     }
 
     /**
@@ -165,14 +248,12 @@ public:
      *
      * Es la inversa de la rotación mRwc.
      *
-     * @returns mRwc.t()
+     * @returns Rwc, la traspuesta de la rotación de mTcw3f.
      *
-     * No dispone de GetRotation para devolver la rotación sin invertir mRcw.
+     * No dispone de GetRotation para devolver la rotación sin invertir.
      */
     // Returns inverse of rotation
-    inline cv::Mat GetRotationInverse(){
-        return mRwc.clone();
-    }
+    cv::Mat GetRotationInverse();
 
     /**
      * Indica si un determinado punto 3D se encuentra en el subespacio visual (frustum) del cuadro.
@@ -212,6 +293,14 @@ public:
      */
     vector<size_t> GetFeaturesInArea(const float &x, const float  &y, const float  &r, const int minLevel=-1, const int maxLevel=-1) const;
 
+    /**
+     * Igual que GetFeaturesInArea, pero escribe los índices en un vector del invocante.
+     * El vector se vacía y se reutiliza: si ya tiene capacidad suficiente, la consulta no reserva memoria.
+     *
+     * @param vIndices Vector donde se devuelven los índices de los puntos singulares en el área.
+     */
+    void GetFeaturesInArea(vector<size_t> &vIndices, const float &x, const float  &y, const float  &r, const int minLevel=-1, const int maxLevel=-1) const;
+
 public:
 	/** Vocabulario BOW para clasificar descriptores.*/
     // Vocabulary used for relocalization.
@@ -288,25 +377,21 @@ public:
     // Number of KeyPoints.
     int N;
 
-    // Vector of keypoints (original for visualization) and undistorted (actually used by the system).
-    // In the stereo case, mvKeysUn is redundant as images must be rectified.
-    // In the RGB-D case, RGB images can be distorted.
     /**
-     * Vector de puntos singulares obtenidos por el detector, tal como los devuelve opencv.
-     *
-     * Sus coordenadas están en píxeles, en el sistema de referencia de la imagen.
+     * Bloque compartido con puntos singulares, descriptores y grilla.
+     * Las copias del cuadro comparten el mismo bloque.
+     * Se accede con GetKeys, GetKeysUn y GetDescriptors.
      */
-    std::vector<cv::KeyPoint> mvKeys;
+    std::shared_ptr<CaracteristicasFrame> mpCaracteristicas;
 
-	/**
-	 * Vector de puntos antidistorsionados, mvKeys corregidos según los coeficientes de distorsión.
-	 *
-	 * Este vector está apareado con mvKeys, ambos de tamaño N.
-	 *
-	 * Sus coordenadas están en píxeles, en el sistema de referencia de la imagen antidistorsionada.
-	 * Los puntos se obtienen con cv::undistortPoints, reaplicando la matriz K de cámara.
-	 */
-    std::vector<cv::KeyPoint> mvKeysUn;
+    /** Puntos singulares tal como los devuelve el detector.  CaracteristicasFrame::mvKeys.*/
+    const std::vector<cv::KeyPoint>& GetKeys() const {return mpCaracteristicas->mvKeys;}
+
+    /** Puntos singulares antidistorsionados.  CaracteristicasFrame::mvKeysUn.*/
+    const std::vector<cv::KeyPoint>& GetKeysUn() const {return mpCaracteristicas->mvKeysUn;}
+
+    /** Descriptores de los puntos singulares.  CaracteristicasFrame::mDescriptors.*/
+    const Descriptores& GetDescriptors() const {return mpCaracteristicas->mDescriptors;}
 
     /** -1 para monocular.  Se pasa en el constructor de copia de Frame.*/
     //std::vector<float> mvDepth;
@@ -315,18 +400,15 @@ public:
     /**
      * Vector BoW correspondiente a los puntos singulares.
      *
-     * BowVector es un mapa de Word Id (unsigned int) a Word value (double), que representa un peso.
+     * Palabras ordenadas (Word Id, unsigned int) con sus pesos (Word value, double), en arreglos paralelos.
      */
-    DBoW2::BowVector mBowVec;
+    VectorBow mBowVec;
 
     /**
-     * Vector "Feature" correspondiente a los puntos singulares.
+     * Vector "Feature" correspondiente a los puntos singulares: nodos del vocabulario con sus puntos singulares, en formato CSR.
      */
-    DBoW2::FeatureVector mFeatVec;
+    VectorFeatures mFeatVec;
 
-	/** Descriptores ORB en el formato Mat, tal como los devuelve opencv.  mDescritorRight no se usa, se pasa en el constructor de copia.*/
-    // ORB descriptor, each row associated to a keypoint.
-    cv::Mat mDescriptors;//, mDescriptorsRight;
 
 	/** Vector de puntos 3D del mapa asociados a los puntos singulares.
 	Este vector tiene la misma longitud que mvKeys y mvKeysUn.
@@ -351,7 +433,6 @@ public:
 	 * para reducir la complejidad del macheo.
 	 */
     static float mfGridElementHeightInv;
-    std::vector<std::size_t> mGrid[FRAME_GRID_COLS][FRAME_GRID_ROWS];
 
 	/**
 	 * Pose de la cámara.
@@ -438,11 +519,18 @@ public:
 	 */
     static bool mbInitialComputations;
 
+	/**
+	 * Tabla de antidistorsión precomputada para la calibración actual, usada por UndistortKeyPoints.
+	 * Se construye en los cómputos iniciales, y queda vacía si no hay distorsión o si no alcanza la precisión requerida.
+	 */
+    static TablaAntidistorsion mTablaAntidistorsion;
+
     /**
      * Calcula los puntos singulares de mvKeysUn.
      *
      * Antidistorsiona los puntos detectados, que están en mvKeys, y los guarda en mvKeysUn en el mismo orden.
      * Si no hay distorsión, UndistortKeyPoints retorna rápidamente unificando mvKeysUn = mvKeys en un mismo vector.
+     * Si hay tabla de antidistorsión, interpola en ella; si no, usa el modelo exacto.
      */
     // Undistort keypoints given OpenCV distortion parameters.
     // Only for the RGB-D case. Stereo must be already rectified!
@@ -471,11 +559,20 @@ public:
     // Computes image bounds for the undistorted image (called in the constructor).
     void ComputeImageBounds(const cv::Mat &imLeft);
 
+    /**
+     * Construye mTablaAntidistorsion con el modelo de cámara de este cuadro: cv::undistortPoints o proyección equidistante.
+     *
+     * @param tamano Tamaño de la imagen.
+     *
+     * Invocado sólo desde el constructor, en los cómputos iniciales.
+     */
+    void ConstruirTablaAntidistorsion(const cv::Size &tamano);
+
     /**
      * Asigna los puntos singulares a sus celdas de la grilla.
      * La imagen de divide en una grilla para detectar puntos de manera más homogénea.
      * Luego de "desdistorsionar" las coordenadas de los puntos singulares detectados,
-     * este método crea un vector de puntos singulares para cada celda de la grillam, y lo puebla.
+     * este método distribuye los puntos singulares en las celdas de la grilla mGrid, en una única pasada.
      */
     // Assign keypoints to the grid for speed up feature matching (called in the constructor).
     void AssignFeaturesToGrid();
@@ -486,33 +583,20 @@ private:
     // Rotation, translation and camera center
 
     /**
-     * Matriz R de rotación del mundo respecto de la cámara.
-     * Se actualiza con UpdatePoseMatrices().
-     */
-    cv::Mat mRcw;
-
-    /**
-     * Vector t de traslación del origen del mundo en el sistema de referencia de la cámara.
-     * Se actualiza con UpdatePoseMatrices().
-     */
-    cv::Mat mtcw;
-
-    /**
-     * Matriz de rotación inversa, de la cámara respecto del mundo.
+     * Pose mTcw en tamaño fijo: rotación R y traslación t del mundo respecto de la cámara.
      * Se actualiza con UpdatePoseMatrices().
      */
-    cv::Mat mRwc;
+    SE3f mTcw3f;
 
     /**
      * Vector centro de cámara, posición de la cámara respecto del mundo.
      *
-     * Es privado, se informa con Frame::GetCameraCenter.
+     * Es privado, se informa con Frame::GetCameraCenter y Frame::GetCameraCenter3f.
      *
-     * Matriz de 3x1 (vector vertical).
-     * Vector de traslación invertido.  mtcw es el vector traslación del origen del mundo en el sistema de referencia de la cámara.
+     * Vector de traslación invertido: -R.t()*t de mTcw3f.
      * Se actualiza con UpdatePoseMatrices().
      */
-    cv::Mat mOw; //==mtwc
+    Eigen::Vector3f mOw; //==mtwc
 };
 
 }// namespace ORB_SLAM
@@ -28,6 +28,7 @@
 #include <opencv2/core.hpp>
 //#include <opencv2/features2d.hpp>
 #include <mutex>
+#include "ControlPresupuesto.h"
 
 using namespace std;
 namespace ORB_SLAM2
@@ -183,6 +184,9 @@ protected:
      * Auxiliar para mostrar en pantalla
      */
     int nKFPendientes;
+
+    /** Telemetría del control de presupuesto de Tracking, copiada en Update.*/
+    ControlPresupuesto::Telemetria mTelemetria;
 };
 
 } //namespace ORB_SLAM
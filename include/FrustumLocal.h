@@ -0,0 +1,90 @@
+/*
+ * FrustumLocal.h
+ *
+ *  Created on: 17 oct. 2026
+ *      Author: alejandro
+ */
+
+#ifndef INCLUDE_FRUSTUMLOCAL_H_
+#define INCLUDE_FRUSTUMLOCAL_H_
+
+#include <vector>
+
+namespace ORB_SLAM2{
+
+class MapPoint;
+class Frame;
+
+/**
+ * Prueba de frustum por lotes para los puntos del mapa local, equivalente a Frame::isInFrustum aplicado a cada punto.
+ *
+ * Tracking::SearchLocalPoints invocaba Frame::isInFrustum una vez por punto del mapa local:
+ * cada invocación tomaba varias veces el mutex del punto, clonaba su posición y su normal, y calculaba un logaritmo.
+ *
+ * FrustumLocal separa la tarea en tres etapas:
+ * - Cargar toma una instantánea del mapa local en arreglos por componente (structure of arrays),
+ *   con una única toma del mutex por punto (MapPoint::GetDatosFrustum).
+ * - Proyectar evalúa proyección, límites de imagen, distancia, ángulo de observación y nivel de escala de todos los puntos,
+ *   de a 8 por vez con AVX si el procesador lo soporta.
+ * - Los resultados se vuelcan en las variables de tracking de cada punto, como lo hace isInFrustum.
+ *
+ * El nivel de escala no usa logaritmo: ceil(log(r)/log(f)) es el nivel L tal que f^(L-1) < r <= f^L,
+ * y se obtiene contando los umbrales f^k que r supera.
+ *
+ * Tracking tiene una única instancia, de modo que los arreglos se reutilizan de cuadro a cuadro sin asignar memoria.
+ */
+class FrustumLocal{
+public:
+	/**
+	 * Toma la instantánea de los puntos a evaluar.
+	 *
+	 * Omite los puntos malos y los ya vistos en el cuadro (mnLastFrameSeen == nFrameId), como Tracking::SearchLocalPoints.
+	 *
+	 * @param vpPuntos Puntos del mapa local.
+	 * @param nFrameId Id del cuadro actual.
+	 */
+	void Cargar(const std::vector<MapPoint*> &vpPuntos, const long unsigned int nFrameId);
+
+	/**
+	 * Evalúa la visibilidad de los puntos cargados en el cuadro.
+	 *
+	 * Registra en cada punto mbTrackInView, y en los visibles mTrackProjX, mTrackProjY, mnTrackScaleLevel y mTrackViewCos.
+	 *
+	 * @param F Cuadro actual, con pose.
+	 * @param viewingCosLimit Coseno mínimo entre la normal del punto y la dirección de observación.
+	 * @returns Cantidad de puntos visibles.
+	 */
+	int Proyectar(const Frame &F, const float viewingCosLimit);
+
+	/** Puntos visibles según el último Proyectar.*/
+	const std::vector<MapPoint*> &Visibles() const {return mvpVisibles;}
+
+protected:
+	/** Puntos cargados.*/
+	std::vector<MapPoint*> mvpPuntos;
+
+	/** Posiciones, por componente.*/
+	std::vector<float> mvX, mvY, mvZ;
+
+	/** Normales, por componente.*/
+	std::vector<float> mvNx, mvNy, mvNz;
+
+	/** Distancias mínima y máxima de observación, con los márgenes de GetMinDistanceInvariance y GetMaxDistanceInvariance.*/
+	std::vector<float> mvDistMin, mvDistMax;
+
+	/** Distancia máxima sin margen, para predecir la escala.*/
+	std::vector<float> mvDistEscala;
+
+	/** Resultados: proyección, coseno de observación y nivel predicho.*/
+	std::vector<float> mvU, mvV, mvCos, mvNivel;
+
+	/** Resultado: 1 si el punto es visible.*/
+	std::vector<unsigned char> mvVisible;
+
+	/** Puntos visibles.*/
+	std::vector<MapPoint*> mvpVisibles;
+};
+
+}// namespace ORB_SLAM2
+
+#endif /* INCLUDE_FRUSTUMLOCAL_H_ */
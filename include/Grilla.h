@@ -0,0 +1,78 @@
+/*
+ * Grilla.h
+ *
+ *  Created on: 17 oct. 2026
+ *      Author: alejandro
+ */
+
+#ifndef INCLUDE_GRILLA_H_
+#define INCLUDE_GRILLA_H_
+
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+namespace ORB_SLAM2{
+
+#define FRAME_GRID_ROWS 48
+#define FRAME_GRID_COLS 64
+
+/**
+ * Grilla de puntos singulares para acelerar el macheo, compartida por Frame y KeyFrame.
+ *
+ * Reemplaza al arreglo de FRAME_GRID_COLS x FRAME_GRID_ROWS vectores (3072 vectores en el heap por cuadro)
+ * por dos arreglos planos en formato CSR (compressed sparse row):
+ *
+ * - mvIndices tiene los índices de todos los puntos singulares, agrupados por celda.
+ * - mvInicio[c] es la posición en mvIndices del primer punto de la celda c, y mvInicio[c+1] la del siguiente a su último.
+ *
+ * Las celdas se numeran c = ix*FRAME_GRID_ROWS + iy, de modo que las celdas de una misma columna ix son contiguas:
+ * un rango de filas iyMin..iyMax de una columna es un único tramo de mvIndices.
+ * Dentro de cada celda los índices quedan en orden creciente, como en la grilla de vectores original.
+ *
+ * Se construye en una única pasada de ordenamiento por conteo, y su copia cuesta dos copias de arreglos contiguos.
+ */
+class Grilla{
+public:
+	/**
+	 * Distribuye los puntos singulares en las celdas.
+	 *
+	 * Los puntos que caen fuera de la grilla, por efecto de la antidistorsión, no se agregan.
+	 *
+	 * @param vKeysUn Puntos singulares antidistorsionados.
+	 * @param minX Borde izquierdo de la imagen antidistorsionada.
+	 * @param minY Borde superior de la imagen antidistorsionada.
+	 * @param anchoCeldaInv Inversa del ancho de la celda en píxeles.
+	 * @param altoCeldaInv Inversa del alto de la celda en píxeles.
+	 */
+	void Construir(const std::vector<cv::KeyPoint> &vKeysUn, const float minX, const float minY, const float anchoCeldaInv, const float altoCeldaInv);
+
+	/**
+	 * Tramo de índices de las celdas (ix, iyMin) a (ix, iyMax) inclusive.
+	 *
+	 * @param ix Columna.
+	 * @param iyMin Primera fila.
+	 * @param iyMax Última fila.
+	 * @param inicio Devuelve el puntero al primer índice.
+	 * @param fin Devuelve el puntero siguiente al último índice.
+	 */
+	void Tramo(const int ix, const int iyMin, const int iyMax, const unsigned int* &inicio, const unsigned int* &fin) const{
+		if(mvInicio.empty()){
+			inicio = fin = NULL;
+			return;
+		}
+		const int c = ix*FRAME_GRID_ROWS;
+		inicio = mvIndices.data() + mvInicio[c+iyMin];
+		fin    = mvIndices.data() + mvInicio[c+iyMax+1];
+	}
+
+protected:
+	/** Posición en mvIndices del primer punto de cada celda, más una posición final.  FRAME_GRID_COLS*FRAME_GRID_ROWS+1 elementos.*/
+	std::vector<int> mvInicio;
+
+	/** Índices de los puntos singulares, agrupados por celda.*/
+	std::vector<unsigned int> mvIndices;
+};
+
+}// namespace ORB_SLAM2
+
+#endif /* INCLUDE_GRILLA_H_ */
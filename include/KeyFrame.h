@@ -21,10 +21,12 @@
 #ifndef KEYFRAME_H
 #define KEYFRAME_H
 
-#include "../Thirdparty/DBoW2/DBoW2/BowVector.h"
-#include "../Thirdparty/DBoW2/DBoW2/FeatureVector.h"
+#include "VectorBow.h"
 #include "ORBVocabulary.h"
 #include "KeyFrameDatabase.h"
+#include "Descriptores.h"
+#include "Grilla.h"
+#include "SE3f.h"
 
 #include <mutex>
 
@@ -165,10 +167,16 @@ public:
     /** Lee el vector traslación, obtenido de Tcw.*/
     cv::Mat GetTranslation();
 
+    /** Lee la pose en tamaño fijo, equivalente a GetPose, sin asignar memoria.  Para proyectar puntos.*/
+    SE3f GetPose3f();
+
+    /** Lee el centro de cámara en tamaño fijo, equivalente a GetCameraCenter, sin asignar memoria.*/
+    Eigen::Vector3f GetCameraCenter3f();
+
     /**
      * Computa BoW para los descriptores del keyframe.
      *
-     * Genera los mapas KeyFrame::mBowVec y KeyFrame::mFeatVec, el primero con los BoW y sus pesos,
+     * Genera los vectores KeyFrame::mBowVec y KeyFrame::mFeatVec, el primero con los BoW y sus pesos,
      * el segundo con la lista de puntos singulares correspondiente a cada BoW.
      *
      * Frame::ComputeBoW hace exactamente lo mismo, pero no se ejecuta para todos los cuadros,
@@ -416,6 +424,14 @@ public:
      * @returns Vector de índices de los puntos singulares en el área cuadrada.
      */
     std::vector<size_t> GetFeaturesInArea(const float &x, const float  &y, const float  &r) const;
+
+    /**
+     * Igual que GetFeaturesInArea, pero escribe los índices en un vector del invocante.
+     * El vector se vacía y se reutiliza: si ya tiene capacidad suficiente, la consulta no reserva memoria.
+     *
+     * @param vIndices Vector donde se devuelven los índices de los puntos singulares en el área.
+     */
+    void GetFeaturesInArea(std::vector<size_t> &vIndices, const float &x, const float  &y, const float  &r) const;
     //cv::Mat UnprojectStereo(int i);
 
     // Image
@@ -661,8 +677,8 @@ public:
      */
     const std::vector<cv::KeyPoint> mvKeysUn;
 
-    /** Descriptores.  Se corresponden con los de mvKeys.*/
-    const cv::Mat mDescriptors;
+    /** Descriptores.  Se corresponden con los de mvKeys.  Descriptores::ptr(i) es el descriptor de mvKeys[i].*/
+    const Descriptores mDescriptors;
 
     /** Color de los keypoints.  Para visualización solamente.  Vector cargado en el constructor de keyframe, alineado con mvKeys*/
     vector<cv::Vec3b> vRgb;
@@ -671,30 +687,30 @@ public:
     /**
      * Vector de BoW obtenidos de los descriptores del keyframe.  ComputeBoW llena este vector.
      *
-     * BowVector es un mapa de Word Id (unsigned int) a Word value (double), que representa un peso.
+     * VectorBow tiene las palabras (Word Id, unsigned int) ordenadas, con sus pesos (Word value, double) en un arreglo paralelo.
      *
      * Este peso se utiliza solamente para relocalización y cierre de bucle,
-     * siempre a través de ORBVocabulary::score, que compara dos BowVector completos.
+     * siempre a través de VectorBow::PuntajeL1, que compara dos vectores completos.
      *
      * Word Id es la palabra BoW.
      */
-    DBoW2::BowVector mBowVec;
+    VectorBow mBowVec;
 
     /**
-     * Vector de Features de DBoW2.
+     * Vector de Features.
      * KeyFrame::ComputeBoW llena este vector.
      *
-     * FeatureVector es un mapa de nodos (NodeId, entero) con un vector de índices de puntos singulares asociados.
+     * VectorFeatures tiene los nodos (NodeId, entero) ordenados, con los índices de sus puntos singulares en formato CSR.
      *
      * A este vector no se accede por el índice de un punto singular, sino al revés:
      * se accede por NodoId, y se obtienen los índices de todos los puntos singulares con ese NodeId.
      *
      * Cada BoW tiene un NodeId biunívoco.  Pero hay NodeId sin BoW, pues no son hojas del árbol de vocabulario.
      * Sin embargo ORBVocabulary::transform sólo registra nodos hoja, es decir con BoW asociado.
-     * mFeacVec y mBowVec tienen el mismo tamaño.  Si bien se pueblan alineados, al ser mapas el orden se altera.
+     * mFeacVec y mBowVec tienen el mismo tamaño.  Si bien se pueblan alineados, al ordenarse el orden se altera.
      *
      */
-    DBoW2::FeatureVector mFeatVec;
+    VectorFeatures mFeatVec;
 
     /**
      * Vector alineado de BoW.
@@ -802,6 +818,12 @@ protected:
      */
     cv::Mat Ow;
 
+    /** Tcw en tamaño fijo, actualizada por SetPose junto con Tcw.  Se lee con GetPose3f.*/
+    SE3f mTcw3f;
+
+    /** Ow en tamaño fijo, actualizado por SetPose junto con Ow.  Se lee con GetCameraCenter3f.*/
+    Eigen::Vector3f mOw3f;
+
     /**
      * Puntos del mapa asociado a los puntos singulares.
      */
@@ -822,8 +844,9 @@ protected:
      */
     ORBVocabulary* mpORBvocabulary;
 
+    /** Grilla de puntos singulares, en formato CSR, copiada del Frame.*/
     // Grid over the image to speed up feature matching
-    std::vector< std::vector <std::vector<size_t> > > mGrid;
+    Grilla mGrid;
 
     /**
      * Mapa de covisibilidad, que vincula los keyframes covisibles con sus pesos.
@@ -25,7 +25,10 @@
 #include <list>
 #include <set>
 #include <mutex>
+#include <unordered_map>
+#include <stdint.h>
 #include "ORBVocabulary.h"
+#include "MutexCompartido.h"
 
 namespace ORB_SLAM2
 {
@@ -37,6 +40,15 @@ class Frame;
 /**
  * Lista invertida de KeyFrames, accesible por BoW.
  * Para cada palabra del vocabulario, hay una lista de keyframes que la contienen.
+ *
+ * Cada keyframe agregado recibe un índice compacto, su posición en mvpKeyFrames,
+ * y las listas de cada palabra son arreglos contiguos de esos índices, en orden creciente.
+ * Borrar un keyframe sólo deja una lápida en su índice, sin recorrer las listas;
+ * cuando las lápidas son muchas, Compactar renumera los índices y depura todas las listas de una vez.
+ *
+ * Las consultas toman el mutex como lectores, de modo que relocalización (Tracking) y detección de bucles (LoopClosing)
+ * consultan simultáneamente.  add, erase y clear lo toman como escritor.
+ * Las consultas escriben en los keyframes sólo los campos propios de cada una: mnLoop* y mnReloc*.
  */
 class KeyFrameDatabase
 {
@@ -60,7 +72,7 @@ public:
 
     /**
      * Borra un KeyFrame de la base de datos.
-     * Lo borra de cada lista de keyframes de cada BoW que tenga registrado.
+     * Deja una lápida en su índice, que las consultas ignoran, y compacta si las lápidas son demasiadas.
      * @param pKF KeyFrame
      */
     void erase(KeyFrame* pKF);
@@ -96,11 +108,18 @@ public:
 	 * Para cada keyframe calcula un puntaje de similaridad al comparar su conjunto de BoWs con el del cuadro actual.
 	 * El puntaje es la suma de los pesos de los BoW coincidentes.
 	 *
+	 * Las palabras compartidas y el puntaje L1 se acumulan en un único recorrido de las listas, en acumuladores densos por índice compacto,
+	 * sumando los términos en el mismo orden que VectorBow::PuntajeL1: el puntaje es idéntico.
+	 * Un keyframe cuyas palabras compartidas más las palabras por recorrer no superan el 80% del máximo parcial
+	 * no puede ser candidato, y se descarta sin seguir acumulando.
+	 *
 	 * Luego acumula en cada keyframe el puntaje de todos los keyframes covisibles.
 	 *
 	 * Finalmente devuelve los keyframes con al menos 75% del mejor puntaje.
 	 *
 	 * Estos candidatos luego deben pasar una prueba de pose.
+	 *
+	 * Invocado sólo desde Tracking: los acumuladores de relocalización no admiten consultas simultáneas entre sí.
 	 */
 	// Relocalization
 	std::vector<KeyFrame*> DetectRelocalizationCandidates(Frame* F);
@@ -133,18 +152,64 @@ protected:
 	// Associated vocabulary
 	const ORBVocabulary* mpVoc;
 
+	/**
+	 * Aparición de una palabra en un keyframe: su índice compacto y el peso de la palabra en su VectorBow.
+	 */
+	struct Aparicion{
+		DBoW2::WordValue peso;
+		uint32_t indice;
+	};
+
 	/**
 	* Cada elemento del vector corresponde a una palabra del vocabulario BoW.
-	* Cada elemento consiste de una lista de keyframes que contienen esa palabra BoW.
+	* Cada elemento consiste de un arreglo con las apariciones de esa palabra BoW en los keyframes, por índice compacto creciente.
 	* De este modo, a partir de la palabra Bow (la palabra es el índice en este vector), se obtiene una lista de KeyFrames que
 	* observan puntos singulares cuyos descriptores corresponden a ella.
 	* Se utiliza para cierre de bucles y relocalización.
+	*
+	* Los índices pueden ser lápidas, que se deben saltear.
 	*/
 	// Inverted file
-	std::vector<std::list<KeyFrame*> > mvInvertedFile;
+	std::vector<std::vector<Aparicion> > mvInvertedFile;
+
+	/**
+	 * Keyframe de cada índice compacto.
+	 * NULL es una lápida: el keyframe fue borrado, y el índice permanece en las listas hasta la próxima compactación.
+	 * Los índices no se reutilizan antes de compactar.
+	 */
+	std::vector<KeyFrame*> mvpKeyFrames;
+
+	/** Índice compacto de cada keyframe de la base, para borrar.*/
+	std::unordered_map<KeyFrame*, uint32_t> mmIndices;
+
+	/** Cantidad de lápidas en mvpKeyFrames.*/
+	size_t mnLapidas = 0;
+
+	/**
+	 * Elimina las lápidas: renumera los índices compactos de los keyframes vivos, conservando su orden,
+	 * y reescribe cada lista sin los índices de las lápidas.
+	 * Se invoca con el mutex tomado como escritor.
+	 */
+	void Compactar();
+
+	///@{
+	/**
+	 * Acumuladores de DetectRelocalizationCandidates, por índice compacto.
+	 * Un acumulador vale sólo si su sello en mvEpocaReloc es mnEpocaReloc: cada consulta inicia una época nueva, sin recorrerlos.
+	 * mvPalabrasReloc cuenta las palabras compartidas, mvPuntajeReloc la suma parcial del puntaje L1,
+	 * mvDescartadoReloc marca los keyframes descartados por la cota,
+	 * y mvTocadosReloc tiene los índices con acumulador válido, en el orden en que se encontraron.
+	 */
+	std::vector<unsigned int> mvEpocaReloc;
+	unsigned int mnEpocaReloc = 0;
+	std::vector<int> mvPalabrasReloc;
+	std::vector<double> mvPuntajeReloc;
+	std::vector<char> mvDescartadoReloc;
+	std::vector<uint32_t> mvTocadosReloc;
+	///@}
 
 	// Mutex
-	std::mutex mMutex;
+	MutexCompartido mMutex;
 };
 
 } //namespace ORB_SLAM
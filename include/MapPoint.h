@@ -24,6 +24,8 @@
 #include "KeyFrame.h"
 #include "Frame.h"
 #include "Map.h"
+#include "Descriptores.h"
+#include "SE3f.h"
 
 #include <opencv2/core/core.hpp>
 #include <mutex>
@@ -78,6 +80,9 @@ public:
      */
     void SetWorldPos(const cv::Mat &Pos);
 
+    /** Asigna al punto las coordenadas 3D argumento, en tamaño fijo.*/
+    void SetWorldPos(const Eigen::Vector3f &Pos);
+
     /**
      * Devuele un Mat con las coordenadas del punto.
      *
@@ -85,6 +90,9 @@ public:
      */
     cv::Mat GetWorldPos();
 
+    /** Devuelve las coordenadas del punto en tamaño fijo, sin asignar memoria.  Para proyectar puntos.*/
+    Eigen::Vector3f GetWorldPos3f();
+
     /**
      * Vector normal promedio de las observaciones.
      * Los puntos suelen estar en una superficie, y sólo pueden ser observados de un lado.
@@ -94,6 +102,9 @@ public:
      */
     cv::Mat GetNormal();
 
+    /** Vector normal en tamaño fijo, sin asignar memoria.*/
+    Eigen::Vector3f GetNormal3f();
+
     /**
      * Devuelve el keyframe de referencia.
      *
@@ -119,6 +130,13 @@ public:
      */
     std::map<KeyFrame*,size_t> GetObservations();
 
+    /**
+     * Devuelve los keyframes que observan el punto, sin copiar el mapa de observaciones.
+     *
+     * @param vpKFs Vector que se vacía y se llena con los keyframes.  Reutilizarlo evita asignar memoria.
+     */
+    void GetKeyFramesObservadores(std::vector<KeyFrame*> &vpKFs);
+
     /** Informa la cantidad de observaciones que registra el punto.*/
     int Observations();
 
@@ -220,9 +238,9 @@ public:
      * Un punto 3D tiene varias observaciones, y por lo tanto varios descriptores.
      * MapPoint::ComputeDistinctiveDescriptors calcula el que mejor lo representa.
      *
-     * @returns Descriptor del punto 3D.
+     * @returns Copia del descriptor del punto 3D.
      */
-    cv::Mat GetDescriptor();
+    Descriptor GetDescriptor();
 
     /**
      * Recalcula el vector normal y la profundidad de visibilidad a partir de las observaciones.
@@ -255,6 +273,18 @@ public:
      */
     int PredictScale(const float &currentDist, const float &logScaleFactor);
 
+    /**
+     * Lee con una única toma del mutex los datos que usa la prueba de frustum.
+     *
+     * @param pos Devuelve la posición.
+     * @param normal Devuelve el vector normal.
+     * @param minDist Devuelve la distancia mínima de observación, sin el margen de GetMinDistanceInvariance.
+     * @param maxDist Devuelve la distancia máxima de observación, sin el margen de GetMaxDistanceInvariance.
+     *
+     * Usado por FrustumLocal para tomar la instantánea del mapa local.
+     */
+    void GetDatosFrustum(Eigen::Vector3f &pos, Eigen::Vector3f &normal, float &minDist, float &maxDist);
+
 
 	/**
 	 * Color sugerido para graficación.
@@ -300,7 +330,7 @@ public:
     /**
      * Variables efímeras usadas por Tracking.
      *
-     * Varias se escriben solamente en Frame::IsInFrustum y se utiliza en OrbMatcher::SearchByProjection
+     * Varias se escriben solamente en Frame::IsInFrustum (o FrustumLocal, su versión por lotes) y se utiliza en OrbMatcher::SearchByProjection
      */
     //@{
     /** Variables usadas por Tracking.*/
@@ -453,10 +483,10 @@ protected:
 
     /**
      * Posición en coordenadas absolutas del mapa global.
-     * Mat vertical de opencv de 3x1 (3 filas, una columna).
+     * Vector de tamaño fijo; GetWorldPos lo convierte a Mat vertical de 3x1 para la API de OpenCV.
      */
 	// Position in absolute coordinates
-	cv::Mat mWorldPos;
+	Eigen::Vector3f mWorldPos;
 
 	/**
 	 * Keyframes que observan este punto, y sus índices.
@@ -469,11 +499,11 @@ protected:
 
 	/** Vector normal, computado como el promedio de las direcciones de todas las vistas del punto.*/
 	// Mean viewing direction
-	cv::Mat mNormalVector;
+	Eigen::Vector3f mNormalVector;
 
 	/** Mejor descriptor del punto.*/
 	// Best descriptor to fast matching
-	cv::Mat mDescriptor;
+	Descriptor mDescriptor;
 
 	/**
 	 * Keyframe de referencia.
@@ -0,0 +1,60 @@
+/*
+ * MutexCompartido.h
+ *
+ *  Created on: 17 oct. 2026
+ *      Author: alejandro
+ */
+
+#ifndef INCLUDE_MUTEXCOMPARTIDO_H_
+#define INCLUDE_MUTEXCOMPARTIDO_H_
+
+#include <pthread.h>
+
+namespace ORB_SLAM2{
+
+/**
+ * Mutex de lectores y escritor sobre pthread_rwlock.
+ *
+ * Tiene la interfaz de std::shared_mutex, que requiere C++17 (std::shared_timed_mutex, C++14), mientras el proyecto compila en C++11:
+ * lock/unlock para el escritor, exclusivo, y lock_shared/unlock_shared para los lectores, que acceden simultáneamente.
+ *
+ * El escritor se toma con unique_lock<MutexCompartido>, y los lectores con LockCompartido.
+ *
+ * Usado por KeyFrameDatabase, para que relocalización y detección de bucles consulten a la vez.
+ */
+class MutexCompartido{
+public:
+	MutexCompartido(){pthread_rwlock_init(&mCerrojo, NULL);}
+	~MutexCompartido(){pthread_rwlock_destroy(&mCerrojo);}
+
+	void lock(){pthread_rwlock_wrlock(&mCerrojo);}
+	void unlock(){pthread_rwlock_unlock(&mCerrojo);}
+	void lock_shared(){pthread_rwlock_rdlock(&mCerrojo);}
+	void unlock_shared(){pthread_rwlock_unlock(&mCerrojo);}
+
+private:
+	MutexCompartido(const MutexCompartido&);
+	MutexCompartido& operator=(const MutexCompartido&);
+
+	pthread_rwlock_t mCerrojo;
+};
+
+/**
+ * Bloqueo de lector con alcance, como std::shared_lock.
+ * Toma el mutex compartido al construirse y lo libera al destruirse.
+ */
+class LockCompartido{
+public:
+	explicit LockCompartido(MutexCompartido &m): mMutex(m){mMutex.lock_shared();}
+	~LockCompartido(){mMutex.unlock_shared();}
+
+private:
+	LockCompartido(const LockCompartido&);
+	LockCompartido& operator=(const LockCompartido&);
+
+	MutexCompartido &mMutex;
+};
+
+}// namespace ORB_SLAM2
+
+#endif /* INCLUDE_MUTEXCOMPARTIDO_H_ */
@@ -24,11 +24,18 @@
 
 #include "../Thirdparty/DBoW2/DBoW2/FORB.h"
 #include "../Thirdparty/DBoW2/DBoW2/TemplatedVocabulary.h"
+#include "VectorBow.h"
+#include <vector>
+#include <string>
+#include <stdint.h>
 
 namespace ORB_SLAM2
 {
+class Descriptores;
+class WorkerPool;
+
 /** Vocabulario que mapea descriptores ORB con Bow.
- * OBRVocabulary es un tipo basado en plantilla que define un tipo de descriptores y una clase de funciones DBOW2 para manipularlos.
+ * OBRVocabulary es una especialización de la plantilla DBoW2::TemplatedVocabulary, que define un tipo de descriptores y una clase de funciones DBOW2 para manipularlos.
  * OBRVocabulary usa Mat como descriptor (DBoW2::FORB::TDescriptor es Mat), y la clase DBoW2::FORB como implementación específica para ORB
  * de las funciones generales de manipulación de descriptores que requiere DBOW2.
  *
@@ -38,17 +45,152 @@ namespace ORB_SLAM2
  *
  * Frame, KeyFrame, LoopClosing y Tracking lo denominan mpORBvocabulary.
  * KeyFrameDatabase lo denomina mpVoc.
- * Frame y KeyFrame utilizan solamente su método transform, que obtiene los BoW correspondientes a un conjunto de descriptores.
- * LoopClosing utiliza solamente su método score, que compara dos BoW.
- * KeyFrameDatabase utiliza score y size, este último simplemente informa la cantidad de palabras en el vocabulario.
+ * Frame y KeyFrame utilizan solamente su método Transformar, que obtiene los BoW correspondientes a un conjunto de descriptores.
+ * KeyFrameDatabase utiliza size, que simplemente informa la cantidad de palabras en el vocabulario.
  * Tracking se limita a pasarlo a los objetos que construye.  Actúa como pasamanos.
  *
+ * El árbol de DBoW2 tiene un objeto Node por nodo, con su descriptor en un cv::Mat y sus hijos en un vector:
+ * descender el árbol salta por la memoria en cada nivel.
+ * Aplanar construye una copia plana del árbol, con los nodos en orden de nivel (BFS),
+ * de modo que los hijos de cada nodo son consecutivos y sus descriptores forman un único bloque contiguo.
+ * Transformar desciende el árbol plano computando en lote las distancias a todos los hijos con ORBmatcher::DescriptorDistances,
+ * y procesa los descriptores de un cuadro en paralelo.
  *
- *
- *
+ * GuardarPlano escribe el árbol plano en un archivo, y CargarPlano lo mapea en memoria con mmap, de sólo lectura y sin copiarlo.
+ * Cargado de este modo no se construye el árbol de DBoW2: el arranque es inmediato, los descriptores se leen a demanda,
+ * y varios procesos en el mismo equipo comparten la misma copia en el page cache.
  */
+class ORBVocabulary : public DBoW2::TemplatedVocabulary<DBoW2::FORB::TDescriptor, DBoW2::FORB>
+{
+public:
+	ORBVocabulary();
+	~ORBVocabulary();
+
+	/**
+	 * Construye la representación plana del árbol de DBoW2, usada por Transformar.
+	 * Se invoca una única vez, luego de cargar el vocabulario con loadFromBinaryFile.
+	 */
+	void Aplanar();
+
+	/**
+	 * Escribe la representación plana en un archivo, para CargarPlano.
+	 * @param origen Vocabulario binario del que se cargó, cuyo tamaño y huella se registran en la cabecera.
+	 * @returns false si no hay representación plana o no se pudo leer el origen o escribir el archivo.
+	 */
+	bool GuardarPlano(const std::string &archivo, const std::string &origen) const;
+
+	/**
+	 * Mapea en memoria un archivo escrito por GuardarPlano y lo usa como representación plana, sin copiarlo.
+	 * No construye el árbol de DBoW2.
+	 * Valida la cabecera y los índices de los nodos, que son lo único que lee.
+	 * @param origen Vocabulario binario del que debe provenir el archivo.  Se rechaza si su tamaño o su huella no coinciden con los de la cabecera.
+	 * @returns false si el archivo no existe, no es un vocabulario plano válido o no corresponde a origen.
+	 */
+	bool CargarPlano(const std::string &archivo, const std::string &origen);
+
+	/**
+	 * Convierte un vocabulario en el formato binario de loadFromBinaryFile al formato plano.
+	 * @returns false si no se pudo leer o escribir.
+	 */
+	static bool ConvertirAPlano(const std::string &binario, const std::string &plano);
+
+	/**
+	 * Establece la cantidad de hilos con que Transformar procesa los descriptores.
+	 * @param nHilos 1 es secuencial.
+	 */
+	void SetHilos(int nHilos);
+
+	/** @returns true si la representación plana está disponible.*/
+	bool Plano() const {return mpNodos != NULL;}
+
+	/** Cantidad de palabras, también con el vocabulario plano mapeado.*/
+	virtual unsigned int size() const;
+
+	/** true si no hay vocabulario cargado.*/
+	virtual bool empty() const;
+
+	/**
+	 * Computa los vectores BoW y de features de un conjunto de descriptores.
+	 *
+	 * Equivale a DBoW2::TemplatedVocabulary::transform con TF_IDF y L1, y produce el mismo resultado,
+	 * pero directamente en la representación plana VectorBow y VectorFeatures.
+	 * Sin representación plana recurre a transform de DBoW2.
+	 *
+	 * Es thread safe.  Invocaciones simultáneas desde varios hilos se serializan en el pool.
+	 *
+	 * @param descriptores Descriptores del cuadro o keyframe.
+	 * @param bowVec Resultado, vector BoW normalizado.
+	 * @param featVec Resultado, índices de los descriptores agrupados por nodo del vocabulario.
+	 * @param nivelesArriba Niveles por encima de las hojas de los nodos de featVec.
+	 * @param palabras Opcional, resultado, palabra de cada descriptor.
+	 * @param pesos Opcional, resultado, peso de la palabra de cada descriptor.
+	 */
+	void Transformar(const Descriptores &descriptores, VectorBow &bowVec, VectorFeatures &featVec, int nivelesArriba,
+			std::vector<DBoW2::WordId> *palabras = NULL, std::vector<DBoW2::WordValue> *pesos = NULL) const;
+
+protected:
+	/**
+	 * Nodo del árbol plano.
+	 * Los hijos de un nodo son los nodos primerHijo a primerHijo+nHijos-1, y sus descriptores son consecutivos en mvDescriptores.
+	 * Las hojas no tienen hijos.
+	 */
+	struct NodoPlano{
+		/** Índice plano del primer hijo.*/
+		uint32_t primerHijo;
+
+		/** Cantidad de hijos, 0 en las hojas.*/
+		uint32_t nHijos;
+
+		/** Palabra, sólo en las hojas.*/
+		uint32_t palabra;
+
+		/** NodeId de DBoW2, que se informa en VectorFeatures.*/
+		uint32_t nodo;
+	};
+
+	/**
+	 * Desciende el árbol plano desde la raíz hasta una hoja.
+	 *
+	 * @param descriptor Descriptor de 32 bytes.
+	 * @param nivelNodo Nivel cuyo nodo se informa en nodo.
+	 * @param palabra Resultado, palabra de la hoja.
+	 * @param peso Resultado, peso de la palabra.
+	 * @param nodo Resultado, NodeId de DBoW2 del nodo de nivel nivelNodo, 0 (raíz) si nivelNodo<=0.
+	 */
+	void Descender(const uchar *descriptor, const int nivelNodo, DBoW2::WordId &palabra, DBoW2::WordValue &peso, DBoW2::NodeId &nodo) const;
+
+	/** Libera la representación plana, propia o mapeada.*/
+	void LiberarPlano();
+
+	///@{
+	/**
+	 * Representación plana: apunta a mvNodos, mvDescriptores y mvPesos, o al archivo mapeado.
+	 * mpNodos tiene los mnNodos nodos en orden de nivel (BFS), el nodo 0 es la raíz.
+	 * mpDescriptores tiene los descriptores de los nodos, 32 bytes cada uno, en el mismo orden.  El de la raíz no se usa.
+	 * mpPesos tiene el peso de cada una de las mnPalabras palabras, indexado por WordId.
+	 */
+	const NodoPlano *mpNodos;
+	const uchar *mpDescriptores;
+	const DBoW2::WordValue *mpPesos;
+	size_t mnNodos, mnPalabras;
+	///@}
+
+	///@{
+	/** Representación plana propia, construida por Aplanar.*/
+	std::vector<NodoPlano> mvNodos;
+	std::vector<uchar> mvDescriptores;
+	std::vector<DBoW2::WordValue> mvPesos;
+	///@}
+
+	/** Archivo mapeado por CargarPlano, NULL si no hay.*/
+	void *mpMapa;
+
+	/** Tamaño del archivo mapeado.*/
+	size_t mnBytesMapa;
 
-typedef DBoW2::TemplatedVocabulary<DBoW2::FORB::TDescriptor, DBoW2::FORB> ORBVocabulary;
+	/** Pool para procesar los descriptores en paralelo.  NULL si es secuencial.*/
+	WorkerPool *mpPool;
+};
 
 } //namespace ORB_SLAM
 
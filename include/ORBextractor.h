@@ -25,6 +25,8 @@
 #include <list>
 //#include <opencv/cv.h>
 #include <opencv2/core/core.hpp>	// Cambiado por prolijidad, sólo se usa para definir Mat, Point, Point2i y KeyPoint
+#include "WorkerPool.h"
+#include "Descriptores.h"
 
 
 namespace ORB_SLAM2
@@ -34,11 +36,15 @@ namespace ORB_SLAM2
  * ORBextractor utiliza una versión simplificada de Octree (en rigor es un Quadtree),
  * creando un árbol cuyos nodos representan un rectángulo de una imagen y sus cuatro hijos representan un cuarto de esa imagen.
  * ExtractorNode es la clase de esos nodos, que registran las coordenadas de los vértices del rectángulo asociado,
- * y la lista de puntos singulares en él.
+ * y el rango de puntos singulares en él.
  *
  * El método de búsqueda de zonas consiste en seguir dividiendo los rectángulos hasta que contengan un o ningún punto singular.
  * El árbol termina cuando se alcanza una cantidad máxima de nodos esperados, o cuando ningún nodo tiene más de un puntos singular.
  *
+ * Los nodos viven en el vector QuadtreeArena::vNodes y se refieren entre sí por índice.
+ * No copian puntos singulares: sus puntos son el rango [iniKeys, finKeys) de QuadtreeArena::vPuntos o QuadtreeArena::vAux,
+ * que contiene las coordenadas, la respuesta y el índice de cada punto singular a distribuir.
+ *
  * Objeto usado exclusivamente en ORBextactor::DistributeOctTree.
  */
 class ExtractorNode
@@ -50,17 +56,8 @@ public:
 	 */
     ExtractorNode():bNoMore(false){}
 
-    /**
-     * Divide el nodo en 4: n1, n2, n3 y n4.
-     * Notar que este método no construye los cuatro nodos derivados, éstos son construidos por el método que invoca.
-     */
-    void DivideNode(ExtractorNode &n1, ExtractorNode &n2, ExtractorNode &n3, ExtractorNode &n4);
-
-    /**
-     * Vector de puntos singulares de este nodo.
-     * vKeys.empty() responde si el nodo tiene o no puntos singulares.
-     */
-    std::vector<cv::KeyPoint> vKeys;
+    /** Cantidad de puntos singulares del nodo.*/
+    int size() const {return finKeys - iniKeys;}
 
     ///@{
     //@{
@@ -75,22 +72,113 @@ public:
     ///@}
     //@}
 
+    ///@{
+    //@{
     /**
-     * Iterador que apunta a la posición del propio nodo en una lista.
-     * El procedimiento que invoca la construcción de un objeto ExtractorNode debe luego inicializar esta propiedad.
+     * Rango de puntos singulares del nodo en QuadtreeArena::vPuntos o QuadtreeArena::vAux: [iniKeys, finKeys).
+     * Los rangos de los cuatro hijos son subrangos consecutivos del rango del padre.
+     */
+    int iniKeys, finKeys;
+    ///@}
+    //@}
+
+    /** true si los puntos del nodo están en QuadtreeArena::vAux, false si están en QuadtreeArena::vPuntos.*/
+    bool bAux;
+
+    ///@{
+    //@{
+    /**
+     * Índices del nodo anterior y siguiente en la lista de nodos vivos, -1 en los extremos.
+     * Reemplazan la std::list de nodos: la lista está enlazada dentro del vector de nodos.
      */
-    std::list<ExtractorNode>::iterator lit;
+    int anterior, siguiente;
+    ///@}
+    //@}
 
     /**
      * Señal que indica que el nodo tiene exactamente un punto asignado.
      * Se inicializa como false, diversos métodos verifican y lo ponen en true cuando tiene un único punto.
      * Diversos métodos evalúan el nodo para determinar si tienen un único punto singular (bNoMore == true) y no requiere más análisis,
-     * ningún punto singular (vKeys.empty() == true) lo que hace al nodo eliminable,
+     * ningún punto singular (size() == 0) lo que hace al nodo eliminable,
      * o en otro caso contiene más de un punto singular con lo que se puede seguir procesando.
      */
     bool bNoMore;
 };
 
+/**
+ * Memoria de trabajo de ORBextractor::DistributeOctTree.
+ *
+ * Los vectores conservan su capacidad entre invocaciones, de modo que tras los primeros cuadros
+ * la distribución de puntos singulares no reserva memoria.
+ * ORBextractor tiene una arena por nivel de la pirámide, para que los niveles se procesen en paralelo.
+ */
+class QuadtreeArena
+{
+public:
+    /** Nodos del árbol.  Los nodos eliminados de la lista no se reutilizan durante una invocación.*/
+    std::vector<ExtractorNode> vNodes;
+
+    /**
+     * Copia compacta de un punto singular a distribuir: lo único que lee el árbol.
+     * Se mueve al particionar en lugar de cv::KeyPoint, y se recorre secuencialmente.
+     */
+    struct Punto{
+    	float x, y, response;
+    	/** Índice en el vector de puntos singulares a distribuir.*/
+    	int indice;
+    };
+
+    ///@{
+    //@{
+    /**
+     * Puntos singulares, particionados en los rangos de los nodos.
+     * Al dividir un nodo sus puntos se reparten en el otro vector, en el mismo rango:
+     * ExtractorNode::bAux indica en cuál de los dos están los puntos de cada nodo.
+     */
+    std::vector<Punto> vPuntos, vAux;
+    ///@}
+    //@}
+
+    /** Nodo inicial de cada punto singular, para repartirlos con un ordenamiento por conteo.*/
+    std::vector<int> vNodoInicial;
+
+    ///@{
+    //@{
+    /** Pares (cantidad de puntos, índice de nodo) a expandir, de la ronda actual y la anterior.*/
+    std::vector<std::pair<int,int> > vSizeAndNode, vPrevSizeAndNode;
+    ///@}
+    //@}
+
+    /** Primer nodo de la lista de nodos vivos, -1 si está vacía.*/
+    int primero;
+
+    /** Cantidad de nodos vivos en la lista.*/
+    int nNodos;
+
+    /** Vacía la arena sin liberar memoria.*/
+    void clear(){vNodes.clear(); primero = -1; nNodos = 0;}
+
+    /** Agrega el nodo al principio de la lista de nodos vivos.*/
+    void push_front(int nodo){
+    	ExtractorNode &n = vNodes[nodo];
+    	n.anterior = -1;
+    	n.siguiente = primero;
+    	if(primero>=0) vNodes[primero].anterior = nodo;
+    	primero = nodo;
+    	nNodos++;
+    }
+
+    /** Quita el nodo de la lista de nodos vivos y devuelve el siguiente.*/
+    int erase(int nodo){
+    	ExtractorNode &n = vNodes[nodo];
+    	if(n.anterior>=0) vNodes[n.anterior].siguiente = n.siguiente;
+    	else primero = n.siguiente;
+    	if(n.siguiente>=0) vNodes[n.siguiente].anterior = n.anterior;
+    	nNodos--;
+    	return n.siguiente;
+    }
+};
+
 /**
  * Empaqueta todos los métodos de detección de puntos singulares y extracción de descriptores.
  * ORBextractor procesa imágenes con el operador ():
@@ -102,7 +190,9 @@ public:
  * Tracking crea las únicas dos instancias de este objeto, de larga vida, mpORBextractorLeft y mpIniORBextractor,
  * el primero como parte inicial del proceso de tracking en estado OK, y el segundo para inicializar.
  *
- * Con la excepción de mvImagePyramid, todas las propiedades son protegidas, se establecen durante la construcción y no cambian.
+ * Con la excepción de mvImagePyramid, todas las propiedades son protegidas, se establecen durante la construcción y no cambian,
+ * salvo la arena de la pirámide que se reserva con el primer cuadro y cuando cambia la resolución,
+ * y el presupuesto de extracción que se ajusta con SetPresupuesto.
  *
  *
  * ORBextractor::ComputeKeyPointsOctTree contiene una buena descripción de los puntos singulares.
@@ -132,7 +222,7 @@ public:
  * @param img Imagen sobre la que se extraerá el descriptor.
  * @param pattern Siempre el mismo, patrón de coordenadas para la evaluación BRIEF.
  * @param desc Descriptor resultado, de 256 bits (32 bytes, 4 int).
- * Invocado sólo desde computeDescriptors.
+ * Invocado sólo desde computeOrbDescriptorsScalar, el núcleo escalar de computeDescriptors.
  *
  *
  *
@@ -160,11 +250,15 @@ public:
 
     /**
      * Constructor que carga los valores de configuración recibidos como argumentos, computa pirámide y precalcula factores.
+     *
+     * @param nThreads Cantidad de hilos para procesar los niveles de la pirámide en paralelo.  1 para procesamiento secuencial.
+     * El resultado es idéntico con cualquier cantidad de hilos.
      */
     ORBextractor(int nfeatures, float scaleFactor, int nlevels,
-                 int iniThFAST, int minThFAST);
+                 int iniThFAST, int minThFAST, int nThreads = 1);
 
-    ~ORBextractor(){}
+    /** Destruye el pool de hilos.*/
+    ~ORBextractor();
 
     /**
      * ORBextractor(...) procesa imágenes con el operador ():
@@ -173,18 +267,18 @@ public:
 	 * - extrayendo sus descriptores
 	 *
 	 * @param image Imagen a procesar.
-	 * @param mask Máscara.  No implementada.
+	 * @param mask Máscara de regiones de interés, CV_8U del tamaño de la imagen.  Vacía para toda la imagen.
+	 * Los puntos singulares sólo se buscan en las celdas de detección que tocan píxeles no nulos de la máscara.
 	 * @param keypoints Puntos singulares detectados como resultado de la operación.
-	 * @param descriptors Descriptores extraídos como resultado de la operación.
+	 * @param descriptors Descriptores extraídos como resultado de la operación, en el buffer alineado de Frame.
 	 *
 	 * Invocado sólo desde Frame::ExtractORB
      */
     // Compute the ORB features and descriptors on an image.
     // ORB are dispersed on the image using an octree.
-    // Mask is ignored in the current implementation.
     void operator()( cv::InputArray image, cv::InputArray mask,
       std::vector<cv::KeyPoint>& keypoints,
-      cv::OutputArray descriptors);
+      Descriptores& descriptors);
 
     /**
      * Devuelve el atributo protegido nlevels, la cantidad de niveles en la pirámide, establecida por el constructor y de sólo lectura.
@@ -238,6 +332,21 @@ public:
         return mvInvLevelSigma2;
     }
 
+    /**
+     * Ajusta el presupuesto de extracción: cantidad de puntos singulares y niveles de la pirámide en los que se detectan.
+     * Los puntos se reparten entre los niveles usados con la misma serie geométrica que el constructor.
+     * Los niveles no usados no se computan, y los puntos singulares conservan la numeración de octavas.
+     *
+     * Los valores se limitan a los configurados en el constructor, que son los máximos.
+     * No se debe invocar durante una extracción.
+     *
+     * @param nFeatures Cantidad de puntos singulares a extraer.
+     * @param nNiveles Cantidad de niveles usados, desde el nivel 0.
+     *
+     * Invocado desde Tracking::GrabImageMonocular, según ControlPresupuesto.
+     */
+    void SetPresupuesto(int nFeatures, int nNiveles);
+
     /**
      * Imágenes de la pirámide, a las que se aplica FAST.
      * Producida por ComputePyramid, es un vector de ´nlevels´ imágenes.
@@ -248,12 +357,39 @@ protected:
 
     /**
      * Genera las imágenes de la pirámide y las guarda en el vector mvImagePyramid.
+     * Las imágenes se escriben en la arena mPyramidArena, que se reserva con el primer cuadro
+     * y sólo se vuelve a reservar cuando cambia la resolución de la imagen.
+     *
      * @param image Imagen a procesar, obtenida de la cámara.
      *
-     * Invocado sólo desde el constructor.
+     * Invocado sólo desde ORBextractor::operator().
      */
     void ComputePyramid(cv::Mat image);
 
+    /**
+     * Reserva la arena de la pirámide para imágenes de tamaño size, y arma las vistas mvPyramidBordered y mvImagePyramid sobre ella.
+     *
+     * @param size Tamaño de la imagen del nivel 0, sin bordes.
+     *
+     * Invocado sólo desde ComputePyramid.
+     */
+    void AllocatePyramid(const cv::Size &size);
+
+    /**
+     * Arena de memoria única para todos los niveles de la pirámide con sus bordes.
+     * Cada nivel empieza en un bloque alineado a 64 bytes, y sus filas también están alineadas.
+     */
+    cv::Mat mPyramidArena;
+
+    /**
+     * Vistas sobre mPyramidArena de cada nivel incluyendo el borde de EDGE_THRESHOLD píxeles.
+     * mvImagePyramid son vistas sin borde dentro de éstas.
+     */
+    std::vector<cv::Mat> mvPyramidBordered;
+
+    /** Tamaño de imagen para el que está reservada la arena.  (0,0) antes del primer cuadro.*/
+    cv::Size mPyramidSize;
+
     /**
      * Detecta puntos singulares, y los dispersa con ORBextractor::DistributeOctTree.
      *
@@ -269,6 +405,52 @@ protected:
      */
     void ComputeKeyPointsOctTree(std::vector<std::vector<cv::KeyPoint> >& allKeypoints);
 
+    /**
+     * Detecta, dispersa y orienta los puntos singulares de un único nivel de la pirámide.
+     * Sólo lee mvImagePyramid[level] y escribe keypoints, de modo que los niveles se pueden procesar en paralelo.
+     *
+     * @param level Nivel de la pirámide.
+     * @param keypoints Puntos singulares del nivel, resultado del proceso.
+     *
+     * Invocado sólo desde ORBextractor::ComputeKeyPointsOctTree.
+     */
+    void ComputeKeyPointsLevel(const int level, std::vector<cv::KeyPoint>& keypoints);
+
+    /**
+     * Desenfoca el nivel y computa los descriptores de sus puntos singulares en una única pasada.
+     * Divide el nivel en teselas y sólo desenfoca las que tocan los parches de los puntos singulares,
+     * en un buffer que se reutiliza entre cuadros.
+     * Los descriptores son idénticos a los obtenidos desenfocando el nivel completo.
+     *
+     * @param level Nivel de la pirámide.
+     * @param keypoints Puntos singulares del nivel, en coordenadas del nivel.
+     * @param descriptors Matriz de keypoints.size() x 32 donde se escriben los descriptores.
+     *
+     * Invocado sólo desde ORBextractor::operator().
+     */
+    void ComputeDescriptorsLevel(const int level, const std::vector<cv::KeyPoint>& keypoints, cv::Mat& descriptors);
+
+    /**
+     * Memoria de trabajo de ComputeDescriptorsLevel para un nivel de la pirámide.
+     * Conserva su capacidad entre cuadros.
+     */
+    struct TrabajoDescriptores{
+    	/** Nivel desenfocado.  Sólo las teselas necesarias tienen datos válidos.*/
+    	cv::Mat imagenDesenfocada;
+
+    	/** 1 si la tesela toca el parche de algún punto singular.  Teselas por filas.*/
+    	std::vector<uchar> vTeselaNecesaria;
+
+    	/** Índices de los puntos singulares ordenados por fila de teselas.*/
+    	std::vector<int> vIndices;
+
+    	/** Inicio de cada fila de teselas en vIndices, con un elemento final adicional.*/
+    	std::vector<int> vInicioFila;
+
+    	/** Posición de inserción por fila, auxiliar del ordenamiento por conteo.*/
+    	std::vector<int> vPosicion;
+    };
+
     /**
      * Distribuye puntos singulares con un octTree.
      * Recibe una cantidad de puntos singulaes mucho mayor a la deseada, este método elimina la mayoría de manera que los puntos sobrevivientes se encuentren dispersos en la imagen de manera homogénea.
@@ -289,6 +471,20 @@ protected:
     std::vector<cv::KeyPoint> DistributeOctTree(const std::vector<cv::KeyPoint>& vToDistributeKeys, const int &minX,
                                            const int &maxX, const int &minY, const int &maxY, const int &nFeatures, const int &level);
 
+    /**
+     * Divide un nodo en 4, creando los hijos al final de arena.vNodes.
+     * Particiona el rango de puntos singulares del nodo en los rangos de los hijos, preservando el orden,
+     * escribiéndolos en el otro buffer de la arena.
+     * Notar que no agrega los hijos a la lista de nodos vivos ni quita al padre, de eso se encarga el método que invoca.
+     *
+     * @param arena Memoria de trabajo del nivel.
+     * @param nodo Índice del nodo a dividir.
+     * @param hijos Índices de los cuatro hijos creados, resultado.
+     *
+     * Invocado sólo desde ORBextractor::DistributeOctTree .
+     */
+    static void DivideNode(QuadtreeArena &arena, const int nodo, int hijos[4]);
+
     /**
      * Coordenadas BRIEF.
      * Cada renglón contiene un par de coordenadas x,y cuyas intensidades se comparan para obtener un bit del descriptor binario.
@@ -332,11 +528,33 @@ protected:
 
     /**
      * Cantidad de puntos singulares deseados por cada nivel de la pirámide.
-     * Todos sus valores se calculan a partir de nfeatures.
-     * Vector de longitud nlevels.
+     * Todos sus valores se calculan a partir de nfeatures, o del presupuesto establecido con SetPresupuesto.
+     * Vector de longitud nlevels.  Los niveles no usados tienen 0.
      */
     std::vector<int> mnFeaturesPerLevel;
 
+    /**
+     * Imagen integral de la máscara binarizada del cuadro en proceso, CV_32S de (filas+1) x (columnas+1).
+     * Vacía si no hay máscara.  ComputeKeyPointsLevel la consulta para saber qué celdas tocan las regiones de interés.
+     */
+    cv::Mat mIntegralMascara;
+
+    /** Máscara binarizada en 0 y 1, auxiliar para la imagen integral.  Conserva su memoria entre cuadros.*/
+    cv::Mat mMascaraBinaria;
+
+    /** Presupuesto actual de puntos singulares, nfeatures salvo que SetPresupuesto lo reduzca.*/
+    int mnFeaturesPresupuesto;
+
+    /** Cantidad de niveles usados, nlevels salvo que SetPresupuesto lo reduzca.*/
+    int mnNivelesUsados;
+
+    /**
+     * Calcula mnFeaturesPerLevel para el presupuesto indicado.
+     *
+     * Invocado desde el constructor y SetPresupuesto.
+     */
+    void DistribuirFeatures(const int nFeatures, const int nNiveles);
+
     /**
      * Borde del parche circular de diámetro 31.
      * umax es un vector de ´HALF_PATCH_SIZE + 1´ elementos, con el límite de cada línea en un cuarto de circunferencia.
@@ -370,6 +588,25 @@ protected:
      * El vector se escribe solamente en el constructor.
      */
     std::vector<float> mvInvLevelSigma2;
+
+    /**
+     * Pool de hilos para procesar los niveles de la pirámide en paralelo.
+     * NULL si se procesa con un único hilo.
+     * Se crea en el constructor y se destruye en el destructor.
+     */
+    WorkerPool* mpWorkerPool;
+
+    /**
+     * Memoria de trabajo de DistributeOctTree, una por nivel de la pirámide.
+     * Se reutiliza entre cuadros.
+     */
+    std::vector<QuadtreeArena> mvQuadtree;
+
+    /**
+     * Memoria de trabajo de ComputeDescriptorsLevel, una por nivel de la pirámide.
+     * Se reutiliza entre cuadros.
+     */
+    std::vector<TrabajoDescriptores> mvTrabajoDescriptores;
 };
 
 } //namespace ORB_SLAM
@@ -40,8 +40,9 @@ namespace ORB_SLAM2
  * Las pocas propiedades son protegidas, corresponden a la configuración establecida en la construcción.
  * No confundir con la clase ORBextractor, de nombre similar, que empaqueta todos los métodos de extracción de descriptores.
  * Todos los métodos son invocados desde otros objetos.
- * Solamente DescriptorDistance, que computa la distancia entre dos descriptores con el algoritmo de Stanford,
+ * Solamente DescriptorDistances, que computa la distancia de un descriptor contra un lote de candidatos,
  * es invocado también internamente por prácticamente todos los otros métodos de ORBMatcher.
+ * DescriptorDistance es su versión para un único par de descriptores.
  *
  * Mientras ORBextractor se ocupa de detectar puntos singulares y extraer descriptores ORB,
  * ORBmatcher se ocupa de machear de diversas maneras:
@@ -71,7 +72,19 @@ public:
 	ORBmatcher(float nnratio=0.6, bool checkOri=true);
 
     // Computes the Hamming distance between two ORB descriptors
-    static int DescriptorDistance(const cv::Mat &a, const cv::Mat &b);
+    static int DescriptorDistance(const uchar *a, const uchar *b);
+
+    /**
+     * Distancias de Hamming entre un descriptor y n descriptores candidatos, en lote.
+     * Elige el núcleo una única vez según el procesador: AVX2, popcnt o escalar.
+     * Todos dan el mismo resultado que DescriptorDistance.
+     *
+     * @param a Descriptor de consulta, de 32 bytes, como Descriptor::ptr() o Descriptores::ptr(i).
+     * @param vpB Punteros a los n descriptores candidatos, de 32 bytes cada uno.
+     * @param n Cantidad de candidatos.
+     * @param distancias Resultado, arreglo contiguo de n distancias, en el orden de vpB.
+     */
+    static void DescriptorDistances(const uchar *a, const uchar* const* vpB, const int n, int *distancias);
 
     /**
      * Macheo en ventana cuadrada entre puntos singulares detectados en el cuadro actual, y la proyección de los puntos del mapa que deberían ser vistos.
@@ -333,6 +346,38 @@ protected:
      */
     void ComputeThreeMaxima(std::vector<int>* histo, const int L, int &ind1, int &ind2, int &ind3);
 
+    ///@{
+    //@{
+    /**
+     * Lote de candidatos para DistanciasCandidatos.
+     * Los métodos de macheo acumulan los puntos singulares que pasan sus filtros y luego computan todas las distancias juntas.
+     * mvCandidatos tiene los índices de los puntos singulares, mvpDescriptoresCandidatos sus descriptores, y mvDistancias el resultado.
+     * Se reutilizan entre puntos y entre invocaciones, para no reservar memoria.
+     */
+    std::vector<size_t> mvCandidatos;
+    std::vector<const uchar*> mvpDescriptoresCandidatos;
+    std::vector<int> mvDistancias;
+    ///@}
+    //@}
+
+    /**
+     * Índices devueltos por GetFeaturesInArea.
+     * Se reutiliza entre consultas, de modo que los bucles de macheo no reservan memoria por cada punto proyectado.
+     */
+    std::vector<size_t> mvIndicesArea;
+
+    /** Vacía el lote de candidatos.*/
+    void LimpiarCandidatos(){mvCandidatos.clear(); mvpDescriptoresCandidatos.clear();}
+
+    /** Agrega un candidato al lote.*/
+    void AgregarCandidato(const size_t idx, const uchar *descriptor){mvCandidatos.push_back(idx); mvpDescriptoresCandidatos.push_back(descriptor);}
+
+    /**
+     * Computa en lote las distancias entre el descriptor a y los candidatos acumulados.
+     * @returns Distancias, en el orden de mvCandidatos.
+     */
+    const int* DistanciasCandidatos(const uchar *a);
+
     /**
      * Nearest neighbor ratio.
      * Al buscar los dos mejores distancias, se procura que la mejor sea mayor a un porcentaje (mfNNratio) de la segunda.
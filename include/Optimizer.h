@@ -153,7 +153,7 @@ public:
 			optimizer.addVertex(vSE3);
 
 			g2o::VertexSBAPointXYZ* vPoint = new g2o::VertexSBAPointXYZ();
-        	vPoint->setEstimate(Converter::toVector3d(pMP->GetWorldPos()));
+        	vPoint->setEstimate(pMP->GetWorldPos3f().cast<double>());
         	vPoint->setId(id del vertex);
         	vPoint->setMarginalized(true);
         	optimizer.addVertex(vPoint);
@@ -583,6 +583,20 @@ public:
   */
   void deserialize(const SerializedPosition&, Mat&);
 
+#ifndef OSMAP_DUMMY_MAP
+  /**
+  Serialize 3D mappoint position, a fixed size Eigen vector.
+  All 3 fields required.
+  */
+  void serialize(const Eigen::Vector3f&, SerializedPosition*);
+
+  /**
+  Reconstructs 3D mappoint position in a fixed size Eigen vector.
+  All 3 fields required.
+  */
+  void deserialize(const SerializedPosition&, Eigen::Vector3f&);
+#endif
+
 
   // KeyPoint ====================================================================================================
   /**
@@ -0,0 +1,55 @@
+/*
+ * SE3f.h
+ *
+ *  Created on: 17 oct. 2026
+ *      Author: alejandro
+ */
+
+#ifndef INCLUDE_SE3F_H_
+#define INCLUDE_SE3F_H_
+
+#include <eigen3/Eigen/Dense>
+
+namespace ORB_SLAM2{
+
+/**
+ * Pose de tamaño fijo: rototraslación rígida en float, sin memoria dinámica.
+ *
+ * Reemplaza a las matrices cv::Mat de 4x4 en los caminos calientes (proyección de puntos en isInFrustum,
+ * SearchByProjection y Fuse), donde cada cv::Mat y cada clone() era una asignación en el heap.
+ * Las conversiones con cv::Mat están en Converter, y se usan sólo en el límite con la API de OpenCV.
+ *
+ * Eigen::Matrix3f y Eigen::Vector3f no son tipos vectorizables de tamaño fijo (36 y 12 bytes),
+ * de modo que pueden ser miembros de clases creadas con new sin requerir EIGEN_MAKE_ALIGNED_OPERATOR_NEW.
+ */
+struct SE3f{
+	/** Rotación.*/
+	Eigen::Matrix3f R;
+
+	/** Traslación.*/
+	Eigen::Vector3f t;
+
+	/** Identidad.*/
+	SE3f(): R(Eigen::Matrix3f::Identity()), t(Eigen::Vector3f::Zero()){}
+
+	SE3f(const Eigen::Matrix3f &R_, const Eigen::Vector3f &t_): R(R_), t(t_){}
+
+	/** Transforma un punto: R*p + t.*/
+	Eigen::Vector3f operator*(const Eigen::Vector3f &p) const {return R*p + t;}
+
+	/** Composición de poses.*/
+	SE3f operator*(const SE3f &T) const {return SE3f(R*T.R, R*T.t + t);}
+
+	/** Transformación inversa.*/
+	SE3f inverse() const {
+		const Eigen::Matrix3f Rt = R.transpose();
+		return SE3f(Rt, -(Rt*t));
+	}
+
+	/** Centro: origen del sistema de coordenadas de destino, expresado en el de origen.  Para Tcw es la posición de la cámara en el mundo.*/
+	Eigen::Vector3f centro() const {return -(R.transpose()*t);}
+};
+
+}// namespace ORB_SLAM2
+
+#endif /* INCLUDE_SE3F_H_ */
@@ -106,6 +106,7 @@
  *		- System
  *		- Map
  *		- KeyFrameDatabase
+ *		- ORBVocabulary
  *		- MapDrawer
  *		- FrameDrawer
  *	- Clases que no se instancian, no tienen propiedades, son repositorios de métodos de clase:
@@ -113,7 +114,6 @@
  *		- Optimizer
  *
  * Cada clase se define en su propio archivo .h homónimo, excepto ORBExtractor.h define también ExtractorNode.
- * El único archivo include/ *.h que no define una clase es ORBVocabulary.h, que contiene un simple typedef.
  *
  * La carpeta Thirparty contiene versiones podadas de DBoW2 y g2o con estilos propios.
  *
@@ -0,0 +1,96 @@
+/*
+ * TablaAntidistorsion.h
+ *
+ *  Created on: 17 oct. 2026
+ *      Author: alejandro
+ */
+
+#ifndef INCLUDE_TABLAANTIDISTORSION_H_
+#define INCLUDE_TABLAANTIDISTORSION_H_
+
+#include <functional>
+#include <opencv2/core/core.hpp>
+
+namespace ORB_SLAM2{
+
+/**
+ * Tabla de antidistorsión precomputada, para antidistorsionar puntos singulares en tiempo constante.
+ *
+ * Registra las coordenadas antidistorsionadas de una grilla de nodos sobre la imagen distorsionada, separados por mnPaso píxeles.
+ * Antidistorsionar un punto es una interpolación bilineal entre los cuatro nodos que lo rodean,
+ * en lugar del modelo iterativo de cv::undistortPoints o de la proyección equidistante.
+ *
+ * Construir elige el paso más grande cuyo error de interpolación no supere un máximo,
+ * medido en el centro de cada celda contra el modelo exacto.
+ *
+ * Se construye una vez por calibración, en los cómputos iniciales de Frame.
+ * Es independiente del modelo de cámara: el modelo exacto se recibe como función.
+ */
+class TablaAntidistorsion{
+public:
+	/**
+	 * Función que antidistorsiona en el lugar una matriz de N x 1 puntos CV_32FC2, con el modelo exacto.
+	 */
+	typedef std::function<void(cv::Mat&)> Antidistorsionador;
+
+	/**
+	 * Construye la tabla para imágenes del tamaño indicado.
+	 *
+	 * Prueba pasos de 8, 4, 2 y 1 píxeles, y se queda con el primero cuyo error no supera errorMaximo.
+	 * Si ninguno lo logra la tabla queda vacía, y el usuario debe recurrir al modelo exacto.
+	 *
+	 * @param tamano Tamaño de la imagen distorsionada.
+	 * @param antidistorsionar Modelo exacto de antidistorsión.
+	 * @param errorMaximo Error máximo tolerado en píxeles.
+	 */
+	void Construir(const cv::Size &tamano, const Antidistorsionador &antidistorsionar, const float errorMaximo = 0.05f);
+
+	/** Libera la tabla.  Vacia() devuelve true.*/
+	void Liberar();
+
+	/** Indica si la tabla no fue construida.*/
+	bool Vacia() const {return mTabla.empty();}
+
+	/** Paso en píxeles entre nodos de la tabla.*/
+	int Paso() const {return mnPaso;}
+
+	/** Error máximo de interpolación medido al construir la tabla, en píxeles.*/
+	float Error() const {return mfError;}
+
+	/**
+	 * Antidistorsiona un punto de la imagen distorsionada, por interpolación bilineal.
+	 * Los puntos fuera de la imagen se extrapolan desde la celda del borde.
+	 *
+	 * @param p Punto en la imagen distorsionada.
+	 * @returns Punto antidistorsionado.
+	 */
+	cv::Point2f Antidistorsionar(const cv::Point2f &p) const{
+		const float x = p.x*mfPasoInv, y = p.y*mfPasoInv;
+		const int ix = std::min(std::max((int)x, 0), mTabla.cols-2);
+		const int iy = std::min(std::max((int)y, 0), mTabla.rows-2);
+		const float ax = x-ix, ay = y-iy;
+		const cv::Vec2f *f0 = mTabla.ptr<cv::Vec2f>(iy) + ix;
+		const cv::Vec2f *f1 = mTabla.ptr<cv::Vec2f>(iy+1) + ix;
+		const cv::Vec2f arriba = f0[0] + (f0[1]-f0[0])*ax;
+		const cv::Vec2f abajo  = f1[0] + (f1[1]-f1[0])*ax;
+		const cv::Vec2f r = arriba + (abajo-arriba)*ay;
+		return cv::Point2f(r[0], r[1]);
+	}
+
+protected:
+	/** Coordenadas antidistorsionadas de los nodos, CV_32FC2.  El nodo (i, j) corresponde al punto distorsionado (j*mnPaso, i*mnPaso).*/
+	cv::Mat mTabla;
+
+	/** Paso en píxeles entre nodos.*/
+	int mnPaso = 0;
+
+	/** Inversa de mnPaso.*/
+	float mfPasoInv = 0;
+
+	/** Error máximo medido.*/
+	float mfError = 0;
+};
+
+}// namespace ORB_SLAM2
+
+#endif /* INCLUDE_TABLAANTIDISTORSION_H_ */
@@ -37,6 +37,10 @@
 #include "MapDrawer.h"
 #include "System.h"
 #include "Frame.h"
+#include "WorkerPool.h"
+#include "FrustumLocal.h"
+#include "ContadorKeyFrames.h"
+#include "ControlPresupuesto.h"
 
 #include <mutex>
 
@@ -132,7 +136,14 @@ public:
      * A continuación invoca Track(), la máquina de estados.
      * @param im Nueva imagen a procesar.
      * @param timestamp Marca temporal puramente para registro.  ORB-SLAM2 no la utiliza, sólo la registra en el frame.
-     * @returns La pose de la cámara.
+     * @returns La pose de la cámara.  Con el pipeline activo (mpPipeline), la pose es la del cuadro anterior,
+     * o Mat vacía si en esta invocación no se rastreó ningún cuadro.
+     *
+     * Con el pipeline activo, GrabImageMonocular extrae los puntos singulares de im mientras rastrea el cuadro recibido en la invocación anterior,
+     * en dos hilos.  El nuevo cuadro queda pendiente en mFramePendiente hasta la siguiente invocación.
+     * La primera invocación después de iniciar o de Reset se procesa en secuencia, como sin pipeline.
+     *
+     * Con el control de presupuesto activo (Tracking.deadlineMs), mide el tiempo del cuadro y ajusta el presupuesto de mpORBextractorLeft.
      *
      * GrabImageMonocular se invoca exclusivamente desde System::TrackMonocular, que a su vez es invocada exclusivamente desde el bucle principal en main.
      *
@@ -232,6 +243,88 @@ public:
     /** Agregado, imagen de entrada para visualización.  Se registra en GrabImage*/
     //cv::Mat imagenEntrada;
 
+    /**
+     * Pipeline de dos etapas: extracción del cuadro siguiente y tracking del actual, en paralelo.
+     * Se activa con Tracking.pipeline en el archivo de configuración.  NULL si no está activo.
+     *
+     * Aumenta la cantidad de cuadros procesados por segundo en procesadores de varios núcleos,
+     * a costa de un cuadro de latencia en la pose devuelta por GrabImageMonocular.
+     */
+    WorkerPool* mpPipeline = NULL;
+
+    /**
+     * Hilos para evaluar en paralelo los keyframes candidatos de Relocalization.
+     * Tracking.relocalizationThreads en el archivo de configuración; 0 o ausente usa todos los núcleos.
+     */
+    WorkerPool* mpPoolRelocalizacion = NULL;
+
+    /**
+     * Controlador del presupuesto de extracción por plazo.  Tracking.deadlineMs en el archivo de configuración; 0 o ausente lo desactiva.
+     * Su telemetría se muestra en FrameDrawer.
+     */
+    ControlPresupuesto mControlPresupuesto;
+
+    /** Cuadro ya extraído que espera a ser rastreado en la próxima invocación de GrabImageMonocular.  Sólo con pipeline.*/
+    Frame mFramePendiente;
+
+    /** Imagen en grises de mFramePendiente, que pasa a mImGray cuando se rastrea.*/
+    cv::Mat mImGrayPendiente;
+
+    /** Imagen de entrada de mFramePendiente, que pasa a System::imagenEntrada cuando se rastrea.*/
+    cv::Mat mImagenPendiente;
+
+    /** Indica si mFramePendiente tiene un cuadro a rastrear.  Reset y ChangeCalibration lo descartan.*/
+    bool mbHayPendiente = false;
+
+    /**
+     * Reseteo pedido por CreateInitialMapMonocular cuando la inicialización falla.
+     * Se ejecuta en ProcesarImagen después de Track, fuera de la región paralela del pipeline,
+     * porque Reset reinicia Frame::nNextId mientras la otra etapa construye un cuadro.
+     */
+    bool mbResetSolicitado = false;
+
+    /**
+     * Seguimiento por flujo óptico entre keyframes.  Se activa con Tracking.klt en el archivo de configuración.
+     * Sólo sin pipeline: el flujo necesita la imagen del cuadro antes de decidir si extrae ORB.
+     *
+     * \sa RastrearFlujo
+     */
+    bool mbFlujo = false;
+
+    /** Pirámide de Lucas-Kanade de la imagen anterior, con derivadas.  Vacía si no hay imagen anterior utilizable.*/
+    std::vector<cv::Mat> mvPiramideFlujoAnterior;
+
+    /** Pirámide de Lucas-Kanade de la imagen actual.  Pasa a mvPiramideFlujoAnterior al terminar el cuadro.*/
+    std::vector<cv::Mat> mvPiramideFlujo;
+
+    /** Índices en mLastFrame de los puntos singulares seguidos por RastrearFlujo.  Reutilizado de cuadro a cuadro.*/
+    std::vector<int> mvIndicesFlujo;
+
+    /** Posiciones de los puntos seguidos en la imagen anterior y en la actual.  Reutilizados de cuadro a cuadro.*/
+    std::vector<cv::Point2f> mvPuntosFlujoAnterior, mvPuntosFlujo;
+
+    /** Estado y error de Lucas-Kanade por punto.  Reutilizados de cuadro a cuadro.*/
+    std::vector<uchar> mvEstadoFlujo;
+    std::vector<float> mvErrorFlujo;
+
+    /**
+     * Extracción en regiones de interés.  Se activa con Tracking.roi en el archivo de configuración.
+     * Sólo sin pipeline: la máscara se predice con el estado de Tracking, que en el pipeline está un cuadro atrasado.
+     *
+     * \sa ConstruirMascaraROI
+     */
+    bool mbROI = false;
+
+    /** Máscara de regiones de interés para el extractor, del tamaño de la imagen.  Reutilizada de cuadro a cuadro.*/
+    cv::Mat mMascaraROI;
+
+    /** Puntos del mapa local en coordenadas de la cámara predicha, y sus proyecciones.  Reutilizados de cuadro a cuadro.*/
+    std::vector<cv::Point3f> mvPuntosCamaraROI;
+    std::vector<cv::Point2f> mvProyeccionesROI;
+
+    /** Cuadros con máscara, para rotar los bloques de la cuota de descubrimiento.*/
+    unsigned int mnCuadrosROI = 0;
+
 
     /** Variables de inicialización.  Luego de la inicialización, estos valores están en el Frame.*/
     // Initialization Variables (Monocular)
@@ -418,6 +511,58 @@ protected:
      */
     bool TrackWithMotionModel();
 
+    /**
+     * Camino rápido de tracking por flujo óptico, alternativo a la extracción ORB con TrackWithMotionModel y TrackLocalMap.
+     *
+     * Sigue con Lucas-Kanade piramidal los puntos singulares de mLastFrame asociados a puntos del mapa,
+     * arma mCurrentFrame con ellos (sin extraer ORB) y optimiza su pose partiendo del modelo de movimiento.
+     *
+     * Falla, y el invocante debe extraer ORB y seguir por Track, si:
+     * - el estado no es OK, no hay modelo de movimiento o hubo una relocalización reciente,
+     * - se siguen pocos puntos o pocos resultan inliers (cae la calidad del flujo),
+     * - NeedNewKeyFrame pide un keyframe, que debe construirse con ORB.
+     *
+     * Requiere mvPiramideFlujo de la imagen actual.
+     *
+     * @param timestamp Marca de tiempo del cuadro.
+     * @returns true si registró la pose del cuadro y completó el tracking.
+     *
+     * Invocado sólo desde GrabImageMonocular, si mbFlujo.
+     */
+    bool RastrearFlujo(const double &timestamp);
+
+    /**
+     * Construye mMascaraROI para extraer ORB sólo donde se espera observar el mapa local, más una cuota de descubrimiento.
+     *
+     * Proyecta los puntos del mapa local con la pose predicha por el modelo de movimiento,
+     * aplicando la distorsión del modelo de cámara, pues el extractor trabaja sobre la imagen distorsionada.
+     * Marca un cuadrado alrededor de cada proyección.
+     * Para descubrir puntos nuevos, divide la imagen en bloques y marca completos los menos cubiertos,
+     * rotando entre cuadros para recorrer toda la imagen.
+     *
+     * No construye la máscara, y el cuadro se extrae completo, si el estado no es OK, no hay modelo de movimiento,
+     * hubo una relocalización reciente, se proyectan pocos puntos o la máscara cubre casi toda la imagen.
+     *
+     * @param tamano Tamaño de la imagen.
+     * @returns true si construyó la máscara.
+     *
+     * Invocado sólo desde ProcesarImagen, si mbROI.
+     */
+    bool ConstruirMascaraROI(const cv::Size &tamano);
+
+    /**
+     * Procesa la imagen como describe GrabImageMonocular, sin control de presupuesto.
+     *
+     * Invocado sólo desde GrabImageMonocular.
+     */
+    cv::Mat ProcesarImagen(const cv::Mat &im, const double &timestamp);
+
+    /**
+     * Actualiza mVelocity con la pose de mCurrentFrame respecto de mLastFrame.
+     * Invocado desde Track y RastrearFlujo cuando el tracking es bueno.
+     */
+    void ActualizarModeloMovimiento();
+
     /**
      * Dispara una relocalización.
      *
@@ -557,6 +702,15 @@ protected:
 
     /** Mapa local, lista de puntos 3D.*/
     std::vector<MapPoint*> mvpLocalMapPoints;
+
+    /** Prueba de frustum por lotes para mvpLocalMapPoints, usada en SearchLocalPoints.  Reutiliza sus arreglos de cuadro a cuadro.*/
+    FrustumLocal mFrustumLocal;
+
+    /** Votos de keyframes en UpdateLocalKeyFrames, reutilizado de cuadro a cuadro.*/
+    ContadorKeyFrames mContadorKF;
+
+    /** Keyframes observadores de un punto, vector reutilizado en UpdateLocalKeyFrames.*/
+    std::vector<KeyFrame*> mvpObservadores;
     
     /**Sistema.
      * Única instancia.
@@ -630,6 +784,13 @@ private:
     //Color order (true RGB, false BGR, ignored if grayscale)
     bool mbRGB;
 
+    /**
+     * Convierte la imagen de entrada a grises, sabiendo por el archivo de configuración si es RGB o BGR.
+     * @param im Imagen de entrada, en grises, color o color con transparencia.
+     * @returns Imagen en grises.  Si im ya está en grises, la misma im sin copiar.
+     */
+    cv::Mat ConvertirAGrises(const cv::Mat &im);
+
     list<MapPoint*> mlpTemporalPoints;
 };
 
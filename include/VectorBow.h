@@ -0,0 +1,110 @@
+/*
+ * VectorBow.h
+ *
+ *  Created on: 17 oct. 2026
+ *      Author: alejandro
+ */
+
+#ifndef INCLUDE_VECTORBOW_H_
+#define INCLUDE_VECTORBOW_H_
+
+#include <vector>
+#include <algorithm>
+#include "../Thirdparty/DBoW2/DBoW2/BowVector.h"
+#include "../Thirdparty/DBoW2/DBoW2/FeatureVector.h"
+
+namespace ORB_SLAM2{
+
+/**
+ * Vector BoW plano: palabras ordenadas y sus pesos, en arreglos paralelos.
+ *
+ * Reemplaza a DBoW2::BowVector, un std::map con un nodo de árbol por palabra, en Frame y KeyFrame.
+ * Se construye una única vez en ComputeBoW y luego sólo se lee,
+ * de modo que el recorrido para puntuar es secuencial y la memoria por keyframe es la mínima.
+ */
+class VectorBow{
+public:
+	/** Construye el vector a partir del BowVector de DBoW2, ya normalizado.*/
+	void Construir(const DBoW2::BowVector &v);
+
+	/**
+	 * Construye el vector a partir de la palabra y el peso de cada descriptor, como DBoW2 con TF_IDF:
+	 * acumula los pesos de cada palabra y normaliza en L1.
+	 */
+	void Construir(const std::vector<DBoW2::WordId> &palabras, const std::vector<DBoW2::WordValue> &pesos);
+
+	void clear(){mvPalabras.clear(); mvPesos.clear();}
+	size_t size() const {return mvPalabras.size();}
+	bool empty() const {return mvPalabras.empty();}
+
+	/** Palabras, en orden creciente.*/
+	const std::vector<DBoW2::WordId> &Palabras() const {return mvPalabras;}
+
+	/** Pesos, paralelo a Palabras.*/
+	const std::vector<DBoW2::WordValue> &Pesos() const {return mvPesos;}
+
+	/**
+	 * Puntaje L1 entre dos vectores normalizados en L1, igual al de DBoW2::L1Scoring:
+	 * 1 - ||v-w||/2, con ||v-w|| = 2 + suma de |vi-wi| - |vi| - |wi| sobre las palabras comunes (Nister, 2006).
+	 *
+	 * El vocabulario ORB de ORB-SLAM2 usa TF_IDF con puntaje L1, el único que se implementa.
+	 * Reemplaza a ORBVocabulary::score.
+	 */
+	static double PuntajeL1(const VectorBow &v, const VectorBow &w);
+
+protected:
+	std::vector<DBoW2::WordId> mvPalabras;
+	std::vector<DBoW2::WordValue> mvPesos;
+};
+
+/**
+ * Vector de features plano: nodos del vocabulario ordenados, con los índices de sus puntos singulares en formato CSR.
+ *
+ * Reemplaza a DBoW2::FeatureVector, un std::map con un vector de índices por nodo.
+ * Los índices del nodo i son el rango [Inicio(i), Fin(i)) de un único arreglo.
+ *
+ * ORBmatcher::SearchByBoW recorre dos de estos vectores a la par, avanzando con LowerBound.
+ */
+class VectorFeatures{
+public:
+	/** Construye el vector a partir del FeatureVector de DBoW2.*/
+	void Construir(const DBoW2::FeatureVector &fv);
+
+	/** Construye el vector a partir del nodo de cada descriptor.  Los índices de cada nodo quedan en orden creciente.*/
+	void Construir(const std::vector<DBoW2::NodeId> &nodos);
+
+	void clear(){mvNodos.clear(); mvInicio.clear(); mvIndices.clear();}
+	size_t size() const {return mvNodos.size();}
+	bool empty() const {return mvNodos.empty();}
+
+	/** Nodo i, en orden creciente.*/
+	DBoW2::NodeId Nodo(const size_t i) const {return mvNodos[i];}
+
+	/** Primer índice de punto singular del nodo i.*/
+	const unsigned int *Inicio(const size_t i) const {return mvIndices.data() + mvInicio[i];}
+
+	/** Fin del rango de índices del nodo i.*/
+	const unsigned int *Fin(const size_t i) const {return mvIndices.data() + mvInicio[i+1];}
+
+	/**
+	 * Posición del primer nodo >= nodo, buscando desde la posición desde.
+	 * @returns size() si no hay.
+	 */
+	size_t LowerBound(const DBoW2::NodeId nodo, const size_t desde) const{
+		return std::lower_bound(mvNodos.begin()+desde, mvNodos.end(), nodo) - mvNodos.begin();
+	}
+
+protected:
+	/** Nodos, en orden creciente.*/
+	std::vector<DBoW2::NodeId> mvNodos;
+
+	/** Inicio del rango de cada nodo en mvIndices, con un elemento final adicional.*/
+	std::vector<unsigned int> mvInicio;
+
+	/** Índices de puntos singulares, agrupados por nodo.*/
+	std::vector<unsigned int> mvIndices;
+};
+
+}// namespace ORB_SLAM2
+
+#endif /* INCLUDE_VECTORBOW_H_ */
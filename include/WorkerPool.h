@@ -0,0 +1,114 @@
+/*
+ * WorkerPool.h
+ *
+ *  Created on: 17 oct. 2026
+ *      Author: alejandro
+ */
+
+#ifndef INCLUDE_WORKERPOOL_H_
+#define INCLUDE_WORKERPOOL_H_
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+namespace ORB_SLAM2{
+
+/**
+ * Conjunto persistente de hilos de trabajo, para paralelizar bucles cuyas iteraciones son independientes.
+ *
+ * Los hilos se crean una única vez en el constructor y permanecen dormidos esperando trabajo,
+ * evitando el costo de crear y destruir hilos en cada cuadro.
+ *
+ * Uso:
+ *
+ *     WorkerPool pool(4);
+ *     pool.ParallelFor(n, [&](int i){ ... });
+ *
+ * ParallelFor reparte los índices 0..n-1 entre los hilos del pool y el hilo que lo invoca, que también trabaja,
+ * y retorna cuando todas las iteraciones terminaron.
+ * No hay orden garantizado entre iteraciones: cada iteración debe escribir sólo en sus propios datos.
+ *
+ * Con un único hilo (nThreads<=1) no se crea ningún hilo y ParallelFor ejecuta el bucle secuencialmente.
+ *
+ * Usado por ORBextractor para procesar los niveles de la pirámide en paralelo.
+ */
+class WorkerPool{
+public:
+	/**
+	 * Constructor que crea los hilos.
+	 *
+	 * @param nThreads Cantidad total de hilos que trabajan en ParallelFor, incluyendo al hilo que lo invoca.  Se crean nThreads-1 hilos.
+	 * @param nombre Nombre de los hilos, para el depurador y top.  Linux limita el nombre a 15 caracteres.
+	 */
+	WorkerPool(int nThreads, const std::string &nombre = "WorkerPool");
+
+	/** Termina y espera a todos los hilos.*/
+	~WorkerPool();
+
+	/**
+	 * Ejecuta tarea(i) para cada i en 0..n-1, repartiendo las iteraciones entre los hilos.
+	 * Bloquea hasta que todas las iteraciones terminaron.
+	 *
+	 * No es reentrante: tarea no debe invocar ParallelFor del mismo pool.
+	 * Invocaciones desde hilos diferentes se serializan.
+	 *
+	 * @param n Cantidad de iteraciones.
+	 * @param tarea Cuerpo del bucle, recibe el índice de iteración.
+	 */
+	void ParallelFor(int n, const std::function<void(int)> &tarea);
+
+	/** Cantidad total de hilos que trabajan en ParallelFor, incluyendo al invocante.*/
+	int GetThreads() const {return mnThreads;}
+
+protected:
+	/** Bucle de cada hilo de trabajo: espera un lote, lo procesa y vuelve a esperar.*/
+	void Run();
+
+	/** Toma iteraciones del lote actual hasta agotarlas.*/
+	void Work();
+
+	/** Cantidad total de hilos, incluyendo al invocante.*/
+	const int mnThreads;
+
+	/** Hilos de trabajo, mnThreads-1.*/
+	std::vector<std::thread> mvThreads;
+
+	/** Serializa las invocaciones a ParallelFor.*/
+	std::mutex mMutexParallelFor;
+
+	/** Protege el estado del lote.*/
+	std::mutex mMutex;
+
+	/** Despierta a los hilos cuando hay un lote nuevo o cuando deben terminar.*/
+	std::condition_variable mcvLote;
+
+	/** Despierta al invocante cuando todos los hilos terminaron el lote.*/
+	std::condition_variable mcvFin;
+
+	/** Tarea del lote actual.*/
+	const std::function<void(int)> *mpTarea = NULL;
+
+	/** Cantidad de iteraciones del lote actual.*/
+	int mnIteraciones = 0;
+
+	/** Próxima iteración a tomar.*/
+	std::atomic<int> mnSiguiente;
+
+	/** Número de lote, se incrementa con cada ParallelFor para que los hilos distingan un lote nuevo.*/
+	unsigned long mnLote = 0;
+
+	/** Hilos que todavía no terminaron el lote actual.*/
+	int mnActivos = 0;
+
+	/** Señal para que los hilos terminen.*/
+	bool mbFinish = false;
+};
+
+}// namespace ORB_SLAM2
+
+#endif /* INCLUDE_WORKERPOOL_H_ */
@@ -0,0 +1,22 @@
+/*
+ * ContadorKeyFrames.cc
+ *
+ *  Created on: 17 oct. 2026
+ *      Author: alejandro
+ */
+
+#include "ContadorKeyFrames.h"
+#include <algorithm>
+
+namespace ORB_SLAM2{
+
+void ContadorKeyFrames::Iniciar(){
+	mvpKeyFrames.clear();
+	if(++mnEpoca == 0){
+		// Desborde del sello: se limpian los sellos para que ninguno coincida por error
+		std::fill(mvEpoca.begin(), mvEpoca.end(), 0);
+		mnEpoca = 1;
+	}
+}
+
+}// namespace ORB_SLAM2
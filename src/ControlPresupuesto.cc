@@ -0,0 +1,90 @@
+/*
+ * ControlPresupuesto.cc
+ *
+ *  Created on: 17 oct. 2026
+ *      Author: alejandro
+ */
+
+#include "ControlPresupuesto.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace ORB_SLAM2{
+
+// Por debajo de esta cantidad de inliers se prioriza la calidad: TrackLocalMap falla con menos de 30
+static const int INLIERS_MINIMOS = 60;
+
+// Fracción del presupuesto configurado por debajo de la cual no se reducen los puntos singulares
+static const float FRACCION_FEATURES_MINIMA = 0.3f;
+
+// Peso del último cuadro en el tiempo suavizado
+static const float ALFA = 0.2f;
+
+// Holgura: por debajo de esta fracción del plazo se recupera presupuesto
+static const float HOLGURA = 0.8f;
+
+// Límites del factor de radio de búsqueda
+static const float RADIO_MINIMO = 0.75f, RADIO_MAXIMO = 1.5f;
+
+void ControlPresupuesto::Configurar(const float plazo, const int nFeatures, const int nNiveles){
+	mnFeaturesMax = nFeatures;
+	mnNivelesMax = nNiveles;
+	mnFeaturesMin = max(1, (int)(FRACCION_FEATURES_MINIMA*nFeatures));
+	mnNivelesMin = max(1, (nNiveles+1)/2);
+	mbPrimero = true;
+
+	mTelemetria = Telemetria();
+	mTelemetria.activo = plazo>0;
+	mTelemetria.plazo = plazo;
+	mTelemetria.features = nFeatures;
+	mTelemetria.niveles = nNiveles;
+}
+
+void ControlPresupuesto::Registrar(const float tiempo, const int inliers, const bool trackingOk){
+	Telemetria &t = mTelemetria;
+	if(!t.activo)
+		return;
+
+	t.tiempo = tiempo;
+	t.inliers = inliers;
+	t.tiempoSuavizado = mbPrimero? tiempo : (1-ALFA)*t.tiempoSuavizado + ALFA*tiempo;
+	mbPrimero = false;
+
+	if(!trackingOk){
+		// Inicialización o relocalización: presupuesto completo
+		t.features = mnFeaturesMax;
+		t.niveles = mnNivelesMax;
+		t.factorRadio = 1;
+		t.decision = RECUPERAR_CALIDAD;
+	} else if(inliers < INLIERS_MINIMOS){
+		// Tracking débil: más puntos, niveles y radio, aunque se exceda el plazo
+		t.features = min(mnFeaturesMax, (int)(t.features*1.2f) + 1);
+		if(t.features == mnFeaturesMax)
+			t.niveles = mnNivelesMax;
+		t.factorRadio = min(RADIO_MAXIMO, max(1.0f, t.factorRadio*1.25f));
+		t.decision = RECUPERAR_CALIDAD;
+	} else if(t.tiempoSuavizado > t.plazo){
+		// Plazo excedido: reducción proporcional al exceso, a lo sumo 30% por cuadro
+		t.factorRadio = max(RADIO_MINIMO, min(1.0f, t.factorRadio*0.9f));
+		if(t.features > mnFeaturesMin)
+			t.features = max(mnFeaturesMin, (int)(t.features*max(0.7f, t.plazo/t.tiempoSuavizado)));
+		else if(t.niveles > mnNivelesMin)
+			t.niveles--;
+		t.decision = REDUCIR;
+	} else if(t.tiempoSuavizado < HOLGURA*t.plazo){
+		// Holgura: se recupera lentamente, niveles primero
+		t.factorRadio = t.factorRadio<1? min(1.0f, t.factorRadio*1.1f) : max(1.0f, t.factorRadio*0.95f);
+		if(t.niveles < mnNivelesMax){
+			t.niveles++;
+			t.decision = AUMENTAR;
+		} else if(t.features < mnFeaturesMax){
+			t.features = min(mnFeaturesMax, (int)(t.features*1.05f) + 1);
+			t.decision = AUMENTAR;
+		} else
+			t.decision = MANTENER;
+	} else
+		t.decision = MANTENER;
+}
+
+}// namespace ORB_SLAM2
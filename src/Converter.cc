@@ -34,6 +34,11 @@ std::vector<cv::Mat> Converter::toDescriptorVector(const cv::Mat &Descriptors)
     return vDesc;
 }
 
+std::vector<cv::Mat> Converter::toDescriptorVector(const Descriptores &Descriptors)
+{
+    return toDescriptorVector(Descriptors.toMat());
+}
+
 g2o::SE3Quat Converter::toSE3Quat(const cv::Mat &cvT)
 {
     Eigen::Matrix<double,3,3> R;
@@ -135,6 +140,56 @@ Eigen::Matrix<double,3,3> Converter::toMatrix3d(const cv::Mat &cvMat3)
     return M;
 }
 
+cv::Mat Converter::toCvMat(const Eigen::Vector3f &v)
+{
+    cv::Mat cvMat(3,1,CV_32F);
+    for(int i=0;i<3;i++)
+        cvMat.at<float>(i)=v(i);
+
+    return cvMat;
+}
+
+cv::Mat Converter::toCvMat(const Eigen::Matrix3f &m)
+{
+    cv::Mat cvMat(3,3,CV_32F);
+    for(int i=0;i<3;i++)
+        for(int j=0; j<3; j++)
+            cvMat.at<float>(i,j)=m(i,j);
+
+    return cvMat;
+}
+
+cv::Mat Converter::toCvMat(const SE3f &T)
+{
+    cv::Mat cvMat = cv::Mat::eye(4,4,CV_32F);
+    for(int i=0;i<3;i++)
+    {
+        for(int j=0;j<3;j++)
+            cvMat.at<float>(i,j)=T.R(i,j);
+        cvMat.at<float>(i,3)=T.t(i);
+    }
+
+    return cvMat;
+}
+
+Eigen::Vector3f Converter::toVector3f(const cv::Mat &cvVector)
+{
+    return Eigen::Vector3f(cvVector.at<float>(0), cvVector.at<float>(1), cvVector.at<float>(2));
+}
+
+SE3f Converter::toSE3f(const cv::Mat &cvT)
+{
+    SE3f T;
+    for(int i=0;i<3;i++)
+    {
+        for(int j=0;j<3;j++)
+            T.R(i,j)=cvT.at<float>(i,j);
+        T.t(i)=cvT.at<float>(i,3);
+    }
+
+    return T;
+}
+
 std::vector<float> Converter::toQuaternion(const cv::Mat &M)
 {
     Eigen::Matrix<double,3,3> eigMat = toMatrix3d(M);
@@ -0,0 +1,94 @@
+/*
+ * Descriptores.cc
+ *
+ *  Created on: 17 oct. 2026
+ *      Author: alejandro
+ */
+
+#include "Descriptores.h"
+#include <cstdlib>
+#include <new>
+
+namespace ORB_SLAM2{
+
+Descriptor::Descriptor(const cv::Mat &m){
+	CV_Assert(m.rows == 1 && m.cols == BYTES && m.type() == CV_8U);
+	memcpy(datos, m.ptr(), BYTES);
+}
+
+Descriptores::Descriptores(): mpDatos(NULL), mnFilas(0), mnCapacidad(0){}
+
+Descriptores::Descriptores(int n): mpDatos(NULL), mnFilas(0), mnCapacidad(0){
+	create(n);
+}
+
+Descriptores::Descriptores(const cv::Mat &m): mpDatos(NULL), mnFilas(0), mnCapacidad(0){
+	if(m.empty())
+		return;
+	CV_Assert(m.cols == Descriptor::BYTES && m.type() == CV_8U);
+	create(m.rows);
+	for(int i=0; i<m.rows; i++)
+		memcpy(ptr(i), m.ptr(i), Descriptor::BYTES);
+}
+
+Descriptores::Descriptores(const Descriptores &otro): mpDatos(NULL), mnFilas(0), mnCapacidad(0){
+	*this = otro;
+}
+
+Descriptores::Descriptores(Descriptores &&otro):
+	mpDatos(otro.mpDatos), mnFilas(otro.mnFilas), mnCapacidad(otro.mnCapacidad)
+{
+	otro.mpDatos = NULL;
+	otro.mnFilas = otro.mnCapacidad = 0;
+}
+
+Descriptores& Descriptores::operator=(const Descriptores &otro){
+	if(this != &otro){
+		create(otro.mnFilas);
+		if(mnFilas)
+			memcpy(mpDatos, otro.mpDatos, mnFilas*Descriptor::BYTES);
+	}
+	return *this;
+}
+
+Descriptores& Descriptores::operator=(Descriptores &&otro){
+	if(this != &otro){
+		release();
+		mpDatos = otro.mpDatos;
+		mnFilas = otro.mnFilas;
+		mnCapacidad = otro.mnCapacidad;
+		otro.mpDatos = NULL;
+		otro.mnFilas = otro.mnCapacidad = 0;
+	}
+	return *this;
+}
+
+Descriptores::~Descriptores(){
+	release();
+}
+
+void Descriptores::create(int n){
+	if(n > mnCapacidad){
+		release();
+		void *p;
+		if(posix_memalign(&p, 32, n*Descriptor::BYTES))
+			throw std::bad_alloc();
+		mpDatos = (uchar*)p;
+		mnCapacidad = n;
+	}
+	mnFilas = n;
+}
+
+void Descriptores::release(){
+	free(mpDatos);
+	mpDatos = NULL;
+	mnFilas = mnCapacidad = 0;
+}
+
+cv::Mat Descriptores::toMat() const{
+	if(!mnFilas)
+		return cv::Mat();
+	return cv::Mat(mnFilas, Descriptor::BYTES, CV_8U, mpDatos);
+}
+
+}// namespace ORB_SLAM2
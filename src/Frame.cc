@@ -31,36 +31,34 @@ bool Frame::mbInitialComputations=true;
 float Frame::cx, Frame::cy, Frame::fx, Frame::fy, Frame::invfx, Frame::invfy;
 float Frame::mnMinX, Frame::mnMinY, Frame::mnMaxX, Frame::mnMaxY;
 float Frame::mfGridElementWidthInv, Frame::mfGridElementHeightInv;
+TablaAntidistorsion Frame::mTablaAntidistorsion;
 
-Frame::Frame()
+Frame::Frame():
+    mpCaracteristicas(std::make_shared<CaracteristicasFrame>())
 {}
 
 //Copy Constructor
 Frame::Frame(const Frame &frame)
     :mpORBvocabulary(frame.mpORBvocabulary), mpORBextractorLeft(frame.mpORBextractorLeft),
-     mTimeStamp(frame.mTimeStamp), mK(frame.mK.clone()), mDistCoef(frame.mDistCoef.clone()),
-     /*mbf(frame.mbf), mb(frame.mb), mThDepth(frame.mThDepth), */N(frame.N), mvKeys(frame.mvKeys),
-     mvKeysUn(frame.mvKeysUn), mBowVec(frame.mBowVec), mFeatVec(frame.mFeatVec),
-     mDescriptors(frame.mDescriptors.clone()),
+     mTimeStamp(frame.mTimeStamp), mK(frame.mK.clone()), mDistCoef(frame.mDistCoef.clone()), camaraModo(frame.camaraModo),
+     /*mbf(frame.mbf), mb(frame.mb), mThDepth(frame.mThDepth), */N(frame.N),
+     mpCaracteristicas(frame.mpCaracteristicas), mBowVec(frame.mBowVec), mFeatVec(frame.mFeatVec),
      mvpMapPoints(frame.mvpMapPoints), mvbOutlier(frame.mvbOutlier), mnId(frame.mnId),
      mpReferenceKF(frame.mpReferenceKF), mnScaleLevels(frame.mnScaleLevels),
      mfScaleFactor(frame.mfScaleFactor), mfLogScaleFactor(frame.mfLogScaleFactor),
      mvScaleFactors(frame.mvScaleFactors), mvInvScaleFactors(frame.mvInvScaleFactors),
      mvLevelSigma2(frame.mvLevelSigma2), mvInvLevelSigma2(frame.mvInvLevelSigma2)
 {
-    for(int i=0;i<FRAME_GRID_COLS;i++)
-        for(int j=0; j<FRAME_GRID_ROWS; j++)
-            mGrid[i][j]=frame.mGrid[i][j];
-
     if(!frame.mTcw.empty())
         SetPose(frame.mTcw);
 }
 
 
 Frame::Frame(const cv::Mat &imGray, const double &timeStamp, ORBextractor* extractor,ORBVocabulary* voc,
-		cv::Mat &K, cv::Mat &distCoef)//, const float &bf, const float &thDepth)
+		cv::Mat &K, cv::Mat &distCoef, const cv::Mat &mascara)//, const float &bf, const float &thDepth)
     :mpORBvocabulary(voc),mpORBextractorLeft(extractor),//mpORBextractorRight(static_cast<ORBextractor*>(NULL)),
-     mTimeStamp(timeStamp), mK(K.clone()),mDistCoef(distCoef.clone())//, mbf(bf), mThDepth(thDepth)
+     mTimeStamp(timeStamp), mK(K.clone()),mDistCoef(distCoef.clone()),//, mbf(bf), mThDepth(thDepth)
+     mpCaracteristicas(std::make_shared<CaracteristicasFrame>())
 {
     // Frame ID
     mnId=nNextId++;
@@ -75,25 +73,19 @@ Frame::Frame(const cv::Mat &imGray, const double &timeStamp, ORBextractor* extra
     mvInvLevelSigma2 = mpORBextractorLeft->GetInverseScaleSigmaSquares();
 
     // ORB extraction
-    ExtractORB(0,imGray);
-
-    N = mvKeys.size();
+    ExtractORB(0,imGray,mascara);
 
-    if(mvKeys.empty())
-        return;
+    N = GetKeys().size();
 
     // Deduce el modo de cámara a partir del tamaño de mDistCoef.  0 para modo 1, 5+ para modo 0, 4 para modo 2 no implementado (fisheye con distorsión)
     camaraModo = mDistCoef.rows? 0 : 1;
 
-    UndistortKeyPoints();
-
-    mvpMapPoints = vector<MapPoint*>(N,static_cast<MapPoint*>(NULL));
-    mvbOutlier = vector<bool>(N,false);
-
     // This is done only for the first Frame (or after a change in the calibration)
+    // Se hace antes de UndistortKeyPoints, que usa la tabla de antidistorsión.
     if(mbInitialComputations)
     {
         ComputeImageBounds(imGray);
+        ConstruirTablaAntidistorsion(imGray.size());
 
         mfGridElementWidthInv=static_cast<float>(FRAME_GRID_COLS)/static_cast<float>(mnMaxX-mnMinX);
         mfGridElementHeightInv=static_cast<float>(FRAME_GRID_ROWS)/static_cast<float>(mnMaxY-mnMinY);
@@ -108,29 +100,62 @@ Frame::Frame(const cv::Mat &imGray, const double &timeStamp, ORBextractor* extra
         mbInitialComputations=false;
     }
 
+    if(!N)
+        return;
+
+    UndistortKeyPoints();
+
+    mvpMapPoints = vector<MapPoint*>(N,static_cast<MapPoint*>(NULL));
+    mvbOutlier = vector<bool>(N,false);
+
     AssignFeaturesToGrid();
 }
 
-void Frame::AssignFeaturesToGrid()
+Frame::Frame(const Frame &anterior, const vector<int> &vIndices, const vector<cv::Point2f> &vPuntos, const double &timeStamp)
+    :mpORBvocabulary(anterior.mpORBvocabulary), mpORBextractorLeft(anterior.mpORBextractorLeft),
+     mTimeStamp(timeStamp), mK(anterior.mK), mDistCoef(anterior.mDistCoef), camaraModo(anterior.camaraModo),
+     mpCaracteristicas(std::make_shared<CaracteristicasFrame>())
 {
-    int nReserve = 0.5f*N/(FRAME_GRID_COLS*FRAME_GRID_ROWS);
-    for(unsigned int i=0; i<FRAME_GRID_COLS;i++)
-        for (unsigned int j=0; j<FRAME_GRID_ROWS;j++)
-            mGrid[i][j].reserve(nReserve);
-
-    for(int i=0;i<N;i++)
-    {
-        const cv::KeyPoint &kp = mvKeysUn[i];
+    // Frame ID
+    mnId=nNextId++;
 
-        int nGridPosX, nGridPosY;
-        if(PosInGrid(kp,nGridPosX,nGridPosY))
-            mGrid[nGridPosX][nGridPosY].push_back(i);
+    // Scale Level Info, la del extractor que produjo los puntos
+    mnScaleLevels = anterior.mnScaleLevels;
+    mfScaleFactor = anterior.mfScaleFactor;
+    mfLogScaleFactor = anterior.mfLogScaleFactor;
+    mvScaleFactors = anterior.mvScaleFactors;
+    mvInvScaleFactors = anterior.mvInvScaleFactors;
+    mvLevelSigma2 = anterior.mvLevelSigma2;
+    mvInvLevelSigma2 = anterior.mvInvLevelSigma2;
+
+    N = vIndices.size();
+    CaracteristicasFrame &c = *mpCaracteristicas;
+    const CaracteristicasFrame &a = *anterior.mpCaracteristicas;
+    c.mvKeys.resize(N);
+    c.mDescriptors.create(N);
+    mvpMapPoints.resize(N);
+    mvbOutlier = vector<bool>(N,false);
+    for(int i=0; i<N; i++){
+        const int j = vIndices[i];
+        c.mvKeys[i] = a.mvKeys[j];
+        c.mvKeys[i].pt = vPuntos[i];
+        memcpy(c.mDescriptors.ptr(i), a.mDescriptors.ptr(j), Descriptor::BYTES);
+        mvpMapPoints[i] = anterior.mvpMapPoints[j];
     }
+
+    UndistortKeyPoints();
+
+    AssignFeaturesToGrid();
+}
+
+void Frame::AssignFeaturesToGrid()
+{
+    mpCaracteristicas->mGrid.Construir(GetKeysUn(), mnMinX, mnMinY, mfGridElementWidthInv, mfGridElementHeightInv);
 }
 
-void Frame::ExtractORB(int flag, const cv::Mat &im)
+void Frame::ExtractORB(int flag, const cv::Mat &im, const cv::Mat &mascara)
 {
-        (*mpORBextractorLeft)(im,cv::Mat(),mvKeys,mDescriptors);
+        (*mpORBextractorLeft)(im,mascara,mpCaracteristicas->mvKeys,mpCaracteristicas->mDescriptors);
 }
 
 
@@ -142,10 +167,18 @@ void Frame::SetPose(cv::Mat Tcw)
 
 void Frame::UpdatePoseMatrices()
 { 
-    mRcw = mTcw.rowRange(0,3).colRange(0,3);
-    mRwc = mRcw.t();
-    mtcw = mTcw.rowRange(0,3).col(3);
-    mOw = -mRcw.t()*mtcw;
+    mTcw3f = Converter::toSE3f(mTcw);
+    mOw = mTcw3f.centro();
+}
+
+cv::Mat Frame::GetCameraCenter()
+{
+    return Converter::toCvMat(mOw);
+}
+
+cv::Mat Frame::GetRotationInverse()
+{
+    return Converter::toCvMat(Eigen::Matrix3f(mTcw3f.R.transpose()));
 }
 
 bool Frame::isInFrustum(MapPoint *pMP, float viewingCosLimit)
@@ -153,13 +186,13 @@ bool Frame::isInFrustum(MapPoint *pMP, float viewingCosLimit)
     pMP->mbTrackInView = false;
 
     // 3D in absolute coordinates
-    cv::Mat P = pMP->GetWorldPos(); 
+    const Eigen::Vector3f P = pMP->GetWorldPos3f();
 
     // 3D in camera coordinates
-    const cv::Mat Pc = mRcw*P+mtcw;
-    const float &PcX = Pc.at<float>(0);
-    const float &PcY= Pc.at<float>(1);
-    const float &PcZ = Pc.at<float>(2);
+    const Eigen::Vector3f Pc = mTcw3f*P;
+    const float &PcX = Pc(0);
+    const float &PcY= Pc(1);
+    const float &PcZ = Pc(2);
 
     // Check positive depth
     if(PcZ<0.0f)
@@ -178,14 +211,14 @@ bool Frame::isInFrustum(MapPoint *pMP, float viewingCosLimit)
     // Check distance is in the scale invariance region of the MapPoint
     const float maxDistance = pMP->GetMaxDistanceInvariance();
     const float minDistance = pMP->GetMinDistanceInvariance();
-    const cv::Mat PO = P-mOw;
-    const float dist = cv::norm(PO);
+    const Eigen::Vector3f PO = P-mOw;
+    const float dist = PO.norm();
 
     if(dist<minDistance || dist>maxDistance)
         return false;
 
    // Check viewing angle
-    cv::Mat Pn = pMP->GetNormal();
+    const Eigen::Vector3f Pn = pMP->GetNormal3f();
 
     const float viewCos = PO.dot(Pn)/dist;
 
@@ -209,56 +242,58 @@ bool Frame::isInFrustum(MapPoint *pMP, float viewingCosLimit)
 vector<size_t> Frame::GetFeaturesInArea(const float &x, const float  &y, const float  &r, const int minLevel, const int maxLevel) const
 {
     vector<size_t> vIndices;
-    vIndices.reserve(N);
+    GetFeaturesInArea(vIndices, x, y, r, minLevel, maxLevel);
+    return vIndices;
+}
+
+void Frame::GetFeaturesInArea(vector<size_t> &vIndices, const float &x, const float  &y, const float  &r, const int minLevel, const int maxLevel) const
+{
+    vIndices.clear();
 
     const int nMinCellX = max(0,(int)floor((x-mnMinX-r)*mfGridElementWidthInv));
     if(nMinCellX>=FRAME_GRID_COLS)
-        return vIndices;
+        return;
 
     const int nMaxCellX = min((int)FRAME_GRID_COLS-1,(int)ceil((x-mnMinX+r)*mfGridElementWidthInv));
     if(nMaxCellX<0)
-        return vIndices;
+        return;
 
     const int nMinCellY = max(0,(int)floor((y-mnMinY-r)*mfGridElementHeightInv));
     if(nMinCellY>=FRAME_GRID_ROWS)
-        return vIndices;
+        return;
 
     const int nMaxCellY = min((int)FRAME_GRID_ROWS-1,(int)ceil((y-mnMinY+r)*mfGridElementHeightInv));
     if(nMaxCellY<0)
-        return vIndices;
+        return;
 
     const bool bCheckLevels = (minLevel>0) || (maxLevel>=0);
+    const vector<cv::KeyPoint> &vKeysUn = GetKeysUn();
+    const Grilla &grilla = mpCaracteristicas->mGrid;
 
+    // Las celdas nMinCellY..nMaxCellY de cada columna son un único tramo contiguo de la grilla
     for(int ix = nMinCellX; ix<=nMaxCellX; ix++)
     {
-        for(int iy = nMinCellY; iy<=nMaxCellY; iy++)
+        const unsigned int *celda, *fin;
+        grilla.Tramo(ix, nMinCellY, nMaxCellY, celda, fin);
+        for(; celda<fin; celda++)
         {
-            const vector<size_t> vCell = mGrid[ix][iy];
-            if(vCell.empty())
-                continue;
-
-            for(size_t j=0, jend=vCell.size(); j<jend; j++)
+            const cv::KeyPoint &kpUn = vKeysUn[*celda];
+            if(bCheckLevels)
             {
-                const cv::KeyPoint &kpUn = mvKeysUn[vCell[j]];
-                if(bCheckLevels)
-                {
-                    if(kpUn.octave<minLevel)
+                if(kpUn.octave<minLevel)
+                    continue;
+                if(maxLevel>=0)
+                    if(kpUn.octave>maxLevel)
                         continue;
-                    if(maxLevel>=0)
-                        if(kpUn.octave>maxLevel)
-                            continue;
-                }
+            }
 
-                const float distx = kpUn.pt.x-x;
-                const float disty = kpUn.pt.y-y;
+            const float distx = kpUn.pt.x-x;
+            const float disty = kpUn.pt.y-y;
 
-                if(fabs(distx)<r && fabs(disty)<r)
-                    vIndices.push_back(vCell[j]);
-            }
+            if(fabs(distx)<r && fabs(disty)<r)
+                vIndices.push_back(*celda);
         }
     }
-
-    return vIndices;
 }
 
 bool Frame::PosInGrid(const cv::KeyPoint &kp, int &posX, int &posY)
@@ -277,25 +312,36 @@ bool Frame::PosInGrid(const cv::KeyPoint &kp, int &posX, int &posY)
 void Frame::ComputeBoW()
 {
     if(mBowVec.empty())
-    {
-        vector<cv::Mat> vCurrentDesc = Converter::toDescriptorVector(mDescriptors);
-        mpORBvocabulary->transform(vCurrentDesc,mBowVec,mFeatVec,4);
-    }
+        mpORBvocabulary->Transformar(GetDescriptors(),mBowVec,mFeatVec,4);
 }
 
 void Frame::UndistortKeyPoints()
 {
+    const vector<cv::KeyPoint> &vKeys = mpCaracteristicas->mvKeys;
+    vector<cv::KeyPoint> &vKeysUn = mpCaracteristicas->mvKeysUn;
+
     if(camaraModo == 0 && mDistCoef.at<float>(0)==0.0){
     	// No hace falta antidistorsionar, no hay coeficientes de distorsión, y es cámara normal (no es fisheye).
-        mvKeysUn=mvKeys;
+        vKeysUn=vKeys;
+        return;
+    }
+
+    if(!mTablaAntidistorsion.Vacia()){
+    	// Interpolación en la tabla precomputada, en lugar del modelo exacto
+        vKeysUn.resize(N);
+        for(int i=0; i<N; i++){
+            cv::KeyPoint kp = vKeys[i];
+            kp.pt = mTablaAntidistorsion.Antidistorsionar(kp.pt);
+            vKeysUn[i]=kp;
+        }
         return;
     }
 
     // Fill matrix with points
     cv::Mat mat(N,2,CV_32F);
     for(int i=0; i<N; i++){
-        mat.at<float>(i,0)=mvKeys[i].pt.x;
-        mat.at<float>(i,1)=mvKeys[i].pt.y;
+        mat.at<float>(i,0)=vKeys[i].pt.x;
+        mat.at<float>(i,1)=vKeys[i].pt.y;
     }
 
     // Undistort points
@@ -309,13 +355,13 @@ void Frame::UndistortKeyPoints()
     mat=mat.reshape(1);
 
     // Fill undistorted keypoint vector
-    mvKeysUn.resize(N);
+    vKeysUn.resize(N);
     for(int i=0; i<N; i++)
     {
-        cv::KeyPoint kp = mvKeys[i];
+        cv::KeyPoint kp = vKeys[i];
         kp.pt.x=mat.at<float>(i,0);
         kp.pt.y=mat.at<float>(i,1);
-        mvKeysUn[i]=kp;
+        vKeysUn[i]=kp;
     }
 }
 
@@ -352,6 +398,22 @@ void Frame::ComputeImageBounds(const cv::Mat &imLeft)
     }
 }
 
+void Frame::ConstruirTablaAntidistorsion(const cv::Size &tamano)
+{
+    if(camaraModo == 0 && mDistCoef.at<float>(0)==0.0){
+    	// Sin distorsión no hace falta tabla
+        mTablaAntidistorsion.Liberar();
+        return;
+    }
+
+    mTablaAntidistorsion.Construir(tamano, [this](cv::Mat &puntos){
+        if(camaraModo)
+        	antidistorsionarProyeccionEquidistante(puntos);
+        else
+        	cv::undistortPoints(puntos,puntos,mK,mDistCoef,cv::Mat(),mK);
+    });
+}
+
 void Frame::antidistorsionarProyeccionEquidistante(cv::Mat &puntos){
 	// foco y centro
 	cv::Vec2d f, c;
@@ -192,6 +192,9 @@ void FrameDrawer::DrawTextInfo(cv::Mat &im, int nState, cv::Mat &imText)
         		;
         if(mnTrackedVO>0)
             s << ", + VO matches: " << mnTrackedVO;
+        if(mTelemetria.activo)
+            s << " | " << (int)mTelemetria.tiempoSuavizado << "/" << (int)mTelemetria.plazo << " ms, ORB: " << mTelemetria.features
+              << ", niveles: " << mTelemetria.niveles;
     }
     else if(nState==Tracking::LOST){
         s << " PERDIDO.  INTENTANDO RELOCALIZAR.  Candidatos: " << relocalizacionCandidatos;
@@ -224,7 +227,8 @@ void FrameDrawer::Update(Tracking *pTracker)
 {
     unique_lock<mutex> lock(mMutex);
     pTracker->mImGray.copyTo(mIm);
-    mvCurrentKeys=pTracker->mCurrentFrame.mvKeys;
+    mTelemetria = pTracker->mControlPresupuesto.GetTelemetria();
+    mvCurrentKeys=pTracker->mCurrentFrame.GetKeys();
     N = mvCurrentKeys.size();
     mvbVO = vector<bool>(N,false);
     mvbMap = vector<bool>(N,false);
@@ -243,7 +247,7 @@ void FrameDrawer::Update(Tracking *pTracker)
 
     if(pTracker->mLastProcessedState==Tracking::NOT_INITIALIZED)
     {
-        mvIniKeys=pTracker->mInitialFrame.mvKeys;
+        mvIniKeys=pTracker->mInitialFrame.GetKeys();
         mvIniMatches=pTracker->mvIniMatches;
     }
     else if(pTracker->mLastProcessedState==Tracking::OK)
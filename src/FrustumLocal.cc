@@ -0,0 +1,232 @@
+/*
+ * FrustumLocal.cc
+ *
+ *  Created on: 17 oct. 2026
+ *      Author: alejandro
+ */
+
+#include "FrustumLocal.h"
+#include "MapPoint.h"
+#include "Frame.h"
+#include <cmath>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace ORB_SLAM2{
+
+/**
+ * Arreglos y parámetros de un lote, para los núcleos de Proyectar.
+ */
+struct LoteFrustum{
+	int n;
+	const float *x, *y, *z, *nx, *ny, *nz, *distMin, *distMax, *distEscala;
+	float *u, *v, *coseno, *nivel;
+	unsigned char *visible;
+
+	/** Pose Tcw: rotación por filas y traslación.  Centro de cámara.*/
+	float R[9], t[3], O[3];
+	float fx, fy, cx, cy;
+	float minX, maxX, minY, maxY;
+	float cosLimite;
+
+	/** Nivel mínimo, y umbrales f^k para k desde el nivel mínimo.*/
+	float nivelMin;
+	vector<float> umbrales;
+};
+
+/**
+ * Núcleo escalar, a partir del punto i0.  Completa los puntos que no llenan un registro AVX.
+ */
+static void ProyectarEscalar(LoteFrustum &L, const int i0)
+{
+	const int nUmbrales = L.umbrales.size();
+	for(int i=i0; i<L.n; i++)
+	{
+		const float x = L.x[i], y = L.y[i], z = L.z[i];
+		const float xc = L.R[0]*x + L.R[1]*y + L.R[2]*z + L.t[0];
+		const float yc = L.R[3]*x + L.R[4]*y + L.R[5]*z + L.t[1];
+		const float zc = L.R[6]*x + L.R[7]*y + L.R[8]*z + L.t[2];
+		const float invz = 1.0f/zc;
+		const float u = L.fx*xc*invz + L.cx;
+		const float v = L.fy*yc*invz + L.cy;
+
+		const float px = x-L.O[0], py = y-L.O[1], pz = z-L.O[2];
+		const float dist = sqrt(px*px + py*py + pz*pz);
+		const float coseno = (px*L.nx[i] + py*L.ny[i] + pz*L.nz[i])/dist;
+
+		const float ratio = L.distEscala[i]/dist;
+		float nivel = L.nivelMin;
+		for(int k=0; k<nUmbrales; k++)
+			nivel += ratio > L.umbrales[k];
+
+		L.u[i] = u;
+		L.v[i] = v;
+		L.coseno[i] = coseno;
+		L.nivel[i] = nivel;
+		L.visible[i] = zc>=0.0f && u>=L.minX && u<=L.maxX && v>=L.minY && v<=L.maxY &&
+				dist>=L.distMin[i] && dist<=L.distMax[i] && coseno>=L.cosLimite;
+	}
+}
+
+#if defined(__x86_64__)
+/**
+ * Núcleo AVX: 8 puntos por iteración.  Devuelve el índice del primer punto no procesado.
+ */
+__attribute__((target("avx")))
+static int ProyectarAVX(LoteFrustum &L)
+{
+	const __m256 r0 = _mm256_set1_ps(L.R[0]), r1 = _mm256_set1_ps(L.R[1]), r2 = _mm256_set1_ps(L.R[2]);
+	const __m256 r3 = _mm256_set1_ps(L.R[3]), r4 = _mm256_set1_ps(L.R[4]), r5 = _mm256_set1_ps(L.R[5]);
+	const __m256 r6 = _mm256_set1_ps(L.R[6]), r7 = _mm256_set1_ps(L.R[7]), r8 = _mm256_set1_ps(L.R[8]);
+	const __m256 t0 = _mm256_set1_ps(L.t[0]), t1 = _mm256_set1_ps(L.t[1]), t2 = _mm256_set1_ps(L.t[2]);
+	const __m256 o0 = _mm256_set1_ps(L.O[0]), o1 = _mm256_set1_ps(L.O[1]), o2 = _mm256_set1_ps(L.O[2]);
+	const __m256 fx = _mm256_set1_ps(L.fx), fy = _mm256_set1_ps(L.fy), cx = _mm256_set1_ps(L.cx), cy = _mm256_set1_ps(L.cy);
+	const __m256 minX = _mm256_set1_ps(L.minX), maxX = _mm256_set1_ps(L.maxX);
+	const __m256 minY = _mm256_set1_ps(L.minY), maxY = _mm256_set1_ps(L.maxY);
+	const __m256 cosLimite = _mm256_set1_ps(L.cosLimite);
+	const __m256 uno = _mm256_set1_ps(1.0f), cero = _mm256_setzero_ps();
+	const __m256 nivelMin = _mm256_set1_ps(L.nivelMin);
+	const int nUmbrales = L.umbrales.size();
+
+	int i=0;
+	for(; i+8<=L.n; i+=8)
+	{
+		const __m256 x = _mm256_loadu_ps(L.x+i), y = _mm256_loadu_ps(L.y+i), z = _mm256_loadu_ps(L.z+i);
+
+		// Proyección
+		const __m256 xc = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r0,x), _mm256_mul_ps(r1,y)), _mm256_mul_ps(r2,z)), t0);
+		const __m256 yc = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r3,x), _mm256_mul_ps(r4,y)), _mm256_mul_ps(r5,z)), t1);
+		const __m256 zc = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r6,x), _mm256_mul_ps(r7,y)), _mm256_mul_ps(r8,z)), t2);
+		const __m256 invz = _mm256_div_ps(uno, zc);
+		const __m256 u = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(fx,xc), invz), cx);
+		const __m256 v = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(fy,yc), invz), cy);
+
+		__m256 visible = _mm256_cmp_ps(zc, cero, _CMP_GE_OQ);
+		visible = _mm256_and_ps(visible, _mm256_cmp_ps(u, minX, _CMP_GE_OQ));
+		visible = _mm256_and_ps(visible, _mm256_cmp_ps(u, maxX, _CMP_LE_OQ));
+		visible = _mm256_and_ps(visible, _mm256_cmp_ps(v, minY, _CMP_GE_OQ));
+		visible = _mm256_and_ps(visible, _mm256_cmp_ps(v, maxY, _CMP_LE_OQ));
+
+		// Distancia
+		const __m256 px = _mm256_sub_ps(x,o0), py = _mm256_sub_ps(y,o1), pz = _mm256_sub_ps(z,o2);
+		const __m256 dist = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px,px), _mm256_mul_ps(py,py)), _mm256_mul_ps(pz,pz)));
+		visible = _mm256_and_ps(visible, _mm256_cmp_ps(dist, _mm256_loadu_ps(L.distMin+i), _CMP_GE_OQ));
+		visible = _mm256_and_ps(visible, _mm256_cmp_ps(dist, _mm256_loadu_ps(L.distMax+i), _CMP_LE_OQ));
+
+		// Ángulo de observación
+		const __m256 producto = _mm256_add_ps(_mm256_add_ps(
+				_mm256_mul_ps(px, _mm256_loadu_ps(L.nx+i)), _mm256_mul_ps(py, _mm256_loadu_ps(L.ny+i))), _mm256_mul_ps(pz, _mm256_loadu_ps(L.nz+i)));
+		const __m256 coseno = _mm256_div_ps(producto, dist);
+		visible = _mm256_and_ps(visible, _mm256_cmp_ps(coseno, cosLimite, _CMP_GE_OQ));
+
+		// Nivel de escala, contando umbrales superados
+		const __m256 ratio = _mm256_div_ps(_mm256_loadu_ps(L.distEscala+i), dist);
+		__m256 nivel = nivelMin;
+		for(int k=0; k<nUmbrales; k++)
+			nivel = _mm256_add_ps(nivel, _mm256_and_ps(_mm256_cmp_ps(ratio, _mm256_set1_ps(L.umbrales[k]), _CMP_GT_OQ), uno));
+
+		_mm256_storeu_ps(L.u+i, u);
+		_mm256_storeu_ps(L.v+i, v);
+		_mm256_storeu_ps(L.coseno+i, coseno);
+		_mm256_storeu_ps(L.nivel+i, nivel);
+		const int mascara = _mm256_movemask_ps(visible);
+		for(int j=0; j<8; j++)
+			L.visible[i+j] = (mascara>>j) & 1;
+	}
+	return i;
+}
+#endif
+
+void FrustumLocal::Cargar(const vector<MapPoint*> &vpPuntos, const long unsigned int nFrameId)
+{
+	mvpPuntos.clear();
+	mvX.clear(); mvY.clear(); mvZ.clear();
+	mvNx.clear(); mvNy.clear(); mvNz.clear();
+	mvDistMin.clear(); mvDistMax.clear(); mvDistEscala.clear();
+
+	for(MapPoint *pMP : vpPuntos)
+	{
+		if(pMP->mnLastFrameSeen == nFrameId)
+			continue;
+		if(pMP->isBad())
+			continue;
+
+		Eigen::Vector3f pos, normal;
+		float minDist, maxDist;
+		pMP->GetDatosFrustum(pos, normal, minDist, maxDist);
+
+		mvpPuntos.push_back(pMP);
+		mvX.push_back(pos(0)); mvY.push_back(pos(1)); mvZ.push_back(pos(2));
+		mvNx.push_back(normal(0)); mvNy.push_back(normal(1)); mvNz.push_back(normal(2));
+		mvDistMin.push_back(0.8f*minDist);	// Márgenes de MapPoint::GetMinDistanceInvariance y GetMaxDistanceInvariance
+		mvDistMax.push_back(1.2f*maxDist);
+		mvDistEscala.push_back(maxDist);
+	}
+}
+
+int FrustumLocal::Proyectar(const Frame &F, const float viewingCosLimit)
+{
+	const int n = mvpPuntos.size();
+	mvU.resize(n); mvV.resize(n); mvCos.resize(n); mvNivel.resize(n);
+	mvVisible.resize(n);
+
+	LoteFrustum L;
+	L.n = n;
+	L.x = mvX.data(); L.y = mvY.data(); L.z = mvZ.data();
+	L.nx = mvNx.data(); L.ny = mvNy.data(); L.nz = mvNz.data();
+	L.distMin = mvDistMin.data(); L.distMax = mvDistMax.data(); L.distEscala = mvDistEscala.data();
+	L.u = mvU.data(); L.v = mvV.data(); L.coseno = mvCos.data(); L.nivel = mvNivel.data();
+	L.visible = mvVisible.data();
+
+	const SE3f &Tcw = F.GetPose3f();
+	const Eigen::Vector3f &Ow = F.GetCameraCenter3f();
+	for(int f=0; f<3; f++)
+	{
+		for(int c=0; c<3; c++)
+			L.R[3*f+c] = Tcw.R(f,c);
+		L.t[f] = Tcw.t(f);
+		L.O[f] = Ow(f);
+	}
+	L.fx = F.fx; L.fy = F.fy; L.cx = F.cx; L.cy = F.cy;
+	L.minX = F.mnMinX; L.maxX = F.mnMaxX; L.minY = F.mnMinY; L.maxY = F.mnMaxY;
+	L.cosLimite = viewingCosLimit;
+
+	// Rango de niveles posibles: la razón distEscala/dist está entre 1/1.2 y f^(niveles-1)/0.8, por los márgenes de distancia
+	const float logFactor = F.mfLogScaleFactor;
+	const int nivelMin = floor(log(1.0f/1.2f)/logFactor);
+	const int nivelMax = F.mnScaleLevels-1 + ceil(log(1.0f/0.8f)/logFactor);
+	L.nivelMin = nivelMin;
+	for(int k=nivelMin; k<nivelMax; k++)
+		L.umbrales.push_back(exp(k*logFactor));
+
+	int i0 = 0;
+#if defined(__x86_64__)
+	static const bool bAVX = __builtin_cpu_supports("avx");
+	if(bAVX)
+		i0 = ProyectarAVX(L);
+#endif
+	ProyectarEscalar(L, i0);
+
+	// Vuelco de resultados, como en Frame::isInFrustum
+	mvpVisibles.clear();
+	for(int i=0; i<n; i++)
+	{
+		MapPoint *pMP = mvpPuntos[i];
+		pMP->mbTrackInView = mvVisible[i];
+		if(!mvVisible[i])
+			continue;
+
+		pMP->mTrackProjX = mvU[i];
+		pMP->mTrackProjY = mvV[i];
+		pMP->mnTrackScaleLevel = (int)mvNivel[i];
+		pMP->mTrackViewCos = mvCos[i];
+		mvpVisibles.push_back(pMP);
+	}
+
+	return mvpVisibles.size();
+}
+
+}// namespace ORB_SLAM2
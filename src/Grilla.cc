@@ -0,0 +1,49 @@
+/*
+ * Grilla.cc
+ *
+ *  Created on: 17 oct. 2026
+ *      Author: alejandro
+ */
+
+#include "Grilla.h"
+#include <cmath>
+
+using namespace std;
+
+namespace ORB_SLAM2{
+
+void Grilla::Construir(const vector<cv::KeyPoint> &vKeysUn, const float minX, const float minY, const float anchoCeldaInv, const float altoCeldaInv){
+	const int N = vKeysUn.size();
+	const int nCeldas = FRAME_GRID_COLS*FRAME_GRID_ROWS;
+
+	// Celda de cada punto, -1 si cae fuera de la grilla
+	vector<int> vCelda(N);
+	mvInicio.assign(nCeldas+1, 0);
+	for(int i=0; i<N; i++){
+		const cv::KeyPoint &kp = vKeysUn[i];
+		const int posX = round((kp.pt.x-minX)*anchoCeldaInv);
+		const int posY = round((kp.pt.y-minY)*altoCeldaInv);
+
+		//Keypoint's coordinates are undistorted, which could cause to go out of the image
+		if(posX<0 || posX>=FRAME_GRID_COLS || posY<0 || posY>=FRAME_GRID_ROWS){
+			vCelda[i] = -1;
+			continue;
+		}
+		const int c = posX*FRAME_GRID_ROWS + posY;
+		vCelda[i] = c;
+		mvInicio[c+1]++;
+	}
+
+	// Suma acumulada: inicio de cada celda
+	for(int c=0; c<nCeldas; c++)
+		mvInicio[c+1] += mvInicio[c];
+
+	// Ubicación estable: los índices de cada celda quedan en orden creciente
+	mvIndices.resize(mvInicio[nCeldas]);
+	vector<int> vPosicion(mvInicio.begin(), mvInicio.end()-1);
+	for(int i=0; i<N; i++)
+		if(vCelda[i]>=0)
+			mvIndices[vPosicion[vCelda[i]]++] = i;
+}
+
+}// namespace ORB_SLAM2
@@ -26,6 +26,7 @@
 #include "MapPoint.h"
 #include "Frame.h"
 #include "KeyFrameDatabase.h"
+#include "ContadorKeyFrames.h"
 #include <mutex>
 
 
@@ -43,25 +44,17 @@ KeyFrame::KeyFrame(Frame &F, Map *pMap, KeyFrameDatabase *pKFDB):
     mnTrackReferenceForFrame(0), mnFuseTargetForKF(0), mnBALocalForKF(0), mnBAFixedForKF(0),
     mnLoopQuery(0), mnLoopWords(0), mnRelocQuery(0), mnRelocWords(0), mnBAGlobalForKF(0),
     fx(F.fx), fy(F.fy), cx(F.cx), cy(F.cy), invfx(F.invfx), invfy(F.invfy),
-    N(F.N), mvKeys(F.mvKeys), mvKeysUn(F.mvKeysUn),
-    mDescriptors(F.mDescriptors.clone()),
+    N(F.N), mvKeys(F.GetKeys()), mvKeysUn(F.GetKeysUn()),
+    mDescriptors(F.GetDescriptors()),
     mBowVec(F.mBowVec), mFeatVec(F.mFeatVec), mnScaleLevels(F.mnScaleLevels), mfScaleFactor(F.mfScaleFactor),
     mfLogScaleFactor(F.mfLogScaleFactor), mvScaleFactors(F.mvScaleFactors), mvLevelSigma2(F.mvLevelSigma2),
     mvInvLevelSigma2(F.mvInvLevelSigma2), mnMinX(F.mnMinX), mnMinY(F.mnMinY), mnMaxX(F.mnMaxX),
     mnMaxY(F.mnMaxY), mK(F.mK), mvpMapPoints(F.mvpMapPoints), mpKeyFrameDB(pKFDB),
-    mpORBvocabulary(F.mpORBvocabulary), mbFirstConnection(true), mpParent(NULL), mbNotErase(false),
+    mpORBvocabulary(F.mpORBvocabulary), mGrid(F.mpCaracteristicas->mGrid), mbFirstConnection(true), mpParent(NULL), mbNotErase(false),
     mbToBeErased(false), mbBad(false), mpMap(pMap)
 {
     mnId=nNextId++;
 
-    mGrid.resize(mnGridCols);
-    for(int i=0; i<mnGridCols;i++)
-    {
-        mGrid[i].resize(mnGridRows);
-        for(int j=0; j<mnGridRows; j++)
-            mGrid[i][j] = F.mGrid[i][j];
-    }
-
     SetPose(F.mTcw);
 
     // Relevar los colores de los keypoints,  En este caso toma el color del píxel.  Se podría promediar el contexto.
@@ -76,13 +69,9 @@ void KeyFrame::ComputeBoW()
 {
     if(mBowVec.empty() || mFeatVec.empty() || bows.empty())
     {
-        vector<cv::Mat> vCurrentDesc = Converter::toDescriptorVector(mDescriptors);
-        bows.assign(N, static_cast<unsigned int>(NULL));
-        bowPesos.assign(N, static_cast<double>(NULL));
-
         // Feature vector associate features with nodes in the 4th level (from leaves up)
         // We assume the vocabulary tree has 6 levels, change the 4 otherwise
-        mpORBvocabulary->transform(vCurrentDesc,mBowVec,mFeatVec,4);
+        mpORBvocabulary->Transformar(mDescriptors,mBowVec,mFeatVec,4,&bows,&bowPesos);
     }
 }
 
@@ -99,6 +88,9 @@ void KeyFrame::SetPose(const cv::Mat &Tcw_)
     Twc = cv::Mat::eye(4,4,Tcw.type());
     Rwc.copyTo(Twc.rowRange(0,3).colRange(0,3));
     Ow.copyTo(Twc.rowRange(0,3).col(3));
+
+    mTcw3f = Converter::toSE3f(Tcw);
+    mOw3f = mTcw3f.centro();
 }
 
 cv::Mat KeyFrame::GetPose()
@@ -131,6 +123,18 @@ cv::Mat KeyFrame::GetTranslation()
     return Tcw.rowRange(0,3).col(3).clone();
 }
 
+SE3f KeyFrame::GetPose3f()
+{
+    unique_lock<mutex> lock(mMutexPose);
+    return mTcw3f;
+}
+
+Eigen::Vector3f KeyFrame::GetCameraCenter3f()
+{
+    unique_lock<mutex> lock(mMutexPose);
+    return mOw3f;
+}
+
 void KeyFrame::AddConnection(KeyFrame *pKF, const int &weight)
 {
     if(mbBad || pKF->isBad()) return;	// Agregado por mí
@@ -302,7 +306,10 @@ MapPoint* KeyFrame::GetMapPoint(const size_t &idx)
 
 void KeyFrame::UpdateConnections()
 {
-    map<KeyFrame*,int> KFcounter;
+    // Contador y vector de observadores propios de cada hilo: UpdateConnections se invoca desde varios hilos
+    static thread_local ContadorKeyFrames KFcounter;
+    static thread_local vector<KeyFrame*> vpObservadores;
+    KFcounter.Iniciar();
 
     vector<MapPoint*> vpMP;
 
@@ -320,13 +327,13 @@ void KeyFrame::UpdateConnections()
         if(!pMP || pMP->isBad() || pMP->plCandidato || pMP->plLejano)// Puntos lejanos: excluídos del grafo de covisibilidad
             continue;
 
-        map<KeyFrame*,size_t> observations = pMP->GetObservations();
+        pMP->GetKeyFramesObservadores(vpObservadores);
 
-        for(map<KeyFrame*,size_t>::iterator mit=observations.begin(), mend=observations.end(); mit!=mend; mit++)
+        for(KeyFrame* pKFi : vpObservadores)
         {
-            if(mit->first->mnId==mnId)
+            if(pKFi->mnId==mnId)
                 continue;
-            KFcounter[mit->first]++;
+            KFcounter.Incrementar(pKFi);
         }
     }
 
@@ -340,19 +347,23 @@ void KeyFrame::UpdateConnections()
     KeyFrame* pKFmax=NULL;
     int th = 15;
 
+    const vector<KeyFrame*> &vpKFs = KFcounter.KeyFrames();
+    map<KeyFrame*,int> KFweights;
     vector<pair<int,KeyFrame*> > vPairs;
-    vPairs.reserve(KFcounter.size());
-    for(map<KeyFrame*,int>::iterator mit=KFcounter.begin(), mend=KFcounter.end(); mit!=mend; mit++)
+    vPairs.reserve(vpKFs.size());
+    for(KeyFrame* pKFi : vpKFs)
     {
-        if(mit->second>nmax)
+        const int peso = KFcounter.Valor(pKFi);
+        KFweights[pKFi] = peso;
+        if(peso>nmax)
         {
-            nmax=mit->second;
-            pKFmax=mit->first;
+            nmax=peso;
+            pKFmax=pKFi;
         }
-        if(mit->second>=th)
+        if(peso>=th)
         {
-            vPairs.push_back(make_pair(mit->second,mit->first));
-            (mit->first)->AddConnection(this,mit->second);
+            vPairs.push_back(make_pair(peso,pKFi));
+            pKFi->AddConnection(this,peso);
         }
     }
 
@@ -376,7 +387,7 @@ void KeyFrame::UpdateConnections()
 
         if(mbBad) return;
 
-        mConnectedKeyFrameWeights = KFcounter;
+        mConnectedKeyFrameWeights = KFweights;
         mvpOrderedConnectedKeyFrames = vector<KeyFrame*>(lKFs.begin(),lKFs.end());
         mvOrderedWeights = vector<int>(lWs.begin(), lWs.end());
 
@@ -637,42 +648,45 @@ void KeyFrame::EraseConnection(KeyFrame* pKF)
 vector<size_t> KeyFrame::GetFeaturesInArea(const float &x, const float &y, const float &r) const
 {
     vector<size_t> vIndices;
-    vIndices.reserve(N);
+    GetFeaturesInArea(vIndices, x, y, r);
+    return vIndices;
+}
+
+void KeyFrame::GetFeaturesInArea(vector<size_t> &vIndices, const float &x, const float &y, const float &r) const
+{
+    vIndices.clear();
 
     const int nMinCellX = max(0,(int)floor((x-mnMinX-r)*mfGridElementWidthInv));
     if(nMinCellX>=mnGridCols)
-        return vIndices;
+        return;
 
     const int nMaxCellX = min((int)mnGridCols-1,(int)ceil((x-mnMinX+r)*mfGridElementWidthInv));
     if(nMaxCellX<0)
-        return vIndices;
+        return;
 
     const int nMinCellY = max(0,(int)floor((y-mnMinY-r)*mfGridElementHeightInv));
     if(nMinCellY>=mnGridRows)
-        return vIndices;
+        return;
 
     const int nMaxCellY = min((int)mnGridRows-1,(int)ceil((y-mnMinY+r)*mfGridElementHeightInv));
     if(nMaxCellY<0)
-        return vIndices;
+        return;
 
+    // Las celdas nMinCellY..nMaxCellY de cada columna son un único tramo contiguo de la grilla
     for(int ix = nMinCellX; ix<=nMaxCellX; ix++)
     {
-        for(int iy = nMinCellY; iy<=nMaxCellY; iy++)
+        const unsigned int *celda, *fin;
+        mGrid.Tramo(ix, nMinCellY, nMaxCellY, celda, fin);
+        for(; celda<fin; celda++)
         {
-            const vector<size_t> vCell = mGrid[ix][iy];
-            for(size_t j=0, jend=vCell.size(); j<jend; j++)
-            {
-                const cv::KeyPoint &kpUn = mvKeysUn[vCell[j]];
-                const float distx = kpUn.pt.x-x;
-                const float disty = kpUn.pt.y-y;
+            const cv::KeyPoint &kpUn = mvKeysUn[*celda];
+            const float distx = kpUn.pt.x-x;
+            const float disty = kpUn.pt.y-y;
 
-                if(fabs(distx)<r && fabs(disty)<r)
-                    vIndices.push_back(vCell[j]);
-            }
+            if(fabs(distx)<r && fabs(disty)<r)
+                vIndices.push_back(*celda);
         }
     }
-
-    return vIndices;
 }
 
 bool KeyFrame::IsInImage(const float &x, const float &y) const
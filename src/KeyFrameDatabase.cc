@@ -19,10 +19,12 @@
 */
 
 #include <iostream>
+#include <cmath>
+#include <algorithm>
 #include "KeyFrameDatabase.h"
 #include "Frame.h"
 #include "KeyFrame.h"
-#include "../Thirdparty/DBoW2/DBoW2/BowVector.h"
+#include "VectorBow.h"
 
 using namespace std;
 
@@ -35,39 +37,98 @@ KeyFrameDatabase::KeyFrameDatabase (const ORBVocabulary &voc):
 }
 
 
+// Compactar cuando las lápidas superan esta fracción de los índices...
+static const size_t FRACCION_LAPIDAS = 4;
+
+// ... y al menos esta cantidad, para no recorrer todas las listas por pocos keyframes
+static const size_t LAPIDAS_MINIMAS = 64;
+
 void KeyFrameDatabase::add(KeyFrame *pKF)
 {
-    unique_lock<mutex> lock(mMutex);
+    unique_lock<MutexCompartido> lock(mMutex);
+
+    if(mmIndices.count(pKF))
+        return;
+
+    const uint32_t indice = mvpKeyFrames.size();
+    mvpKeyFrames.push_back(pKF);
+    mmIndices[pKF] = indice;
 
-    for(DBoW2::BowVector::const_iterator vit= pKF->mBowVec.begin(), vend=pKF->mBowVec.end(); vit!=vend; vit++)
-        mvInvertedFile[vit->first].push_back(pKF);
+    // Los índices crecen, de modo que cada lista queda ordenada
+    const vector<DBoW2::WordId> &vPalabras = pKF->mBowVec.Palabras();
+    const vector<DBoW2::WordValue> &vPesos = pKF->mBowVec.Pesos();
+    for(size_t i=0; i<vPalabras.size(); i++)
+    {
+        Aparicion aparicion;
+        aparicion.peso = vPesos[i];
+        aparicion.indice = indice;
+        mvInvertedFile[vPalabras[i]].push_back(aparicion);
+    }
 }
 
 void KeyFrameDatabase::erase(KeyFrame* pKF)
 {
-    unique_lock<mutex> lock(mMutex);
+    unique_lock<MutexCompartido> lock(mMutex);
+
+    unordered_map<KeyFrame*, uint32_t>::iterator it = mmIndices.find(pKF);
+    if(it == mmIndices.end())
+        return;
+
+    // Lápida, sin recorrer las listas
+    mvpKeyFrames[it->second] = NULL;
+    mmIndices.erase(it);
+    mnLapidas++;
 
-    // Erase elements in the Inverse File for the entry
-    for(DBoW2::BowVector::const_iterator vit=pKF->mBowVec.begin(), vend=pKF->mBowVec.end(); vit!=vend; vit++)
+    if(mnLapidas >= LAPIDAS_MINIMAS && mnLapidas*FRACCION_LAPIDAS > mvpKeyFrames.size())
+        Compactar();
+}
+
+void KeyFrameDatabase::Compactar()
+{
+    // Índice nuevo de cada índice viejo, o lápida si no sobrevive
+    const uint32_t lapida = (uint32_t)-1;
+    vector<uint32_t> vNuevos(mvpKeyFrames.size(), lapida);
+    uint32_t n = 0;
+    for(size_t i=0; i<mvpKeyFrames.size(); i++)
     {
-        // List of keyframes that share the word
-        list<KeyFrame*> &lKFs =   mvInvertedFile[vit->first];
+        KeyFrame* pKF = mvpKeyFrames[i];
+        if(!pKF)
+            continue;
+        vNuevos[i] = n;
+        mvpKeyFrames[n] = pKF;
+        mmIndices[pKF] = n;
+        n++;
+    }
+    mvpKeyFrames.resize(n);
 
-        for(list<KeyFrame*>::iterator lit=lKFs.begin(), lend= lKFs.end(); lit!=lend; lit++)
+    // La renumeración conserva el orden, de modo que las listas siguen ordenadas
+    for(size_t palabra=0; palabra<mvInvertedFile.size(); palabra++)
+    {
+        vector<Aparicion> &vApariciones = mvInvertedFile[palabra];
+        size_t j = 0;
+        for(size_t i=0; i<vApariciones.size(); i++)
         {
-            if(pKF==*lit)
+            const uint32_t nuevo = vNuevos[vApariciones[i].indice];
+            if(nuevo != lapida)
             {
-                lKFs.erase(lit);
-                break;
+                vApariciones[j] = vApariciones[i];
+                vApariciones[j++].indice = nuevo;
             }
         }
+        vApariciones.resize(j);
     }
+
+    mnLapidas = 0;
 }
 
 void KeyFrameDatabase::clear()
 {
+    unique_lock<MutexCompartido> lock(mMutex);
     mvInvertedFile.clear();
     mvInvertedFile.resize(mpVoc->size());
+    mvpKeyFrames.clear();
+    mmIndices.clear();
+    mnLapidas = 0;
 }
 
 
@@ -79,17 +140,19 @@ vector<KeyFrame*> KeyFrameDatabase::DetectLoopCandidates(KeyFrame* pKF, float mi
     // Search all keyframes that share a word with current keyframes
     // Discard keyframes connected to the query keyframe
     {
-        unique_lock<mutex> lock(mMutex);
+        LockCompartido lock(mMutex);
 
         // Recorre los BoW del keyframe pKF
-        for(DBoW2::BowVector::const_iterator vit=pKF->mBowVec.begin(), vend=pKF->mBowVec.end(); vit != vend; vit++)
+        for(DBoW2::WordId palabra : pKF->mBowVec.Palabras())
         {
-            list<KeyFrame*> &lKFs =   mvInvertedFile[vit->first];
+            const vector<Aparicion> &vApariciones = mvInvertedFile[palabra];
 
             // Para cada BoW de pKF, recorre todos los keyframes pKFi que contengan ese BoW
-            for(list<KeyFrame*>::iterator lit=lKFs.begin(), lend= lKFs.end(); lit!=lend; lit++)
+            for(size_t i=0; i<vApariciones.size(); i++)
             {
-                KeyFrame* pKFi=*lit;
+                KeyFrame* pKFi = mvpKeyFrames[vApariciones[i].indice];
+                if(!pKFi)
+                    continue;	// Lápida
                 if(pKFi->mnLoopQuery!=pKF->mnId)
                 {
                     pKFi->mnLoopWords=0;
@@ -130,7 +193,7 @@ vector<KeyFrame*> KeyFrameDatabase::DetectLoopCandidates(KeyFrame* pKF, float mi
         {
             nscores++;
 
-            float si = mpVoc->score(pKF->mBowVec,pKFi->mBowVec);
+            float si = VectorBow::PuntajeL1(pKF->mBowVec,pKFi->mBowVec);
 
             pKFi->mLoopScore = si;
             if(si>=minScore)
@@ -198,68 +261,118 @@ vector<KeyFrame*> KeyFrameDatabase::DetectLoopCandidates(KeyFrame* pKF, float mi
 
 vector<KeyFrame*> KeyFrameDatabase::DetectRelocalizationCandidates(Frame *F)
 {
-    list<KeyFrame*> lKFsSharingWords;
+    size_t nKFsSharingWords = 0;
+    int maxCommonWords=0;
+    int minCommonWords=0;
+    list<pair<float,KeyFrame*> > lScoreAndMatch;
+    int nscores=0;
 
     // Search all keyframes that share a word with current frame
+    // Acumula palabras compartidas y puntaje en un único recorrido, con poda por cota
     {
-        unique_lock<mutex> lock(mMutex);
+        LockCompartido lock(mMutex);
+
+        // Época nueva: invalida todos los acumuladores sin recorrerlos
+        const size_t nKFs = mvpKeyFrames.size();
+        if(mvEpocaReloc.size() < nKFs)
+        {
+            mvEpocaReloc.resize(nKFs, 0);
+            mvPalabrasReloc.resize(nKFs);
+            mvPuntajeReloc.resize(nKFs);
+            mvDescartadoReloc.resize(nKFs);
+        }
+        if(++mnEpocaReloc == 0)
+        {
+            fill(mvEpocaReloc.begin(), mvEpocaReloc.end(), 0);
+            mnEpocaReloc = 1;
+        }
+        mvTocadosReloc.clear();
+
+        // Palabras en orden creciente, como en VectorBow::PuntajeL1, para sumar los términos en el mismo orden
+        const vector<DBoW2::WordId> &vPalabras = F->mBowVec.Palabras();
+        const vector<DBoW2::WordValue> &vPesos = F->mBowVec.Pesos();
+        const int nPalabras = vPalabras.size();
 
-        for(DBoW2::BowVector::const_iterator vit=F->mBowVec.begin(), vend=F->mBowVec.end(); vit != vend; vit++)
+        // Umbral de palabras compartidas según el máximo parcial.  Sólo crece.
+        int umbral = 0;
+
+        for(int p=0; p<nPalabras; p++)
         {
-            list<KeyFrame*> &lKFs = mvInvertedFile[vit->first];
+            const double vi = vPesos[p];
+            const int restantes = nPalabras - p;	// Incluye la actual
+            const vector<Aparicion> &vApariciones = mvInvertedFile[vPalabras[p]];
 
-            for(list<KeyFrame*>::iterator lit=lKFs.begin(), lend= lKFs.end(); lit!=lend; lit++)
+            for(size_t i=0; i<vApariciones.size(); i++)
             {
-                KeyFrame* pKFi=*lit;
-                if(pKFi->mnRelocQuery!=F->mnId)
+                const uint32_t k = vApariciones[i].indice;
+                KeyFrame* pKFi = mvpKeyFrames[k];
+                if(!pKFi)
+                    continue;	// Lápida
+
+                if(mvEpocaReloc[k] != mnEpocaReloc)
                 {
-                    pKFi->mnRelocWords=0;
+                    mvEpocaReloc[k] = mnEpocaReloc;
+                    mvPalabrasReloc[k] = 0;
+                    mvPuntajeReloc[k] = 0;
+                    mvDescartadoReloc[k] = false;
+                    mvTocadosReloc.push_back(k);
                     pKFi->mnRelocQuery=F->mnId;
-                    lKFsSharingWords.push_back(pKFi);
                 }
-                pKFi->mnRelocWords++;
+                else if(mvDescartadoReloc[k])
+                    continue;
+
+                // Cota: ni compartiendo todas las palabras restantes supera el umbral, que sólo puede crecer
+                if(mvPalabrasReloc[k] + restantes <= umbral)
+                {
+                    mvDescartadoReloc[k] = true;
+                    continue;
+                }
+
+                // Mismo término que VectorBow::PuntajeL1
+                const double wi = vApariciones[i].peso;
+                mvPuntajeReloc[k] += fabs(vi - wi) - fabs(vi) - fabs(wi);
+
+                if(++mvPalabrasReloc[k] > maxCommonWords)
+                {
+                    maxCommonWords = mvPalabrasReloc[k];
+                    umbral = maxCommonWords*0.8f;
+                }
+            }
+        }
+
+        // Only compare against those keyframes that share enough words
+        minCommonWords = maxCommonWords*0.8f;
+        nKFsSharingWords = mvTocadosReloc.size();
+
+        // Compute similarity score.
+        for(size_t i=0; i<mvTocadosReloc.size(); i++)
+        {
+            const uint32_t k = mvTocadosReloc[i];
+            KeyFrame* pKFi = mvpKeyFrames[k];
+
+            // Cota inferior en los descartados
+            pKFi->mnRelocWords = mvPalabrasReloc[k];
+
+            if(!mvDescartadoReloc[k] && mvPalabrasReloc[k]>minCommonWords)
+            {
+                nscores++;
+                float si = -mvPuntajeReloc[k]/2.0;
+                pKFi->mRelocScore=si;
+                lScoreAndMatch.push_back(make_pair(si,pKFi));
             }
         }
     }
 
-    if(lKFsSharingWords.empty()){
+    if(!nKFsSharingWords){
         if(verbose){
         	cout << "\nWords in frame: " << F->mBowVec.size() << endl;
-        	cout << "Keyframes sharing words: " << lKFsSharingWords.size() << endl;
+        	cout << "Keyframes sharing words: " << nKFsSharingWords << endl;
         }
         return vector<KeyFrame*>();
     }
 
     if(verbose) cout << endl;
 
-    // Only compare against those keyframes that share enough words
-    int maxCommonWords=0;
-    for(list<KeyFrame*>::iterator lit=lKFsSharingWords.begin(), lend= lKFsSharingWords.end(); lit!=lend; lit++)
-    {
-        if((*lit)->mnRelocWords>maxCommonWords)
-            maxCommonWords=(*lit)->mnRelocWords;
-    }
-
-    int minCommonWords = maxCommonWords*0.8f;
-
-    list<pair<float,KeyFrame*> > lScoreAndMatch;
-
-    int nscores=0;
-
-    // Compute similarity score.
-    for(list<KeyFrame*>::iterator lit=lKFsSharingWords.begin(), lend= lKFsSharingWords.end(); lit!=lend; lit++)
-    {
-        KeyFrame* pKFi = *lit;
-
-        if(pKFi->mnRelocWords>minCommonWords)
-        {
-            nscores++;
-            float si = mpVoc->score(F->mBowVec,pKFi->mBowVec);
-            pKFi->mRelocScore=si;
-            lScoreAndMatch.push_back(make_pair(si,pKFi));
-        }
-    }
-
     if(lScoreAndMatch.empty())
         return vector<KeyFrame*>();
 
@@ -322,7 +435,7 @@ vector<KeyFrame*> KeyFrameDatabase::DetectRelocalizationCandidates(Frame *F)
     	cout << ", minimum commons words chosen: " << minCommonWords << endl;
     	cout << "Best score found: " << bestAccScore;
     	cout << ", minimum score chosen: " << minScoreToRetain << endl;
-    	cout << "\nKeyframes sharing words: " << lKFsSharingWords.size() << endl;
+    	cout << "\nKeyframes sharing words: " << nKFsSharingWords << endl;
     	cout << "Keyframes with at least minimum commons words: " << nscores << endl;
    		cout << "Candidates: " << vpRelocCandidates.size();
    		if(spAlreadyAddedKF.size())
@@ -335,6 +448,7 @@ vector<KeyFrame*> KeyFrameDatabase::DetectRelocalizationCandidates(Frame *F)
 
 
 void KeyFrameDatabase::resizeInvertedFile(size_t tamanio){
+    unique_lock<MutexCompartido> lock(mMutex);
     mvInvertedFile.resize(tamanio);
 }
 
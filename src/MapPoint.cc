@@ -21,6 +21,7 @@
 #include "MapPoint.h"
 #include "ORBmatcher.h"
 #include "KeyFrameTriangulacion.h"
+#include "Converter.h"
 
 #include<mutex>
 
@@ -36,8 +37,9 @@ MapPoint::MapPoint(const cv::Mat &Pos, KeyFrame *pRefKF, Map* pMap, cv::Vec3b rg
     mnCorrectedReference(0), mnBAGlobalForKF(0), rgb(rgb_), mpRefKF(pRefKF), mnVisible(1), mnFound(1), mbBad(false),
     mpReplaced(static_cast<MapPoint*>(NULL)), mfMinDistance(0), mfMaxDistance(0), mpMap(pMap)
 {
-    Pos.copyTo(mWorldPos);
-    mNormalVector = cv::Mat::zeros(3,1,CV_32F);
+    // Osmap crea puntos con Pos vacía, y luego deserializa la posición
+    mWorldPos = Pos.empty()? Eigen::Vector3f::Zero() : Converter::toVector3f(Pos);
+    mNormalVector = Eigen::Vector3f::Zero();
 
     // MapPoints can be created from Tracking and Local Mapping. This mutex avoid conflicts with id.
     unique_lock<mutex> lock(mpMap->mMutexPointCreation);
@@ -48,19 +50,38 @@ void MapPoint::SetWorldPos(const cv::Mat &Pos)
 {
     unique_lock<mutex> lock2(mGlobalMutex);
     unique_lock<mutex> lock(mMutexPos);
-    Pos.copyTo(mWorldPos);
+    mWorldPos = Converter::toVector3f(Pos);
+}
+
+void MapPoint::SetWorldPos(const Eigen::Vector3f &Pos)
+{
+    unique_lock<mutex> lock2(mGlobalMutex);
+    unique_lock<mutex> lock(mMutexPos);
+    mWorldPos = Pos;
 }
 
 cv::Mat MapPoint::GetWorldPos()
 {
     unique_lock<mutex> lock(mMutexPos);
-    return mWorldPos.clone();
+    return Converter::toCvMat(mWorldPos);
+}
+
+Eigen::Vector3f MapPoint::GetWorldPos3f()
+{
+    unique_lock<mutex> lock(mMutexPos);
+    return mWorldPos;
 }
 
 cv::Mat MapPoint::GetNormal()
 {
     unique_lock<mutex> lock(mMutexPos);
-    return mNormalVector.clone();
+    return Converter::toCvMat(mNormalVector);
+}
+
+Eigen::Vector3f MapPoint::GetNormal3f()
+{
+    unique_lock<mutex> lock(mMutexPos);
+    return mNormalVector;
 }
 
 KeyFrame* MapPoint::GetReferenceKeyFrame()
@@ -123,6 +144,14 @@ map<KeyFrame*, size_t> MapPoint::GetObservations()
     return mObservations;
 }
 
+void MapPoint::GetKeyFramesObservadores(vector<KeyFrame*> &vpKFs)
+{
+    unique_lock<mutex> lock(mMutexFeatures);
+    vpKFs.clear();
+    for(map<KeyFrame*,size_t>::const_iterator mit=mObservations.begin(), mend=mObservations.end(); mit!=mend; mit++)
+        vpKFs.push_back(mit->first);
+}
+
 int MapPoint::Observations()
 {
     unique_lock<mutex> lock(mMutexFeatures);
@@ -227,7 +256,7 @@ float MapPoint::GetFoundRatio()
 void MapPoint::ComputeDistinctiveDescriptors()
 {
     // Retrieve all observed descriptors
-    vector<cv::Mat> vDescriptors;
+    vector<const uchar*> vDescriptors;
 
     map<KeyFrame*,size_t> observations;
 
@@ -248,7 +277,7 @@ void MapPoint::ComputeDistinctiveDescriptors()
         KeyFrame* pKF = mit->first;
 
         if(!pKF->isBad())
-            vDescriptors.push_back(pKF->mDescriptors.row(mit->second));
+            vDescriptors.push_back(pKF->mDescriptors.ptr(mit->second));
     }
 
     if(vDescriptors.empty())
@@ -258,12 +287,15 @@ void MapPoint::ComputeDistinctiveDescriptors()
     const size_t N = vDescriptors.size();
 
     float Distances[N][N];
+    int distancias[N];
     for(size_t i=0;i<N;i++)
     {
         Distances[i][i]=0;
+        // Distancias de i a todos los siguientes, en lote
+        ORBmatcher::DescriptorDistances(vDescriptors[i], vDescriptors.data()+i+1, N-i-1, distancias);
         for(size_t j=i+1;j<N;j++)
         {
-            int distij = ORBmatcher::DescriptorDistance(vDescriptors[i],vDescriptors[j]);
+            int distij = distancias[j-i-1];
             Distances[i][j]=distij;
             Distances[j][i]=distij;
         }
@@ -287,14 +319,14 @@ void MapPoint::ComputeDistinctiveDescriptors()
 
     {
         unique_lock<mutex> lock(mMutexFeatures);
-        mDescriptor = vDescriptors[BestIdx].clone();       
+        mDescriptor = Descriptor(vDescriptors[BestIdx]);
     }
 }
 
-cv::Mat MapPoint::GetDescriptor()
+Descriptor MapPoint::GetDescriptor()
 {
     unique_lock<mutex> lock(mMutexFeatures);
-    return mDescriptor.clone();
+    return mDescriptor;
 }
 
 int MapPoint::GetIndexInKeyFrame(KeyFrame *pKF)
@@ -316,7 +348,7 @@ void MapPoint::UpdateNormalAndDepth()
 {
     map<KeyFrame*,size_t> observations;
     KeyFrame* pRefKF;
-    cv::Mat Pos;
+    Eigen::Vector3f Pos;
     {
         unique_lock<mutex> lock1(mMutexFeatures);
         unique_lock<mutex> lock2(mMutexPos);
@@ -324,25 +356,24 @@ void MapPoint::UpdateNormalAndDepth()
             return;
         observations=mObservations;
         pRefKF=mpRefKF;
-        Pos = mWorldPos.clone();
+        Pos = mWorldPos;
     }
 
     if(observations.empty())
         return;
 
-    cv::Mat normal = cv::Mat::zeros(3,1,CV_32F);
+    Eigen::Vector3f normal = Eigen::Vector3f::Zero();
     int n=0;
     for(map<KeyFrame*,size_t>::iterator mit=observations.begin(), mend=observations.end(); mit!=mend; mit++)
     {
         KeyFrame* pKF = mit->first;
-        cv::Mat Owi = pKF->GetCameraCenter();
-        cv::Mat normali = mWorldPos - Owi;
-        normal = normal + normali/cv::norm(normali);
+        const Eigen::Vector3f normali = Pos - pKF->GetCameraCenter3f();
+        normal = normal + normali/normali.norm();
         n++;
     } 
 
-    cv::Mat PC = Pos - pRefKF->GetCameraCenter();
-    const float dist = cv::norm(PC);
+    const Eigen::Vector3f PC = Pos - pRefKF->GetCameraCenter3f();
+    const float dist = PC.norm();
     const int level = pRefKF->mvKeysUn[observations[pRefKF]].octave;
     const float levelScaleFactor =  pRefKF->mvScaleFactors[level];
     const int nLevels = pRefKF->mnScaleLevels;
@@ -378,6 +409,15 @@ int MapPoint::PredictScale(const float &currentDist, const float &logScaleFactor
     return ceil(log(ratio)/logScaleFactor);
 }
 
+void MapPoint::GetDatosFrustum(Eigen::Vector3f &pos, Eigen::Vector3f &normal, float &minDist, float &maxDist)
+{
+    unique_lock<mutex> lock(mMutexPos);
+    pos = mWorldPos;
+    normal = mNormalVector;
+    minDist = mfMinDistance;
+    maxDist = mfMaxDistance;
+}
+
 
 cv::Scalar MapPoint::color(){
 
@@ -399,6 +439,6 @@ cv::Scalar MapPoint::color(){
 }
 
 bool MapPoint::esQInf(){
-	return cv::norm(mWorldPos)>=1e5;
+	return mWorldPos.norm()>=1e5;
 }
 } //namespace ORB_SLAM
@@ -0,0 +1,367 @@
+/*
+ * ORBVocabulary.cc
+ *
+ *  Created on: 17 oct. 2026
+ *      Author: alejandro
+ */
+
+#include "ORBVocabulary.h"
+#include "Descriptores.h"
+#include "WorkerPool.h"
+#include "ORBmatcher.h"
+#include "Converter.h"
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace ORB_SLAM2{
+
+// Máximo factor de ramificación soportado por el árbol plano.  El vocabulario ORB tiene 10.
+static const int MAX_HIJOS = 32;
+
+// Descriptores por tarea de ParallelFor
+static const int LOTE = 64;
+
+/**
+ * Cabecera del archivo de vocabulario plano.
+ * Le siguen las secciones de nodos, descriptores y pesos, cada una alineada a ALINEACION bytes desde el inicio del archivo.
+ * Los datos se escriben tal como están en memoria: el archivo sólo se puede mapear en un equipo con el mismo orden de bytes.
+ * bytesOrigen y huellaOrigen identifican el vocabulario binario del que se generó, para descartar el plano si el binario cambia.
+ */
+struct CabeceraPlano{
+	char magia[8];
+	uint32_t version;
+	uint32_t ordenBytes;
+	int32_t k, L, scoring, weighting;
+	uint32_t nNodos, nPalabras;
+	uint64_t inicioNodos, inicioDescriptores, inicioPesos, bytes;
+	uint64_t bytesOrigen, huellaOrigen;
+};
+
+static const char MAGIA[8] = {'O','S','1','V','O','C','P','L'};
+static const uint32_t VERSION = 2;
+static const uint32_t ORDEN_BYTES = 0x01020304;
+static const uint64_t ALINEACION = 64;
+
+static uint64_t Alinear(const uint64_t n){
+	return (n + ALINEACION-1) / ALINEACION * ALINEACION;
+}
+
+/**
+ * Tamaño y huella del contenido de un archivo: FNV-1a de 64 bits, por palabras de 8 bytes y luego los bytes restantes.
+ * @returns false si no se pudo leer el archivo.
+ */
+static bool HuellaArchivo(const string &archivo, uint64_t &bytes, uint64_t &huella){
+	const int fd = open(archivo.c_str(), O_RDONLY);
+	if(fd < 0)
+		return false;
+
+	struct stat st;
+	void *mapa = MAP_FAILED;
+	if(fstat(fd, &st) == 0 && st.st_size > 0)
+		mapa = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(mapa == MAP_FAILED)
+		return false;
+
+	bytes = st.st_size;
+	huella = 14695981039346656037ULL;
+	const uint64_t primo = 1099511628211ULL;
+	const char *datos = (const char*)mapa;
+	size_t i = 0;
+	for(; i+8 <= bytes; i+=8){
+		uint64_t palabra;
+		memcpy(&palabra, datos+i, 8);
+		huella = (huella ^ palabra) * primo;
+	}
+	for(; i<bytes; i++)
+		huella = (huella ^ (unsigned char)datos[i]) * primo;
+
+	munmap(mapa, bytes);
+	return true;
+}
+
+ORBVocabulary::ORBVocabulary():
+	mpNodos(NULL), mpDescriptores(NULL), mpPesos(NULL), mnNodos(0), mnPalabras(0), mpMapa(NULL), mnBytesMapa(0), mpPool(NULL)
+{}
+
+ORBVocabulary::~ORBVocabulary(){
+	LiberarPlano();
+	delete mpPool;
+}
+
+void ORBVocabulary::LiberarPlano(){
+	mvNodos.clear();
+	mvDescriptores.clear();
+	mvPesos.clear();
+	if(mpMapa)
+		munmap(mpMapa, mnBytesMapa);
+	mpMapa = NULL;
+	mnBytesMapa = 0;
+	mpNodos = NULL;
+	mpDescriptores = NULL;
+	mpPesos = NULL;
+	mnNodos = mnPalabras = 0;
+}
+
+unsigned int ORBVocabulary::size() const{
+	return Plano()? mnPalabras : TemplatedVocabulary::size();
+}
+
+bool ORBVocabulary::empty() const{
+	return Plano()? mnPalabras == 0 : TemplatedVocabulary::empty();
+}
+
+void ORBVocabulary::SetHilos(int nHilos){
+	delete mpPool;
+	mpPool = nHilos>1? new WorkerPool(nHilos, "Vocabulario") : NULL;
+}
+
+void ORBVocabulary::Aplanar(){
+	LiberarPlano();
+
+	if(m_words.empty())
+		return;
+	if(m_k > MAX_HIJOS){
+		cerr << "Vocabulario con más de " << MAX_HIJOS << " hijos por nodo, se usa el árbol de DBoW2." << endl;
+		return;
+	}
+
+	// Recorrido por niveles: los hijos de cada nodo reciben índices planos consecutivos
+	const size_t n = m_nodes.size();
+	mvNodos.reserve(n);
+	mvDescriptores.assign(n*Descriptor::BYTES, 0);
+	vector<DBoW2::NodeId> cola;
+	cola.reserve(n);
+
+	cola.push_back(0);
+	NodoPlano raiz = {0, 0, 0, 0};
+	mvNodos.push_back(raiz);
+	for(size_t i=0; i<cola.size(); i++){
+		const Node &nodo = m_nodes[cola[i]];
+		mvNodos[i].primerHijo = cola.size();
+		mvNodos[i].nHijos = nodo.children.size();
+		for(size_t j=0; j<nodo.children.size(); j++){
+			const Node &hijo = m_nodes[nodo.children[j]];
+			NodoPlano plano = {0, 0, hijo.word_id, hijo.id};
+			memcpy(&mvDescriptores[cola.size()*Descriptor::BYTES], hijo.descriptor.ptr(), Descriptor::BYTES);
+			cola.push_back(hijo.id);
+			mvNodos.push_back(plano);
+		}
+	}
+
+	mvPesos.resize(m_words.size());
+	for(size_t i=0; i<m_words.size(); i++)
+		mvPesos[i] = m_words[i]->weight;
+
+	mpNodos = mvNodos.data();
+	mpDescriptores = mvDescriptores.data();
+	mpPesos = mvPesos.data();
+	mnNodos = mvNodos.size();
+	mnPalabras = mvPesos.size();
+}
+
+bool ORBVocabulary::GuardarPlano(const string &archivo, const string &origen) const{
+	if(!Plano())
+		return false;
+
+	CabeceraPlano cabecera;
+	memset(&cabecera, 0, sizeof(cabecera));
+	if(!HuellaArchivo(origen, cabecera.bytesOrigen, cabecera.huellaOrigen))
+		return false;
+	memcpy(cabecera.magia, MAGIA, sizeof(MAGIA));
+	cabecera.version = VERSION;
+	cabecera.ordenBytes = ORDEN_BYTES;
+	cabecera.k = m_k;
+	cabecera.L = m_L;
+	cabecera.scoring = m_scoring;
+	cabecera.weighting = m_weighting;
+	cabecera.nNodos = mnNodos;
+	cabecera.nPalabras = mnPalabras;
+	cabecera.inicioNodos = Alinear(sizeof(CabeceraPlano));
+	cabecera.inicioDescriptores = Alinear(cabecera.inicioNodos + mnNodos*sizeof(NodoPlano));
+	cabecera.inicioPesos = Alinear(cabecera.inicioDescriptores + mnNodos*Descriptor::BYTES);
+	cabecera.bytes = cabecera.inicioPesos + mnPalabras*sizeof(DBoW2::WordValue);
+
+	// Se escribe en un temporal y se renombra, para que otro proceso nunca mapee un archivo a medio escribir
+	const string temporal = archivo + ".tmp";
+	ofstream f(temporal.c_str(), ios::binary);
+	if(!f.is_open())
+		return false;
+
+	const char ceros[ALINEACION] = {0};
+	f.write((const char*)&cabecera, sizeof(cabecera));
+	f.write(ceros, cabecera.inicioNodos - sizeof(cabecera));
+	f.write((const char*)mpNodos, mnNodos*sizeof(NodoPlano));
+	f.write(ceros, cabecera.inicioDescriptores - (cabecera.inicioNodos + mnNodos*sizeof(NodoPlano)));
+	f.write((const char*)mpDescriptores, mnNodos*Descriptor::BYTES);
+	f.write(ceros, cabecera.inicioPesos - (cabecera.inicioDescriptores + mnNodos*Descriptor::BYTES));
+	f.write((const char*)mpPesos, mnPalabras*sizeof(DBoW2::WordValue));
+	f.close();
+
+	if(!f || rename(temporal.c_str(), archivo.c_str()) != 0){
+		unlink(temporal.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool ORBVocabulary::CargarPlano(const string &archivo, const string &origen){
+	// Tamaño y huella del binario, para compararlos con los registrados en la cabecera
+	uint64_t bytesOrigen, huellaOrigen;
+	if(!HuellaArchivo(origen, bytesOrigen, huellaOrigen))
+		return false;
+
+	const int fd = open(archivo.c_str(), O_RDONLY);
+	if(fd < 0)
+		return false;
+
+	struct stat st;
+	void *mapa = MAP_FAILED;
+	if(fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(CabeceraPlano))
+		mapa = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);	// El mapeo sobrevive al descriptor de archivo
+	if(mapa == MAP_FAILED)
+		return false;
+
+	// Validación de la cabecera y de los límites de las secciones
+	const size_t bytes = st.st_size;
+	const CabeceraPlano &cabecera = *(const CabeceraPlano*)mapa;
+	bool valido =
+		memcmp(cabecera.magia, MAGIA, sizeof(MAGIA)) == 0 &&
+		cabecera.version == VERSION &&
+		cabecera.ordenBytes == ORDEN_BYTES &&
+		cabecera.k > 0 && cabecera.k <= MAX_HIJOS && cabecera.L > 0 &&
+		cabecera.nNodos > 0 &&
+		cabecera.bytes == bytes &&
+		cabecera.bytesOrigen == bytesOrigen &&
+		cabecera.huellaOrigen == huellaOrigen &&
+		cabecera.inicioNodos >= sizeof(CabeceraPlano) &&
+		cabecera.inicioNodos + (uint64_t)cabecera.nNodos*sizeof(NodoPlano) <= cabecera.inicioDescriptores &&
+		cabecera.inicioDescriptores + (uint64_t)cabecera.nNodos*Descriptor::BYTES <= cabecera.inicioPesos &&
+		cabecera.inicioPesos + (uint64_t)cabecera.nPalabras*sizeof(DBoW2::WordValue) <= bytes;
+	// Nodos: los hijos siguen al padre en el orden BFS, de modo que todo descenso termina, y sin índices fuera de rango
+	const NodoPlano *nodos = (const NodoPlano*)((const char*)mapa + cabecera.inicioNodos);
+	for(uint32_t i=0; valido && i<cabecera.nNodos; i++){
+		const NodoPlano &nodo = nodos[i];
+		if(nodo.nHijos)
+			valido = nodo.nHijos <= (uint32_t)cabecera.k && nodo.primerHijo > i && nodo.primerHijo <= cabecera.nNodos - nodo.nHijos;
+		else
+			valido = nodo.palabra < cabecera.nPalabras;
+	}
+
+	if(!valido){
+		munmap(mapa, bytes);
+		return false;
+	}
+
+	LiberarPlano();
+	mpMapa = mapa;
+	mnBytesMapa = bytes;
+	const char *base = (const char*)mapa;
+	mpNodos = (const NodoPlano*)(base + cabecera.inicioNodos);
+	mpDescriptores = (const uchar*)(base + cabecera.inicioDescriptores);
+	mpPesos = (const DBoW2::WordValue*)(base + cabecera.inicioPesos);
+	mnNodos = cabecera.nNodos;
+	mnPalabras = cabecera.nPalabras;
+
+	// Parámetros del vocabulario, sin árbol de DBoW2
+	m_k = cabecera.k;
+	m_L = cabecera.L;
+	m_scoring = (DBoW2::ScoringType)cabecera.scoring;
+	m_weighting = (DBoW2::WeightingType)cabecera.weighting;
+	createScoringObject();
+	m_nodes.clear();
+	m_words.clear();
+
+	return true;
+}
+
+bool ORBVocabulary::ConvertirAPlano(const string &binario, const string &plano){
+	ORBVocabulary vocabulario;
+	if(!vocabulario.loadFromBinaryFile(binario))
+		return false;
+	vocabulario.Aplanar();
+	return vocabulario.GuardarPlano(plano, binario);
+}
+
+void ORBVocabulary::Descender(const uchar *descriptor, const int nivelNodo, DBoW2::WordId &palabra, DBoW2::WordValue &peso, DBoW2::NodeId &nodo) const{
+	const uchar *hijos[MAX_HIJOS];
+	int distancias[MAX_HIJOS];
+
+	nodo = 0;
+	uint32_t actual = 0;
+	int nivel = 0;
+	while(mpNodos[actual].nHijos){
+		nivel++;
+		const uint32_t primero = mpNodos[actual].primerHijo;
+		const int nHijos = mpNodos[actual].nHijos;
+
+		// Los descriptores de los hijos son contiguos
+		const uchar *bloque = mpDescriptores + (size_t)primero*Descriptor::BYTES;
+		for(int j=0; j<nHijos; j++)
+			hijos[j] = bloque + j*Descriptor::BYTES;
+		ORBmatcher::DescriptorDistances(descriptor, hijos, nHijos, distancias);
+
+		// El primero de los más cercanos, como DBoW2
+		int mejor = 0;
+		for(int j=1; j<nHijos; j++)
+			if(distancias[j] < distancias[mejor])
+				mejor = j;
+		actual = primero + mejor;
+
+		if(nivel == nivelNodo)
+			nodo = mpNodos[actual].nodo;
+	}
+
+	palabra = mpNodos[actual].palabra;
+	peso = mpPesos[palabra];
+}
+
+void ORBVocabulary::Transformar(const Descriptores &descriptores, VectorBow &bowVec, VectorFeatures &featVec, int nivelesArriba,
+		vector<DBoW2::WordId> *palabras, vector<DBoW2::WordValue> *pesos) const{
+	const int n = descriptores.rows();
+	vector<DBoW2::WordId> vPalabras(n);
+	vector<DBoW2::WordValue> vPesos(n);
+
+	if(!Plano()){
+		// Árbol de DBoW2, versión modificada de transform que informa palabra y peso de cada descriptor
+		vector<cv::Mat> vDescriptores = Converter::toDescriptorVector(descriptores);
+		DBoW2::BowVector bv;
+		DBoW2::FeatureVector fv;
+		transform(vDescriptores, bv, fv, vPalabras, vPesos, nivelesArriba);
+		bowVec.Construir(bv);
+		featVec.Construir(fv);
+	} else {
+		vector<DBoW2::NodeId> vNodos(n);
+		const int nivelNodo = m_L - nivelesArriba;
+		auto descenderLote = [&](int lote){
+			const int fin = min(n, (lote+1)*LOTE);
+			for(int i=lote*LOTE; i<fin; i++)
+				Descender(descriptores.ptr(i), nivelNodo, vPalabras[i], vPesos[i], vNodos[i]);
+		};
+
+		const int nLotes = (n+LOTE-1)/LOTE;
+		if(mpPool)
+			mpPool->ParallelFor(nLotes, descenderLote);
+		else
+			for(int lote=0; lote<nLotes; lote++)
+				descenderLote(lote);
+
+		bowVec.Construir(vPalabras, vPesos);
+		featVec.Construir(vNodos);
+	}
+
+	if(palabras)
+		palabras->swap(vPalabras);
+	if(pesos)
+		pesos->swap(vPesos);
+}
+
+}// namespace ORB_SLAM2
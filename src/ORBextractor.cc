@@ -59,6 +59,10 @@
 #include <opencv2/features2d/features2d.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <vector>
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 #include "ORBextractor.h"
 
@@ -78,6 +82,15 @@ const int HALF_PATCH_SIZE = 15;
 /** Umbral de los bordes, en píxeles.*/
 const int EDGE_THRESHOLD = 19;
 
+/** Lado de las teselas en que se desenfoca cada nivel para computar descriptores, en píxeles.*/
+const int TAMANO_TESELA = 32;
+
+/**
+ * Distancia máxima, en píxeles, entre un punto singular y los píxeles que lee su descriptor.
+ * El patrón BRIEF rotado llega a 13*sqrt(2), que redondea a 18.
+ */
+const int RADIO_DESCRIPTOR = 18;
+
 
 /**
  * Calcula la orientación de un punto singular.
@@ -127,7 +140,7 @@ const float factorPI = (float)(CV_PI/180.f);
  * @param pattern Siempre el mismo, patrón de coordenadas para la evaluación BRIEF.
  * @param desc Descriptor resultado, de 256 bits (32 bytes, 4 int).
  *
- * Invocado sólo desde computeDescriptors.
+ * Invocado sólo desde computeOrbDescriptorsScalar, el núcleo escalar de computeDescriptors.
  */
 static void computeOrbDescriptor(const KeyPoint& kpt,
                                  const Mat& img, const Point* pattern,
@@ -440,10 +453,14 @@ static int bit_pattern_31_[256*4] =
 };
 
 ORBextractor::ORBextractor(int _nfeatures, float _scaleFactor, int _nlevels,
-         int _iniThFAST, int _minThFAST):
+         int _iniThFAST, int _minThFAST, int _nThreads):
     nfeatures(_nfeatures), scaleFactor(_scaleFactor), nlevels(_nlevels),
-    iniThFAST(_iniThFAST), minThFAST(_minThFAST)
+    iniThFAST(_iniThFAST), minThFAST(_minThFAST), mpWorkerPool(NULL)
 {
+    // Sin pool con un único hilo: el procesamiento es secuencial, como antes.
+    if(_nThreads>1)
+        mpWorkerPool = new WorkerPool(min(_nThreads, _nlevels), "ORBextractor");
+
     mvScaleFactor.resize(nlevels);
     mvLevelSigma2.resize(nlevels);
     mvScaleFactor[0]=1.0f;
@@ -463,19 +480,11 @@ ORBextractor::ORBextractor(int _nfeatures, float _scaleFactor, int _nlevels,
     }
 
     mvImagePyramid.resize(nlevels);
+    mvQuadtree.resize(nlevels);
+    mvTrabajoDescriptores.resize(nlevels);
 
     mnFeaturesPerLevel.resize(nlevels);
-    float factor = 1.0f / scaleFactor;
-    float nDesiredFeaturesPerScale = nfeatures*(1 - factor)/(1 - (float)pow((double)factor, (double)nlevels));
-
-    int sumFeatures = 0;
-    for( int level = 0; level < nlevels-1; level++ )
-    {
-        mnFeaturesPerLevel[level] = cvRound(nDesiredFeaturesPerScale);
-        sumFeatures += mnFeaturesPerLevel[level];
-        nDesiredFeaturesPerScale *= factor;
-    }
-    mnFeaturesPerLevel[nlevels-1] = std::max(nfeatures - sumFeatures, 0);
+    DistribuirFeatures(nfeatures, nlevels);
 
     const int npoints = 512;
     const Point* pattern0 = (const Point*)bit_pattern_31_;
@@ -501,6 +510,11 @@ ORBextractor::ORBextractor(int _nfeatures, float _scaleFactor, int _nlevels,
     }
 }
 
+ORBextractor::~ORBextractor()
+{
+    delete mpWorkerPool;
+}
+
 static void computeOrientation(const Mat& image, vector<KeyPoint>& keypoints, const vector<int>& umax)
 {
     for (vector<KeyPoint>::iterator keypoint = keypoints.begin(),
@@ -510,260 +524,232 @@ static void computeOrientation(const Mat& image, vector<KeyPoint>& keypoints, co
     }
 }
 
-void ExtractorNode::DivideNode(ExtractorNode &n1, ExtractorNode &n2, ExtractorNode &n3, ExtractorNode &n4)
+void ORBextractor::DivideNode(QuadtreeArena &arena, const int nodo, int hijos[4])
 {
+    // Copia, los push_back pueden reubicar vNodes
+    const ExtractorNode padre = arena.vNodes[nodo];
+    const cv::Point2i &UL = padre.UL, &UR = padre.UR, &BL = padre.BL, &BR = padre.BR;
+
     const int halfX = ceil(static_cast<float>(UR.x-UL.x)/2);
     const int halfY = ceil(static_cast<float>(BR.y-UL.y)/2);
 
+    ExtractorNode n1, n2, n3, n4;
+
     //Define boundaries of childs
     n1.UL = UL;
     n1.UR = cv::Point2i(UL.x+halfX,UL.y);
     n1.BL = cv::Point2i(UL.x,UL.y+halfY);
     n1.BR = cv::Point2i(UL.x+halfX,UL.y+halfY);
-    n1.vKeys.reserve(vKeys.size());
 
     n2.UL = n1.UR;
     n2.UR = UR;
     n2.BL = n1.BR;
     n2.BR = cv::Point2i(UR.x,UL.y+halfY);
-    n2.vKeys.reserve(vKeys.size());
 
     n3.UL = n1.BL;
     n3.UR = n1.BR;
     n3.BL = BL;
     n3.BR = cv::Point2i(n1.BR.x,BL.y);
-    n3.vKeys.reserve(vKeys.size());
 
     n4.UL = n3.UR;
     n4.UR = n2.BR;
     n4.BL = n3.BR;
     n4.BR = BR;
-    n4.vKeys.reserve(vKeys.size());
 
-    //Associate points to childs
-    for(size_t i=0;i<vKeys.size();i++)
+    // Associate points to childs
+    // Los puntos del padre se reparten en el otro buffer, en el mismo rango, sin copiarlos de vuelta.
+    const float xm = n1.UR.x, ym = n1.BR.y;
+    const QuadtreeArena::Punto *origen = padre.bAux? arena.vAux.data() : arena.vPuntos.data();
+    QuadtreeArena::Punto *destino = padre.bAux? arena.vPuntos.data() : arena.vAux.data();
+
+    // Cuenta cuántos puntos van a cada hijo: 0 arriba a la izquierda, 1 arriba a la derecha, 2 abajo a la izquierda, 3 abajo a la derecha
+    int cuenta[4] = {0,0,0,0};
+    for(int i=padre.iniKeys; i<padre.finKeys; i++)
+        cuenta[(origen[i].x<xm? 0:1) + (origen[i].y<ym? 0:2)]++;
+
+    // Partición estable del rango del padre en los rangos consecutivos de los hijos
+    ExtractorNode* n[4] = {&n1, &n2, &n3, &n4};
+    int posicion[4];
+    int ini = padre.iniKeys;
+    for(int k=0; k<4; k++)
     {
-        const cv::KeyPoint &kp = vKeys[i];
-        if(kp.pt.x<n1.UR.x)
-        {
-            if(kp.pt.y<n1.BR.y)
-                n1.vKeys.push_back(kp);
-            else
-                n3.vKeys.push_back(kp);
-        }
-        else if(kp.pt.y<n1.BR.y)
-            n2.vKeys.push_back(kp);
-        else
-            n4.vKeys.push_back(kp);
+        n[k]->iniKeys = ini;
+        n[k]->finKeys = ini + cuenta[k];
+        n[k]->bAux = !padre.bAux;
+        n[k]->bNoMore = cuenta[k]==1;
+        posicion[k] = ini;
+        ini += cuenta[k];
     }
+    for(int i=padre.iniKeys; i<padre.finKeys; i++)
+        destino[posicion[(origen[i].x<xm? 0:1) + (origen[i].y<ym? 0:2)]++] = origen[i];
 
-    if(n1.vKeys.size()==1)
-        n1.bNoMore = true;
-    if(n2.vKeys.size()==1)
-        n2.bNoMore = true;
-    if(n3.vKeys.size()==1)
-        n3.bNoMore = true;
-    if(n4.vKeys.size()==1)
-        n4.bNoMore = true;
-
+    for(int k=0; k<4; k++)
+    {
+        hijos[k] = arena.vNodes.size();
+        arena.vNodes.push_back(*n[k]);
+    }
 }
 
 vector<cv::KeyPoint> ORBextractor::DistributeOctTree(const vector<cv::KeyPoint>& vToDistributeKeys, const int &minX,
                                        const int &maxX, const int &minY, const int &maxY, const int &N, const int &level)
 {
+    QuadtreeArena &arena = mvQuadtree[level];
+    arena.clear();
+
+    const int nKeys = vToDistributeKeys.size();
+    arena.vPuntos.resize(nKeys);
+    arena.vAux.resize(nKeys);
+    arena.vNodoInicial.resize(nKeys);
+
     // Compute how many initial nodes   
     const int nIni = round(static_cast<float>(maxX-minX)/(maxY-minY));
 
     const float hX = static_cast<float>(maxX-minX)/nIni;
 
-    list<ExtractorNode> lNodes;
-
-    vector<ExtractorNode*> vpIniNodes;
-    vpIniNodes.resize(nIni);
-
+    // Nodos iniciales, en orden, como si se agregaran al final de la lista
+    arena.vNodes.resize(nIni);
     for(int i=0; i<nIni; i++)
     {
-        ExtractorNode ni;
+        ExtractorNode &ni = arena.vNodes[i];
+        ni = ExtractorNode();
         ni.UL = cv::Point2i(hX*static_cast<float>(i),0);
         ni.UR = cv::Point2i(hX*static_cast<float>(i+1),0);
         ni.BL = cv::Point2i(ni.UL.x,maxY-minY);
         ni.BR = cv::Point2i(ni.UR.x,maxY-minY);
-        ni.vKeys.reserve(vToDistributeKeys.size());
-
-        lNodes.push_back(ni);
-        vpIniNodes[i] = &lNodes.back();
+        ni.iniKeys = ni.finKeys = 0;
+        ni.bAux = false;
     }
 
-    //Associate points to childs
-    for(size_t i=0;i<vToDistributeKeys.size();i++)
+    //Associate points to childs: ordenamiento por conteo, estable
+    int *nodoInicial = arena.vNodoInicial.data();
+    for(int i=0;i<nKeys;i++)
+    {
+        nodoInicial[i] = vToDistributeKeys[i].pt.x/hX;
+        arena.vNodes[nodoInicial[i]].finKeys++;
+    }
+    int ini = 0;
+    for(int i=0; i<nIni; i++)
+    {
+        ExtractorNode &ni = arena.vNodes[i];
+        const int cantidad = ni.finKeys;
+        ni.iniKeys = ni.finKeys = ini;
+        ini += cantidad;
+    }
+    for(int i=0;i<nKeys;i++)
     {
         const cv::KeyPoint &kp = vToDistributeKeys[i];
-        vpIniNodes[kp.pt.x/hX]->vKeys.push_back(kp);
+        QuadtreeArena::Punto &punto = arena.vPuntos[arena.vNodes[nodoInicial[i]].finKeys++];
+        punto.x = kp.pt.x;
+        punto.y = kp.pt.y;
+        punto.response = kp.response;
+        punto.indice = i;
     }
 
-    list<ExtractorNode>::iterator lit = lNodes.begin();
-
-    while(lit!=lNodes.end())
+    // Lista de nodos vivos, sin nodos vacíos
+    for(int i=nIni-1; i>=0; i--)
     {
-        if(lit->vKeys.size()==1)
-        {
-            lit->bNoMore=true;
-            lit++;
-        }
-        else if(lit->vKeys.empty())
-            lit = lNodes.erase(lit);
-        else
-            lit++;
+        ExtractorNode &ni = arena.vNodes[i];
+        if(ni.size()==1)
+            ni.bNoMore=true;
+        if(ni.size()>0)
+            arena.push_front(i);
     }
 
     bool bFinish = false;
 
     int iteration = 0;
 
-    vector<pair<int,ExtractorNode*> > vSizeAndPointerToNode;
-    vSizeAndPointerToNode.reserve(lNodes.size()*4);
+    vector<pair<int,int> > &vSizeAndNode = arena.vSizeAndNode;
+    vector<pair<int,int> > &vPrevSizeAndNode = arena.vPrevSizeAndNode;
+    int hijos[4];
 
     while(!bFinish)
     {
         iteration++;
 
-        int prevSize = lNodes.size();
+        int prevSize = arena.nNodos;
 
-        lit = lNodes.begin();
+        int lit = arena.primero;
 
         int nToExpand = 0;
 
-        vSizeAndPointerToNode.clear();
+        vSizeAndNode.clear();
 
-        while(lit!=lNodes.end())
+        while(lit>=0)
         {
-            if(lit->bNoMore)
+            if(arena.vNodes[lit].bNoMore)
             {
                 // If node only contains one point do not subdivide and continue
-                lit++;
+                lit = arena.vNodes[lit].siguiente;
                 continue;
             }
             else
             {
                 // If more than one point, subdivide
-                ExtractorNode n1,n2,n3,n4;
-                lit->DivideNode(n1,n2,n3,n4);
+                DivideNode(arena, lit, hijos);
 
                 // Add childs if they contain points
-                if(n1.vKeys.size()>0)
-                {
-                    lNodes.push_front(n1);                    
-                    if(n1.vKeys.size()>1)
-                    {
-                        nToExpand++;
-                        vSizeAndPointerToNode.push_back(make_pair(n1.vKeys.size(),&lNodes.front()));
-                        lNodes.front().lit = lNodes.begin();
-                    }
-                }
-                if(n2.vKeys.size()>0)
+                for(int k=0; k<4; k++)
                 {
-                    lNodes.push_front(n2);
-                    if(n2.vKeys.size()>1)
+                    const int nKeysHijo = arena.vNodes[hijos[k]].size();
+                    if(nKeysHijo>0)
                     {
-                        nToExpand++;
-                        vSizeAndPointerToNode.push_back(make_pair(n2.vKeys.size(),&lNodes.front()));
-                        lNodes.front().lit = lNodes.begin();
-                    }
-                }
-                if(n3.vKeys.size()>0)
-                {
-                    lNodes.push_front(n3);
-                    if(n3.vKeys.size()>1)
-                    {
-                        nToExpand++;
-                        vSizeAndPointerToNode.push_back(make_pair(n3.vKeys.size(),&lNodes.front()));
-                        lNodes.front().lit = lNodes.begin();
-                    }
-                }
-                if(n4.vKeys.size()>0)
-                {
-                    lNodes.push_front(n4);
-                    if(n4.vKeys.size()>1)
-                    {
-                        nToExpand++;
-                        vSizeAndPointerToNode.push_back(make_pair(n4.vKeys.size(),&lNodes.front()));
-                        lNodes.front().lit = lNodes.begin();
+                        arena.push_front(hijos[k]);
+                        if(nKeysHijo>1)
+                        {
+                            nToExpand++;
+                            vSizeAndNode.push_back(make_pair(nKeysHijo,hijos[k]));
+                        }
                     }
                 }
 
-                lit=lNodes.erase(lit);
+                lit = arena.erase(lit);
                 continue;
             }
         }       
 
         // Finish if there are more nodes than required features
         // or all nodes contain just one point
-        if((int)lNodes.size()>=N || (int)lNodes.size()==prevSize)
+        if(arena.nNodos>=N || arena.nNodos==prevSize)
         {
             bFinish = true;
         }
-        else if(((int)lNodes.size()+nToExpand*3)>N)
+        else if((arena.nNodos+nToExpand*3)>N)
         {
 
             while(!bFinish)
             {
 
-                prevSize = lNodes.size();
+                prevSize = arena.nNodos;
 
-                vector<pair<int,ExtractorNode*> > vPrevSizeAndPointerToNode = vSizeAndPointerToNode;
-                vSizeAndPointerToNode.clear();
+                vPrevSizeAndNode = vSizeAndNode;
+                vSizeAndNode.clear();
 
-                sort(vPrevSizeAndPointerToNode.begin(),vPrevSizeAndPointerToNode.end());
-                for(int j=vPrevSizeAndPointerToNode.size()-1;j>=0;j--)
+                // Con igual cantidad de puntos, se desempata por índice de nodo, es decir por orden de creación.
+                sort(vPrevSizeAndNode.begin(),vPrevSizeAndNode.end());
+                for(int j=vPrevSizeAndNode.size()-1;j>=0;j--)
                 {
-                    ExtractorNode n1,n2,n3,n4;
-                    vPrevSizeAndPointerToNode[j].second->DivideNode(n1,n2,n3,n4);
+                    DivideNode(arena, vPrevSizeAndNode[j].second, hijos);
 
                     // Add childs if they contain points
-                    if(n1.vKeys.size()>0)
-                    {
-                        lNodes.push_front(n1);
-                        if(n1.vKeys.size()>1)
-                        {
-                            vSizeAndPointerToNode.push_back(make_pair(n1.vKeys.size(),&lNodes.front()));
-                            lNodes.front().lit = lNodes.begin();
-                        }
-                    }
-                    if(n2.vKeys.size()>0)
+                    for(int k=0; k<4; k++)
                     {
-                        lNodes.push_front(n2);
-                        if(n2.vKeys.size()>1)
+                        const int nKeysHijo = arena.vNodes[hijos[k]].size();
+                        if(nKeysHijo>0)
                         {
-                            vSizeAndPointerToNode.push_back(make_pair(n2.vKeys.size(),&lNodes.front()));
-                            lNodes.front().lit = lNodes.begin();
-                        }
-                    }
-                    if(n3.vKeys.size()>0)
-                    {
-                        lNodes.push_front(n3);
-                        if(n3.vKeys.size()>1)
-                        {
-                            vSizeAndPointerToNode.push_back(make_pair(n3.vKeys.size(),&lNodes.front()));
-                            lNodes.front().lit = lNodes.begin();
-                        }
-                    }
-                    if(n4.vKeys.size()>0)
-                    {
-                        lNodes.push_front(n4);
-                        if(n4.vKeys.size()>1)
-                        {
-                            vSizeAndPointerToNode.push_back(make_pair(n4.vKeys.size(),&lNodes.front()));
-                            lNodes.front().lit = lNodes.begin();
+                            arena.push_front(hijos[k]);
+                            if(nKeysHijo>1)
+                                vSizeAndNode.push_back(make_pair(nKeysHijo,hijos[k]));
                         }
                     }
 
-                    lNodes.erase(vPrevSizeAndPointerToNode[j].second->lit);
+                    arena.erase(vPrevSizeAndNode[j].second);
 
-                    if((int)lNodes.size()>=N)
+                    if(arena.nNodos>=N)
                         break;
                 }
 
-                if((int)lNodes.size()>=N || (int)lNodes.size()==prevSize)
+                if(arena.nNodos>=N || arena.nNodos==prevSize)
                     bFinish = true;
 
             }
@@ -773,139 +759,468 @@ vector<cv::KeyPoint> ORBextractor::DistributeOctTree(const vector<cv::KeyPoint>&
     // Retain the best point in each node
     vector<cv::KeyPoint> vResultKeys;
     vResultKeys.reserve(nfeatures);
-    for(list<ExtractorNode>::iterator lit=lNodes.begin(); lit!=lNodes.end(); lit++)
+    for(int lit=arena.primero; lit>=0; lit=arena.vNodes[lit].siguiente)
     {
-        vector<cv::KeyPoint> &vNodeKeys = lit->vKeys;
-        cv::KeyPoint* pKP = &vNodeKeys[0];
-        float maxResponse = pKP->response;
+        const ExtractorNode &nodo = arena.vNodes[lit];
+        const QuadtreeArena::Punto *puntos = nodo.bAux? arena.vAux.data() : arena.vPuntos.data();
+        int mejor = puntos[nodo.iniKeys].indice;
+        float maxResponse = puntos[nodo.iniKeys].response;
 
-        for(size_t k=1;k<vNodeKeys.size();k++)
+        for(int k=nodo.iniKeys+1;k<nodo.finKeys;k++)
         {
-            if(vNodeKeys[k].response>maxResponse)
+            const QuadtreeArena::Punto &kp = puntos[k];
+            if(kp.response>maxResponse)
             {
-                pKP = &vNodeKeys[k];
-                maxResponse = vNodeKeys[k].response;
+                mejor = kp.indice;
+                maxResponse = kp.response;
             }
         }
 
-        vResultKeys.push_back(*pKP);
+        vResultKeys.push_back(vToDistributeKeys[mejor]);
     }
 
     return vResultKeys;
 }
 
-void ORBextractor::ComputeKeyPointsOctTree(vector<vector<KeyPoint> >& allKeypoints)
+void ORBextractor::DistribuirFeatures(const int nFeatures, const int nNiveles)
 {
-    allKeypoints.resize(nlevels);
+    mnFeaturesPresupuesto = nFeatures;
+    mnNivelesUsados = nNiveles;
 
-    const float W = 30;
+    // Serie geométrica sobre los niveles usados; los demás no reciben puntos singulares
+    float factor = 1.0f / scaleFactor;
+    float nDesiredFeaturesPerScale = nFeatures*(1 - factor)/(1 - (float)pow((double)factor, (double)nNiveles));
 
-    // Procede para cada nivel de la pirámide
-    for (int level = 0; level < nlevels; ++level)
+    int sumFeatures = 0;
+    for( int level = 0; level < nNiveles-1; level++ )
     {
-        // Bordes de la imagen con un umbral
-    	const int minBorderX = EDGE_THRESHOLD-3;
-        const int minBorderY = minBorderX;
-        const int maxBorderX = mvImagePyramid[level].cols-EDGE_THRESHOLD+3;
-        const int maxBorderY = mvImagePyramid[level].rows-EDGE_THRESHOLD+3;
+        mnFeaturesPerLevel[level] = cvRound(nDesiredFeaturesPerScale);
+        sumFeatures += mnFeaturesPerLevel[level];
+        nDesiredFeaturesPerScale *= factor;
+    }
+    mnFeaturesPerLevel[nNiveles-1] = std::max(nFeatures - sumFeatures, 0);
+    for( int level = nNiveles; level < nlevels; level++ )
+        mnFeaturesPerLevel[level] = 0;
+}
 
-        vector<cv::KeyPoint> vToDistributeKeys;
-        vToDistributeKeys.reserve(nfeatures*10);
+void ORBextractor::SetPresupuesto(int nFeatures, int nNiveles)
+{
+    nFeatures = std::min(std::max(nFeatures, 1), nfeatures);
+    nNiveles = std::min(std::max(nNiveles, 1), nlevels);
+    if(nFeatures != mnFeaturesPresupuesto || nNiveles != mnNivelesUsados)
+        DistribuirFeatures(nFeatures, nNiveles);
+}
 
-        // Dimensiones de la imagen descontando el umbral
-        const float width = (maxBorderX-minBorderX);
-        const float height = (maxBorderY-minBorderY);
+void ORBextractor::ComputeKeyPointsOctTree(vector<vector<KeyPoint> >& allKeypoints)
+{
+    allKeypoints.resize(nlevels);
 
-        // División de la imagen en una grilla de celdas de 30x30 (WxW) píxeles.
-        const int nCols = width/W;
-        const int nRows = height/W;
-        const int wCell = ceil(width/nCols);
-        const int hCell = ceil(height/nRows);
+    // Los niveles de la pirámide son independientes entre sí, se procesan en paralelo si hay pool.
+    if(mpWorkerPool)
+        mpWorkerPool->ParallelFor(nlevels, [&](int level){ComputeKeyPointsLevel(level, allKeypoints[level]);});
+    else
+        for (int level = 0; level < nlevels; ++level)
+            ComputeKeyPointsLevel(level, allKeypoints[level]);
+}
 
-        // Recorre las filas de la grilla
-        for(int i=0; i<nRows; i++)
-        {
-            const float iniY =minBorderY+i*hCell;
-            float maxY = iniY+hCell+6;
+void ORBextractor::ComputeKeyPointsLevel(const int level, vector<KeyPoint>& keypoints)
+{
+    // Nivel fuera del presupuesto: ni FAST ni distribución
+    if(mnFeaturesPerLevel[level]==0)
+    {
+        keypoints.clear();
+        return;
+    }
 
-            if(iniY>=maxBorderY-3)
-                continue;
-            if(maxY>maxBorderY)
-                maxY = maxBorderY;
+    const float W = 30;
 
-            // Para cada fila recorre las columnas o celdas
+    // Bordes de la imagen con un umbral
+    const int minBorderX = EDGE_THRESHOLD-3;
+    const int minBorderY = minBorderX;
+    const int maxBorderX = mvImagePyramid[level].cols-EDGE_THRESHOLD+3;
+    const int maxBorderY = mvImagePyramid[level].rows-EDGE_THRESHOLD+3;
+
+    vector<cv::KeyPoint> vToDistributeKeys;
+    vToDistributeKeys.reserve(nfeatures*10);
+
+    // Dimensiones de la imagen descontando el umbral
+    const float width = (maxBorderX-minBorderX);
+    const float height = (maxBorderY-minBorderY);
+
+    // División de la imagen en una grilla de celdas de 30x30 (WxW) píxeles.
+    const int nCols = width/W;
+    const int nRows = height/W;
+    const int wCell = ceil(width/nCols);
+    const int hCell = ceil(height/nRows);
+
+    // Una única pasada de FAST sobre todo el nivel, con el umbral laxo.
+    // La respuesta de cada punto es su puntaje FAST: un punto con respuesta >= iniThFAST es también esquina con el umbral inicial,
+    // y la supresión de no máximos conserva los mismos puntos de umbral inicial que una pasada con ese umbral.
+    // FAST descarta 3 píxeles de borde, de modo que las coordenadas resultan relativas a (minBorderX, minBorderY).
+    vector<cv::KeyPoint> vKeysNivel;
+    vKeysNivel.reserve(nfeatures*10);
+    const int nCeldas = nRows*nCols;
+    if(mIntegralMascara.empty())
+        FAST(mvImagePyramid[level].rowRange(minBorderY,maxBorderY).colRange(minBorderX,maxBorderX),
+             vKeysNivel,minThFAST,true);
+    else
+    {
+        // Con máscara, FAST sólo en las celdas que tocan las regiones de interés.
+        // La celda se lleva al nivel 0 con el factor de escala y se consulta la imagen integral de la máscara.
+        const float escala = mvScaleFactor[level];
+        const int anchoMascara = mIntegralMascara.cols-1, altoMascara = mIntegralMascara.rows-1;
+        vector<bool> vbCeldaActiva(nCeldas);
+        for(int i=0; i<nRows; i++)
+        {
+            const int y0 = min(cvFloor((minBorderY + i*hCell)*escala), altoMascara);
+            const int y1 = min(cvCeil((minBorderY + (i+1)*hCell)*escala), altoMascara);
+            const int *fila0 = mIntegralMascara.ptr<int>(y0), *fila1 = mIntegralMascara.ptr<int>(y1);
             for(int j=0; j<nCols; j++)
             {
-                const float iniX =minBorderX+j*wCell;
-                float maxX = iniX+wCell+6;
-                if(iniX>=maxBorderX-6)
-                    continue;
-                if(maxX>maxBorderX)
-                    maxX = maxBorderX;
-
-                // Detecta puntos singulares en la celda
-                vector<cv::KeyPoint> vKeysCell;
-                FAST(mvImagePyramid[level].rowRange(iniY,maxY).colRange(iniX,maxX),
-                     vKeysCell,iniThFAST,true);
+                const int x0 = min(cvFloor((minBorderX + j*wCell)*escala), anchoMascara);
+                const int x1 = min(cvCeil((minBorderX + (j+1)*wCell)*escala), anchoMascara);
+                vbCeldaActiva[i*nCols+j] = fila1[x1] - fila1[x0] - fila0[x1] + fila0[x0] > 0;
+            }
+        }
 
-                // Si no encontró ningún punto singular, repite la detección con un umbral laxo.
-                if(vKeysCell.empty())
+        // Una pasada de FAST por cada tramo horizontal de celdas activas, con 3 píxeles de margen que FAST descarta.
+        // Las coordenadas se llevan a relativas a (minBorderX, minBorderY), como en la pasada única.
+        vector<cv::KeyPoint> vKeysTramo;
+        for(int i=0; i<nRows; i++)
+        {
+            int j=0;
+            while(j<nCols)
+            {
+                if(!vbCeldaActiva[i*nCols+j])
                 {
-                    FAST(mvImagePyramid[level].rowRange(iniY,maxY).colRange(iniX,maxX),
-                         vKeysCell,minThFAST,true);
+                    j++;
+                    continue;
                 }
-
-                // Los puntos detectados en esta celda se acumulan en vToDistributeKeys hasta completar la grilla en un nivel de la pirámde.
-                if(!vKeysCell.empty())
+                const int j0 = j;
+                while(j<nCols && vbCeldaActiva[i*nCols+j])
+                    j++;
+
+                const int x0 = max(j0*wCell-3, 0), x1 = min(j*wCell+3, (int)width);
+                const int y0 = max(i*hCell-3, 0), y1 = min((i+1)*hCell+3, (int)height);
+                vKeysTramo.clear();
+                FAST(mvImagePyramid[level].rowRange(minBorderY+y0,minBorderY+y1).colRange(minBorderX+x0,minBorderX+x1),
+                     vKeysTramo,minThFAST,true);
+                for(cv::KeyPoint &kp : vKeysTramo)
                 {
-                    for(vector<cv::KeyPoint>::iterator vit=vKeysCell.begin(); vit!=vKeysCell.end();vit++)
-                    {
-                        (*vit).pt.x+=j*wCell;
-                        (*vit).pt.y+=i*hCell;
-                        vToDistributeKeys.push_back(*vit);
-                    }
+                    kp.pt.x += x0;
+                    kp.pt.y += y0;
+                    vKeysNivel.push_back(kp);
                 }
-
             }
         }
+    }
 
-        vector<KeyPoint> & keypoints = allKeypoints[level];
-        keypoints.reserve(nfeatures);
+    // Celda de cada punto, y celdas con algún punto que supera el umbral inicial
+    const int nKeysNivel = vKeysNivel.size();
+    vector<int> vCelda(nKeysNivel);
+    vector<bool> vbUmbralInicial(nCeldas, false);
+    for(int k=0; k<nKeysNivel; k++)
+    {
+        const cv::KeyPoint &kp = vKeysNivel[k];
+        const int j = min((int)(kp.pt.x/wCell), nCols-1);
+        const int i = min((int)(kp.pt.y/hCell), nRows-1);
+        vCelda[k] = i*nCols+j;
+        if(kp.response>=iniThFAST)
+            vbUmbralInicial[vCelda[k]] = true;
+    }
 
-        // Adelgaza el vector de puntos singulares, dispersando con octree.
-        keypoints = DistributeOctTree(vToDistributeKeys, minBorderX, maxBorderX,
-                                      minBorderY, maxBorderY,mnFeaturesPerLevel[level], level);
+    // Como con FAST por celda: si la celda tiene puntos con el umbral inicial sólo se toman ésos, si no se toman los del umbral laxo.
+    // Se descartan los demás, y los sobrevivientes se ordenan por celda, fila por fila, con un ordenamiento por conteo.
+    vector<int> vInicioCelda(nCeldas+1, 0);
+    for(int k=0; k<nKeysNivel; k++)
+    {
+        if(vbUmbralInicial[vCelda[k]] && vKeysNivel[k].response<iniThFAST)
+            vCelda[k] = -1;
+        else
+            vInicioCelda[vCelda[k]+1]++;
+    }
+    for(int c=0; c<nCeldas; c++)
+        vInicioCelda[c+1] += vInicioCelda[c];
 
-        const int scaledPatchSize = PATCH_SIZE*mvScaleFactor[level];
+    // Los puntos detectados se acumulan en vToDistributeKeys para distribuirlos en el nivel de la pirámde.
+    vToDistributeKeys.resize(vInicioCelda[nCeldas]);
+    for(int k=0; k<nKeysNivel; k++)
+        if(vCelda[k]>=0)
+            vToDistributeKeys[vInicioCelda[vCelda[k]]++] = vKeysNivel[k];
 
-        // Add border to coordinates and scale information
-        const int nkps = keypoints.size();
-        for(int i=0; i<nkps ; i++)
+    keypoints.reserve(nfeatures);
+
+    // Adelgaza el vector de puntos singulares, dispersando con octree.
+    keypoints = DistributeOctTree(vToDistributeKeys, minBorderX, maxBorderX,
+                                  minBorderY, maxBorderY,mnFeaturesPerLevel[level], level);
+
+    const int scaledPatchSize = PATCH_SIZE*mvScaleFactor[level];
+
+    // Add border to coordinates and scale information
+    const int nkps = keypoints.size();
+    for(int i=0; i<nkps ; i++)
+    {
+        keypoints[i].pt.x+=minBorderX;
+        keypoints[i].pt.y+=minBorderY;
+        keypoints[i].octave=level;
+        keypoints[i].size = scaledPatchSize;
+    }
+
+    // compute orientations
+    computeOrientation(mvImagePyramid[level], keypoints, umax);
+}
+
+
+/**
+ * Patrón BRIEF en formato SoA (structure of arrays) para los núcleos vectoriales.
+ * Las coordenadas de bit_pattern_31_ se separan en primer punto (t0) y segundo punto (t1) de cada par:
+ * x[0..255] e y[0..255] son los t0, x[256..511] e y[256..511] son los t1, en el orden de los bits del descriptor.
+ * Se guardan como float para rotarlas con las mismas operaciones que computeOrbDescriptor, y así obtener el mismo redondeo.
+ */
+struct PatronBRIEF
+{
+    alignas(32) float x[512];
+    alignas(32) float y[512];
+
+    PatronBRIEF()
+    {
+        for(int i=0; i<256; i++)
         {
-            keypoints[i].pt.x+=minBorderX;
-            keypoints[i].pt.y+=minBorderY;
-            keypoints[i].octave=level;
-            keypoints[i].size = scaledPatchSize;
+            x[i]     = (float)bit_pattern_31_[4*i];
+            y[i]     = (float)bit_pattern_31_[4*i+1];
+            x[i+256] = (float)bit_pattern_31_[4*i+2];
+            y[i+256] = (float)bit_pattern_31_[4*i+3];
         }
     }
+};
 
-    // compute orientations
-    for (int level = 0; level < nlevels; ++level)
-        computeOrientation(mvImagePyramid[level], allKeypoints[level], umax);
+/** Único patrón SoA, construido durante la inicialización estática.*/
+static const PatronBRIEF patronBRIEF;
+
+/**
+ * Núcleo escalar: computa los descriptores de los puntos singulares indicados con computeOrbDescriptor.
+ * Usado cuando el procesador no tiene SSE4.1, y como referencia de los núcleos vectoriales.
+ */
+static void computeOrbDescriptorsScalar(const Mat& img, const vector<KeyPoint>& keypoints, const int* indices, const int n,
+                                        Mat& descriptors, const Point* pattern)
+{
+    for (int j = 0; j < n; j++)
+        computeOrbDescriptor(keypoints[indices[j]], img, pattern, descriptors.ptr(indices[j]));
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/**
+ * Núcleo SSE4.1.
+ *
+ * Para cada punto singular rota las 512 coordenadas del patrón de a 4, obteniendo desplazamientos en bytes respecto del centro,
+ * lee los 512 píxeles y compara los 256 pares de a 16, armando 16 bits del descriptor con movemask.
+ * Las operaciones en punto flotante y el redondeo (cvtps, al par más cercano) son los mismos que en computeOrbDescriptor,
+ * de modo que el descriptor es idéntico bit a bit.
+ */
+__attribute__((target("sse4.1")))
+static void computeOrbDescriptorsSSE41(const Mat& img, const vector<KeyPoint>& keypoints, const int* indices, const int n,
+                                       Mat& descriptors)
+{
+    const int step = (int)img.step;
+    const __m128i vstep = _mm_set1_epi32(step);
+    const __m128i signo = _mm_set1_epi8((char)0x80);
+    alignas(16) int off[512];
+    alignas(16) uchar val[512];
+
+    for (int j = 0; j < n; j++)
+    {
+        const int i = indices[j];
+        const KeyPoint& kpt = keypoints[i];
+        float angle = (float)kpt.angle*factorPI;
+        float a = (float)cos(angle), b = (float)sin(angle);
+        const __m128 va = _mm_set1_ps(a), vb = _mm_set1_ps(b);
+
+        const uchar* center = &img.at<uchar>(cvRound(kpt.pt.y), cvRound(kpt.pt.x));
+
+        // Patrón rotado, como desplazamiento respecto del centro
+        for (int k = 0; k < 512; k += 4)
+        {
+            const __m128 x = _mm_load_ps(patronBRIEF.x + k);
+            const __m128 y = _mm_load_ps(patronBRIEF.y + k);
+            const __m128i fila    = _mm_cvtps_epi32(_mm_add_ps(_mm_mul_ps(x, vb), _mm_mul_ps(y, va)));
+            const __m128i columna = _mm_cvtps_epi32(_mm_sub_ps(_mm_mul_ps(x, va), _mm_mul_ps(y, vb)));
+            _mm_store_si128((__m128i*)(off + k), _mm_add_epi32(_mm_mullo_epi32(fila, vstep), columna));
+        }
+
+        for (int k = 0; k < 512; k++)
+            val[k] = center[off[k]];
+
+        // Comparación t0 < t1 sin signo, 16 bits por iteración
+        uchar* desc = descriptors.ptr(i);
+        for (int k = 0; k < 256; k += 16)
+        {
+            const __m128i t0 = _mm_xor_si128(_mm_load_si128((const __m128i*)(val + k)), signo);
+            const __m128i t1 = _mm_xor_si128(_mm_load_si128((const __m128i*)(val + 256 + k)), signo);
+            const unsigned short bits = (unsigned short)_mm_movemask_epi8(_mm_cmplt_epi8(t0, t1));
+            memcpy(desc + k/8, &bits, 2);
+        }
+    }
+}
+
+/**
+ * Núcleo AVX2, igual a computeOrbDescriptorsSSE41 pero de a 8 coordenadas y 32 comparaciones.
+ */
+__attribute__((target("avx2")))
+static void computeOrbDescriptorsAVX2(const Mat& img, const vector<KeyPoint>& keypoints, const int* indices, const int n,
+                                      Mat& descriptors)
+{
+    const int step = (int)img.step;
+    const __m256i vstep = _mm256_set1_epi32(step);
+    const __m256i signo = _mm256_set1_epi8((char)0x80);
+    alignas(32) int off[512];
+    alignas(32) uchar val[512];
+
+    for (int j = 0; j < n; j++)
+    {
+        const int i = indices[j];
+        const KeyPoint& kpt = keypoints[i];
+        float angle = (float)kpt.angle*factorPI;
+        float a = (float)cos(angle), b = (float)sin(angle);
+        const __m256 va = _mm256_set1_ps(a), vb = _mm256_set1_ps(b);
+
+        const uchar* center = &img.at<uchar>(cvRound(kpt.pt.y), cvRound(kpt.pt.x));
+
+        // Patrón rotado, como desplazamiento respecto del centro
+        for (int k = 0; k < 512; k += 8)
+        {
+            const __m256 x = _mm256_load_ps(patronBRIEF.x + k);
+            const __m256 y = _mm256_load_ps(patronBRIEF.y + k);
+            const __m256i fila    = _mm256_cvtps_epi32(_mm256_add_ps(_mm256_mul_ps(x, vb), _mm256_mul_ps(y, va)));
+            const __m256i columna = _mm256_cvtps_epi32(_mm256_sub_ps(_mm256_mul_ps(x, va), _mm256_mul_ps(y, vb)));
+            _mm256_store_si256((__m256i*)(off + k), _mm256_add_epi32(_mm256_mullo_epi32(fila, vstep), columna));
+        }
+
+        for (int k = 0; k < 512; k++)
+            val[k] = center[off[k]];
+
+        // Comparación t0 < t1 sin signo, 32 bits por iteración
+        uchar* desc = descriptors.ptr(i);
+        for (int k = 0; k < 256; k += 32)
+        {
+            const __m256i t0 = _mm256_xor_si256(_mm256_load_si256((const __m256i*)(val + k)), signo);
+            const __m256i t1 = _mm256_xor_si256(_mm256_load_si256((const __m256i*)(val + 256 + k)), signo);
+            const unsigned int bits = (unsigned int)_mm256_movemask_epi8(_mm256_cmpgt_epi8(t1, t0));
+            memcpy(desc + k/8, &bits, 4);
+        }
+    }
 }
 
+#endif
+
+/**
+ * Computa los descriptores de un subconjunto de los puntos singulares de un nivel.
+ * Elige el núcleo una única vez según el procesador: AVX2, SSE4.1 o escalar.  Todos producen descriptores idénticos.
+ *
+ * Los núcleos vectoriales reciben los mismos argumentos excepto pattern.
+ *
+ * @param image Imagen desenfocada del nivel.  Sólo se leen los parches de los puntos indicados.
+ * @param keypoints Puntos singulares del nivel, con su ángulo.
+ * @param indices Índices de los puntos singulares a procesar.
+ * @param n Cantidad de índices.
+ * @param descriptors Matriz de descriptores de keypoints.size() x 32; se escribe la fila de cada índice.
+ * @param pattern Patrón BRIEF, usado por el núcleo escalar.
+ */
+static void computeDescriptors(const Mat& image, const vector<KeyPoint>& keypoints, const int* indices, const int n,
+                               Mat& descriptors, const vector<Point>& pattern)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    enum {ESCALAR, SSE41, AVX2};
+    static const int nucleo = __builtin_cpu_supports("avx2")? AVX2 : __builtin_cpu_supports("sse4.1")? SSE41 : ESCALAR;
+
+    if(nucleo == AVX2)
+        computeOrbDescriptorsAVX2(image, keypoints, indices, n, descriptors);
+    else if(nucleo == SSE41)
+        computeOrbDescriptorsSSE41(image, keypoints, indices, n, descriptors);
+    else
+#endif
+        computeOrbDescriptorsScalar(image, keypoints, indices, n, descriptors, &pattern[0]);
+}
 
-static void computeDescriptors(const Mat& image, vector<KeyPoint>& keypoints, Mat& descriptors,
-                               const vector<Point>& pattern)
+void ORBextractor::ComputeDescriptorsLevel(const int level, const vector<KeyPoint>& keypoints, Mat& descriptors)
 {
-    descriptors = Mat::zeros((int)keypoints.size(), 32, CV_8UC1);
+    const Mat &imagen = mvImagePyramid[level];
+    TrabajoDescriptores &trabajo = mvTrabajoDescriptores[level];
+
+    // Buffer desenfocado del tamaño del nivel, reutilizado entre cuadros.  create no reserva si el tamaño no cambió.
+    trabajo.imagenDesenfocada.create(imagen.size(), CV_8UC1);
+    Mat &desenfocada = trabajo.imagenDesenfocada;
+
+    const int nTeselasX = (imagen.cols + TAMANO_TESELA - 1)/TAMANO_TESELA;
+    const int nTeselasY = (imagen.rows + TAMANO_TESELA - 1)/TAMANO_TESELA;
+    const int nKeys = keypoints.size();
+
+    // Marca las teselas que tocan el parche de algún punto singular, y ordena los puntos por fila de teselas.
+    trabajo.vTeselaNecesaria.assign(nTeselasX*nTeselasY, 0);
+    trabajo.vInicioFila.assign(nTeselasY+1, 0);
+    trabajo.vIndices.resize(nKeys);
+    for(int i=0; i<nKeys; i++)
+    {
+        const int x = cvRound(keypoints[i].pt.x), y = cvRound(keypoints[i].pt.y);
+        const int tx0 = max(x-RADIO_DESCRIPTOR, 0)/TAMANO_TESELA, tx1 = min(x+RADIO_DESCRIPTOR, imagen.cols-1)/TAMANO_TESELA;
+        const int ty0 = max(y-RADIO_DESCRIPTOR, 0)/TAMANO_TESELA, ty1 = min(y+RADIO_DESCRIPTOR, imagen.rows-1)/TAMANO_TESELA;
+        for(int ty=ty0; ty<=ty1; ty++)
+            for(int tx=tx0; tx<=tx1; tx++)
+                trabajo.vTeselaNecesaria[ty*nTeselasX+tx] = 1;
+        trabajo.vInicioFila[y/TAMANO_TESELA+1]++;
+    }
+    for(int ty=0; ty<nTeselasY; ty++)
+        trabajo.vInicioFila[ty+1] += trabajo.vInicioFila[ty];
+    {
+        vector<int> &vPosicion = trabajo.vPosicion;
+        vPosicion.assign(trabajo.vInicioFila.begin(), trabajo.vInicioFila.end()-1);
+        for(int i=0; i<nKeys; i++)
+            trabajo.vIndices[vPosicion[cvRound(keypoints[i].pt.y)/TAMANO_TESELA]++] = i;
+    }
 
-    for (size_t i = 0; i < keypoints.size(); i++)
-        computeOrbDescriptor(keypoints[i], image, &pattern[0], descriptors.ptr((int)i));
+    // Desenfoca una fila de teselas, uniendo las teselas necesarias contiguas en un único rectángulo.
+    // El desenfoque de una región de la imagen lee los píxeles vecinos fuera de ella, incluso el borde de la pirámide,
+    // que replica BORDER_REFLECT_101: el resultado es idéntico al de desenfocar el nivel completo.
+    auto desenfocarFila = [&](int ty)
+    {
+        const uchar* necesaria = &trabajo.vTeselaNecesaria[ty*nTeselasX];
+        const int y0 = ty*TAMANO_TESELA, y1 = min(y0+TAMANO_TESELA, imagen.rows);
+        for(int tx=0; tx<nTeselasX; )
+        {
+            if(!necesaria[tx])
+            {
+                tx++;
+                continue;
+            }
+            int txFin = tx+1;
+            while(txFin<nTeselasX && necesaria[txFin])
+                txFin++;
+
+            const int x0 = tx*TAMANO_TESELA, x1 = min(txFin*TAMANO_TESELA, imagen.cols);
+            const Rect rect(x0, y0, x1-x0, y1-y0);
+            Mat destino = desenfocada(rect);
+            GaussianBlur(imagen(rect), destino, Size(7, 7), 2, 2, BORDER_REFLECT_101);
+            tx = txFin;
+        }
+    };
+
+    // Los parches de los puntos de una fila de teselas sólo llegan a la fila siguiente (RADIO_DESCRIPTOR < TAMANO_TESELA),
+    // de modo que cada fila se desenfoca una vez, justo antes de computar los descriptores que la necesitan.
+    if(nTeselasY>0)
+        desenfocarFila(0);
+    for(int ty=0; ty<nTeselasY; ty++)
+    {
+        if(ty+1<nTeselasY)
+            desenfocarFila(ty+1);
+
+        const int ini = trabajo.vInicioFila[ty], fin = trabajo.vInicioFila[ty+1];
+        if(fin>ini)
+            computeDescriptors(desenfocada, keypoints, &trabajo.vIndices[ini], fin-ini, descriptors, pattern);
+    }
 }
 
 void ORBextractor::operator()( InputArray _image, InputArray _mask, vector<KeyPoint>& _keypoints,
-                      OutputArray _descriptors)
+                      Descriptores& _descriptors)
 { 
     if(_image.empty())
         return;
@@ -916,44 +1231,53 @@ void ORBextractor::operator()( InputArray _image, InputArray _mask, vector<KeyPo
     // Pre-compute the scale pyramid
     ComputePyramid(image);
 
+    // Máscara de regiones de interés: imagen integral de la máscara binarizada, para consultar celdas en tiempo constante
+    if(_mask.empty())
+        mIntegralMascara.release();
+    else
+    {
+        Mat mask = _mask.getMat();
+        assert(mask.type() == CV_8UC1 && mask.size() == image.size());
+        threshold(mask, mMascaraBinaria, 0, 1, THRESH_BINARY);
+        integral(mMascaraBinaria, mIntegralMascara, CV_32S);
+    }
+
     vector < vector<KeyPoint> > allKeypoints;
     ComputeKeyPointsOctTree(allKeypoints);
     //ComputeKeyPointsOld(allKeypoints);
 
-    Mat descriptors;
-
     int nkeypoints = 0;
     for (int level = 0; level < nlevels; ++level)
         nkeypoints += (int)allKeypoints[level].size();
-    if( nkeypoints == 0 )
-        _descriptors.release();
-    else
-    {
-        _descriptors.create(nkeypoints, 32, CV_8U);
-        descriptors = _descriptors.getMat();
-    }
+
+    // Los descriptores se escriben directamente en el buffer alineado, a través de una vista Mat.
+    _descriptors.create(nkeypoints);
+    Mat descriptors = _descriptors.toMat();
 
     _keypoints.clear();
     _keypoints.reserve(nkeypoints);
 
+    // Desplazamiento de cada nivel en la matriz de descriptores, para que cada nivel escriba sólo en sus filas.
+    vector<int> vOffset(nlevels);
     int offset = 0;
     for (int level = 0; level < nlevels; ++level)
+    {
+        vOffset[level] = offset;
+        offset += (int)allKeypoints[level].size();
+    }
+
+    // Desenfoque, descriptores y escalado por nivel, en paralelo si hay pool.
+    auto describirNivel = [&](int level)
     {
         vector<KeyPoint>& keypoints = allKeypoints[level];
         int nkeypointsLevel = (int)keypoints.size();
 
         if(nkeypointsLevel==0)
-            continue;
-
-        // preprocess the resized image
-        Mat workingMat = mvImagePyramid[level].clone();
-        GaussianBlur(workingMat, workingMat, Size(7, 7), 2, 2, BORDER_REFLECT_101);
+            return;
 
-        // Compute the descriptors
-        Mat desc = descriptors.rowRange(offset, offset + nkeypointsLevel);
-        computeDescriptors(workingMat, keypoints, desc, pattern);
-
-        offset += nkeypointsLevel;
+        // Desenfoque y descriptores en una única pasada por teselas
+        Mat desc = descriptors.rowRange(vOffset[level], vOffset[level] + nkeypointsLevel);
+        ComputeDescriptorsLevel(level, keypoints, desc);
 
         // Scale keypoint coordinates
         if (level != 0)
@@ -963,33 +1287,71 @@ void ORBextractor::operator()( InputArray _image, InputArray _mask, vector<KeyPo
                  keypointEnd = keypoints.end(); keypoint != keypointEnd; ++keypoint)
                 keypoint->pt *= scale;
         }
-        // And add the keypoints to the output
-        _keypoints.insert(_keypoints.end(), keypoints.begin(), keypoints.end());
-    }
+    };
+
+    if(mpWorkerPool)
+        mpWorkerPool->ParallelFor(nlevels, describirNivel);
+    else
+        for (int level = 0; level < nlevels; ++level)
+            describirNivel(level);
+
+    // And add the keypoints to the output, in level order
+    for (int level = 0; level < nlevels; ++level)
+        _keypoints.insert(_keypoints.end(), allKeypoints[level].begin(), allKeypoints[level].end());
 }
 
-void ORBextractor::ComputePyramid(cv::Mat image)
+void ORBextractor::AllocatePyramid(const Size &size)
 {
+    // Cada nivel con su borde ocupa un bloque de la arena, alineado a 64 bytes como las filas.
+    const int alineacion = 64;
+    vector<Size> vWholeSize(nlevels);
+    vector<size_t> vStep(nlevels), vOffset(nlevels);
+    size_t total = 0;
     for (int level = 0; level < nlevels; ++level)
     {
         float scale = mvInvScaleFactor[level];
-        Size sz(cvRound((float)image.cols*scale), cvRound((float)image.rows*scale));
-        Size wholeSize(sz.width + EDGE_THRESHOLD*2, sz.height + EDGE_THRESHOLD*2);
-        Mat temp(wholeSize, image.type()), masktemp;
-        mvImagePyramid[level] = temp(Rect(EDGE_THRESHOLD, EDGE_THRESHOLD, sz.width, sz.height));
+        Size sz(cvRound((float)size.width*scale), cvRound((float)size.height*scale));
+        vWholeSize[level] = Size(sz.width + EDGE_THRESHOLD*2, sz.height + EDGE_THRESHOLD*2);
+        vStep[level] = alignSize(vWholeSize[level].width, alineacion);
+        vOffset[level] = total;
+        total += alignSize(vStep[level]*vWholeSize[level].height, alineacion);
+    }
+
+    // Única reserva de memoria.  cv::Mat alinea su buffer a 64 bytes.
+    mPyramidArena.create(1, (int)total, CV_8UC1);
+
+    mvPyramidBordered.resize(nlevels);
+    for (int level = 0; level < nlevels; ++level)
+    {
+        mvPyramidBordered[level] = Mat(vWholeSize[level], CV_8UC1, mPyramidArena.data + vOffset[level], vStep[level]);
+        mvImagePyramid[level] = mvPyramidBordered[level](Rect(EDGE_THRESHOLD, EDGE_THRESHOLD,
+                vWholeSize[level].width - EDGE_THRESHOLD*2, vWholeSize[level].height - EDGE_THRESHOLD*2));
+    }
+
+    mPyramidSize = size;
+}
 
-        // Compute the resized image
+void ORBextractor::ComputePyramid(cv::Mat image)
+{
+    // Sólo reserva memoria con el primer cuadro o cuando cambia la resolución.
+    if(image.size() != mPyramidSize)
+        AllocatePyramid(image.size());
+
+    // Sólo los niveles usados: los siguientes quedan desactualizados, pero no se leen
+    for (int level = 0; level < mnNivelesUsados; ++level)
+    {
+        // Los destinos ya tienen tamaño y tipo correctos, ni resize ni copyMakeBorder reservan memoria.
         if( level != 0 )
         {
-            resize(mvImagePyramid[level-1], mvImagePyramid[level], sz, 0, 0, INTER_LINEAR);
+            resize(mvImagePyramid[level-1], mvImagePyramid[level], mvImagePyramid[level].size(), 0, 0, INTER_LINEAR);
 
-            copyMakeBorder(mvImagePyramid[level], temp, EDGE_THRESHOLD, EDGE_THRESHOLD, EDGE_THRESHOLD, EDGE_THRESHOLD,
-                           BORDER_REFLECT_101+BORDER_ISOLATED);            
+            copyMakeBorder(mvImagePyramid[level], mvPyramidBordered[level], EDGE_THRESHOLD, EDGE_THRESHOLD, EDGE_THRESHOLD, EDGE_THRESHOLD,
+                           BORDER_REFLECT_101+BORDER_ISOLATED);
         }
         else
         {
-            copyMakeBorder(image, temp, EDGE_THRESHOLD, EDGE_THRESHOLD, EDGE_THRESHOLD, EDGE_THRESHOLD,
-                           BORDER_REFLECT_101);            
+            copyMakeBorder(image, mvPyramidBordered[level], EDGE_THRESHOLD, EDGE_THRESHOLD, EDGE_THRESHOLD, EDGE_THRESHOLD,
+                           BORDER_REFLECT_101);
         }
     }
 
@@ -25,9 +25,14 @@
 #include<opencv2/core/core.hpp>
 #include<opencv2/features2d/features2d.hpp>
 
-#include "../Thirdparty/DBoW2/DBoW2/FeatureVector.h"
+#include "VectorBow.h"
+#include "Converter.h"
 
 #include<stdint-gcc.h>
+#include<cstring>
+#if defined(__x86_64__)
+#include<immintrin.h>
+#endif
 
 using namespace std;
 
@@ -67,13 +72,13 @@ int ORBmatcher::SearchByProjection(Frame &F, const vector<MapPoint*> &vpMapPoint
         if(bFactor)
             r*=th;
 
-        const vector<size_t> vIndices =
-                F.GetFeaturesInArea(pMP->mTrackProjX,pMP->mTrackProjY,r*F.mvScaleFactors[nPredictedLevel],nPredictedLevel-1,nPredictedLevel);
+        F.GetFeaturesInArea(mvIndicesArea,pMP->mTrackProjX,pMP->mTrackProjY,r*F.mvScaleFactors[nPredictedLevel],nPredictedLevel-1,nPredictedLevel);
+        const vector<size_t> &vIndices = mvIndicesArea;
 
         if(vIndices.empty())
             continue;
 
-        const cv::Mat MPdescriptor = pMP->GetDescriptor();
+        const Descriptor MPdescriptor = pMP->GetDescriptor();
 
         int bestDist=256;
         int bestLevel= -1;
@@ -81,7 +86,8 @@ int ORBmatcher::SearchByProjection(Frame &F, const vector<MapPoint*> &vpMapPoint
         int bestLevel2 = -1;
         int bestIdx =-1 ;
 
-        // Get best and second matches with near keypoints
+        // Candidatos: puntos singulares cercanos que no tienen ya un punto del mapa observado
+        LimpiarCandidatos();
         for(vector<size_t>::const_iterator vit=vIndices.begin(), vend=vIndices.end(); vit!=vend; vit++)
         {
             const size_t idx = *vit;
@@ -90,21 +96,27 @@ int ORBmatcher::SearchByProjection(Frame &F, const vector<MapPoint*> &vpMapPoint
                 if(F.mvpMapPoints[idx]->Observations()>0)
                     continue;
 
-            const cv::Mat &d = F.mDescriptors.row(idx);
+            AgregarCandidato(idx, F.GetDescriptors().ptr(idx));
+        }
+        const int *distancias = DistanciasCandidatos(MPdescriptor.ptr());
 
-            const int dist = DescriptorDistance(MPdescriptor,d);
+        // Get best and second matches with near keypoints
+        for(size_t k=0; k<mvCandidatos.size(); k++)
+        {
+            const size_t idx = mvCandidatos[k];
+            const int dist = distancias[k];
 
             if(dist<bestDist)
             {
                 bestDist2=bestDist;
                 bestDist=dist;
                 bestLevel2 = bestLevel;
-                bestLevel = F.mvKeysUn[idx].octave;
+                bestLevel = F.GetKeysUn()[idx].octave;
                 bestIdx=idx;
             }
             else if(dist<bestDist2)
             {
-                bestLevel2 = F.mvKeysUn[idx].octave;
+                bestLevel2 = F.GetKeysUn()[idx].octave;
                 bestDist2=dist;
             }
         }
@@ -157,7 +169,8 @@ int ORBmatcher::SearchByBoW(KeyFrame* pKF,Frame &F, vector<MapPoint*> &vpMapPoin
 
     vpMapPointMatches = vector<MapPoint*>(F.N,static_cast<MapPoint*>(NULL));
 
-    const DBoW2::FeatureVector &vFeatVecKF = pKF->mFeatVec;
+    const VectorFeatures &vFeatVecKF = pKF->mFeatVec;
+    const VectorFeatures &vFeatVecF = F.mFeatVec;
 
     int nmatches=0;
 
@@ -167,19 +180,20 @@ int ORBmatcher::SearchByBoW(KeyFrame* pKF,Frame &F, vector<MapPoint*> &vpMapPoin
     const float factor = 1.0f/HISTO_LENGTH;
 
     // We perform the matching over ORB that belong to the same vocabulary node (at a certain level)
-    DBoW2::FeatureVector::const_iterator KFit = vFeatVecKF.begin();
-    DBoW2::FeatureVector::const_iterator Fit = F.mFeatVec.begin();
-    DBoW2::FeatureVector::const_iterator KFend = vFeatVecKF.end();
-    DBoW2::FeatureVector::const_iterator Fend = F.mFeatVec.end();
+    size_t KFit = 0, Fit = 0;
+    const size_t KFend = vFeatVecKF.size(), Fend = vFeatVecF.size();
 
     while(KFit != KFend && Fit != Fend)
     {
-        if(KFit->first == Fit->first)
+        if(vFeatVecKF.Nodo(KFit) == vFeatVecF.Nodo(Fit))
         {
-            const vector<unsigned int> vIndicesKF = KFit->second;
-            const vector<unsigned int> vIndicesF = Fit->second;
+            // Rangos de índices del nodo, sin copiar
+            const unsigned int *vIndicesKF = vFeatVecKF.Inicio(KFit);
+            const unsigned int *vIndicesF = vFeatVecF.Inicio(Fit);
+            const size_t nIndicesKF = vFeatVecKF.Fin(KFit) - vIndicesKF;
+            const size_t nIndicesF = vFeatVecF.Fin(Fit) - vIndicesF;
 
-            for(size_t iKF=0; iKF<vIndicesKF.size(); iKF++)
+            for(size_t iKF=0; iKF<nIndicesKF; iKF++)
             {
                 const unsigned int realIdxKF = vIndicesKF[iKF];
 
@@ -191,22 +205,28 @@ int ORBmatcher::SearchByBoW(KeyFrame* pKF,Frame &F, vector<MapPoint*> &vpMapPoin
                 if(pMP->isBad())
                     continue;                
 
-                const cv::Mat &dKF= pKF->mDescriptors.row(realIdxKF);
+                const uchar *dKF = pKF->mDescriptors.ptr(realIdxKF);
 
                 int bestDist1=256;
                 int bestIdxF =-1 ;
                 int bestDist2=256;
 
-                for(size_t iF=0; iF<vIndicesF.size(); iF++)
+                LimpiarCandidatos();
+                for(size_t iF=0; iF<nIndicesF; iF++)
                 {
                     const unsigned int realIdxF = vIndicesF[iF];
 
                     if(vpMapPointMatches[realIdxF])
                         continue;
 
-                    const cv::Mat &dF = F.mDescriptors.row(realIdxF);
+                    AgregarCandidato(realIdxF, F.GetDescriptors().ptr(realIdxF));
+                }
+                const int *distancias = DistanciasCandidatos(dKF);
 
-                    const int dist =  DescriptorDistance(dKF,dF);
+                for(size_t k=0; k<mvCandidatos.size(); k++)
+                {
+                    const unsigned int realIdxF = mvCandidatos[k];
+                    const int dist = distancias[k];
 
                     if(dist<bestDist1)
                     {
@@ -230,7 +250,7 @@ int ORBmatcher::SearchByBoW(KeyFrame* pKF,Frame &F, vector<MapPoint*> &vpMapPoin
 
                         if(mbCheckOrientation)
                         {
-                            float rot = kp.angle-F.mvKeys[bestIdxF].angle;
+                            float rot = kp.angle-F.GetKeys()[bestIdxF].angle;
                             if(rot<0.0)
                                 rot+=360.0f;
                             int bin = round(rot*factor);
@@ -248,13 +268,13 @@ int ORBmatcher::SearchByBoW(KeyFrame* pKF,Frame &F, vector<MapPoint*> &vpMapPoin
             KFit++;
             Fit++;
         }
-        else if(KFit->first < Fit->first)
+        else if(vFeatVecKF.Nodo(KFit) < vFeatVecF.Nodo(Fit))
         {
-            KFit = vFeatVecKF.lower_bound(Fit->first);
+            KFit = vFeatVecKF.LowerBound(vFeatVecF.Nodo(Fit), KFit);
         }
         else
         {
-            Fit = F.mFeatVec.lower_bound(KFit->first);
+            Fit = vFeatVecF.LowerBound(vFeatVecKF.Nodo(KFit), Fit);
         }
     }
 
@@ -291,11 +311,10 @@ int ORBmatcher::SearchByProjection(KeyFrame* pKF, cv::Mat Scw, const vector<MapP
     const float &cy = pKF->cy;
 
     // Decompose Scw
-    cv::Mat sRcw = Scw.rowRange(0,3).colRange(0,3);
-    const float scw = sqrt(sRcw.row(0).dot(sRcw.row(0)));
-    cv::Mat Rcw = sRcw/scw;
-    cv::Mat tcw = Scw.rowRange(0,3).col(3)/scw;
-    cv::Mat Ow = -Rcw.t()*tcw;
+    const SE3f sTcw = Converter::toSE3f(Scw);
+    const float scw = sTcw.R.row(0).norm();
+    const SE3f Tcw(sTcw.R/scw, sTcw.t/scw);
+    const Eigen::Vector3f Ow = Tcw.centro();
 
     // Set of MapPoints already found in the KeyFrame
     set<MapPoint*> spAlreadyFound(vpMatched.begin(), vpMatched.end());
@@ -313,19 +332,19 @@ int ORBmatcher::SearchByProjection(KeyFrame* pKF, cv::Mat Scw, const vector<MapP
             continue;
 
         // Get 3D Coords.
-        cv::Mat p3Dw = pMP->GetWorldPos();
+        const Eigen::Vector3f p3Dw = pMP->GetWorldPos3f();
 
         // Transform into Camera Coords.
-        cv::Mat p3Dc = Rcw*p3Dw+tcw;
+        const Eigen::Vector3f p3Dc = Tcw*p3Dw;
 
         // Depth must be positive
-        if(p3Dc.at<float>(2)<0.0)
+        if(p3Dc(2)<0.0)
             continue;
 
         // Project into Image
-        const float invz = 1/p3Dc.at<float>(2);
-        const float x = p3Dc.at<float>(0)*invz;
-        const float y = p3Dc.at<float>(1)*invz;
+        const float invz = 1/p3Dc(2);
+        const float x = p3Dc(0)*invz;
+        const float y = p3Dc(1)*invz;
 
         const float u = fx*x+cx;
         const float v = fy*y+cy;
@@ -337,14 +356,14 @@ int ORBmatcher::SearchByProjection(KeyFrame* pKF, cv::Mat Scw, const vector<MapP
         // Depth must be inside the scale invariance region of the point
         const float maxDistance = pMP->GetMaxDistanceInvariance();
         const float minDistance = pMP->GetMinDistanceInvariance();
-        cv::Mat PO = p3Dw-Ow;
-        const float dist = cv::norm(PO);
+        const Eigen::Vector3f PO = p3Dw-Ow;
+        const float dist = PO.norm();
 
         if(dist<minDistance || dist>maxDistance)
             continue;
 
         // Viewing angle must be less than 60 deg
-        cv::Mat Pn = pMP->GetNormal();
+        const Eigen::Vector3f Pn = pMP->GetNormal3f();
 
         if(PO.dot(Pn)<0.5*dist)
             continue;
@@ -354,16 +373,18 @@ int ORBmatcher::SearchByProjection(KeyFrame* pKF, cv::Mat Scw, const vector<MapP
         // Search in a radius
         const float radius = th*pKF->mvScaleFactors[nPredictedLevel];
 
-        const vector<size_t> vIndices = pKF->GetFeaturesInArea(u,v,radius);
+        pKF->GetFeaturesInArea(mvIndicesArea,u,v,radius);
+        const vector<size_t> &vIndices = mvIndicesArea;
 
         if(vIndices.empty())
             continue;
 
         // Match to the most similar keypoint in the radius
-        const cv::Mat dMP = pMP->GetDescriptor();
+        const Descriptor dMP = pMP->GetDescriptor();
 
         int bestDist = 256;
         int bestIdx = -1;
+        LimpiarCandidatos();
         for(vector<size_t>::const_iterator vit=vIndices.begin(), vend=vIndices.end(); vit!=vend; vit++)
         {
             const size_t idx = *vit;
@@ -375,9 +396,14 @@ int ORBmatcher::SearchByProjection(KeyFrame* pKF, cv::Mat Scw, const vector<MapP
             if(kpLevel<nPredictedLevel-1 || kpLevel>nPredictedLevel)
                 continue;
 
-            const cv::Mat &dKF = pKF->mDescriptors.row(idx);
+            AgregarCandidato(idx, pKF->mDescriptors.ptr(idx));
+        }
+        const int *distancias = DistanciasCandidatos(dMP.ptr());
 
-            const int dist = DescriptorDistance(dMP,dKF);
+        for(size_t k=0; k<mvCandidatos.size(); k++)
+        {
+            const size_t idx = mvCandidatos[k];
+            const int dist = distancias[k];
 
             if(dist<bestDist)
             {
@@ -400,41 +426,45 @@ int ORBmatcher::SearchByProjection(KeyFrame* pKF, cv::Mat Scw, const vector<MapP
 int ORBmatcher::SearchForInitialization(Frame &F1, Frame &F2, vector<cv::Point2f> &vbPrevMatched, vector<int> &vnMatches12, int windowSize)
 {
     int nmatches=0;
-    vnMatches12 = vector<int>(F1.mvKeysUn.size(),-1);
+    vnMatches12 = vector<int>(F1.GetKeysUn().size(),-1);
 
     vector<int> rotHist[HISTO_LENGTH];
     for(int i=0;i<HISTO_LENGTH;i++)
         rotHist[i].reserve(500);
     const float factor = 1.0f/HISTO_LENGTH;
 
-    vector<int> vMatchedDistance(F2.mvKeysUn.size(),INT_MAX);
-    vector<int> vnMatches21(F2.mvKeysUn.size(),-1);
+    vector<int> vMatchedDistance(F2.GetKeysUn().size(),INT_MAX);
+    vector<int> vnMatches21(F2.GetKeysUn().size(),-1);
 
-    for(size_t i1=0, iend1=F1.mvKeysUn.size(); i1<iend1; i1++)
+    for(size_t i1=0, iend1=F1.GetKeysUn().size(); i1<iend1; i1++)
     {
-        cv::KeyPoint kp1 = F1.mvKeysUn[i1];
+        cv::KeyPoint kp1 = F1.GetKeysUn()[i1];
         int level1 = kp1.octave;
         if(level1>0)
             continue;
 
-        vector<size_t> vIndices2 = F2.GetFeaturesInArea(vbPrevMatched[i1].x,vbPrevMatched[i1].y, windowSize,level1,level1);
+        F2.GetFeaturesInArea(mvIndicesArea,vbPrevMatched[i1].x,vbPrevMatched[i1].y, windowSize,level1,level1);
+        vector<size_t> &vIndices2 = mvIndicesArea;
 
         if(vIndices2.empty())
             continue;
 
-        cv::Mat d1 = F1.mDescriptors.row(i1);
+        const uchar *d1 = F1.GetDescriptors().ptr(i1);
 
         int bestDist = INT_MAX;
         int bestDist2 = INT_MAX;
         int bestIdx2 = -1;
 
+        LimpiarCandidatos();
         for(vector<size_t>::iterator vit=vIndices2.begin(); vit!=vIndices2.end(); vit++)
-        {
-            size_t i2 = *vit;
+            AgregarCandidato(*vit, F2.GetDescriptors().ptr(*vit));
+        const int *distancias = DistanciasCandidatos(d1);
 
-            cv::Mat d2 = F2.mDescriptors.row(i2);
+        for(size_t k=0; k<mvCandidatos.size(); k++)
+        {
+            size_t i2 = mvCandidatos[k];
 
-            int dist = DescriptorDistance(d1,d2);
+            int dist = distancias[k];
 
             if(vMatchedDistance[i2]<=dist)
                 continue;
@@ -467,7 +497,7 @@ int ORBmatcher::SearchForInitialization(Frame &F1, Frame &F2, vector<cv::Point2f
 
                 if(mbCheckOrientation)
                 {
-                    float rot = F1.mvKeysUn[i1].angle-F2.mvKeysUn[bestIdx2].angle;
+                    float rot = F1.GetKeysUn()[i1].angle-F2.GetKeysUn()[bestIdx2].angle;
                     if(rot<0.0)
                         rot+=360.0f;
                     int bin = round(rot*factor);
@@ -509,7 +539,7 @@ int ORBmatcher::SearchForInitialization(Frame &F1, Frame &F2, vector<cv::Point2f
     //Update prev matched
     for(size_t i1=0, iend1=vnMatches12.size(); i1<iend1; i1++)
         if(vnMatches12[i1]>=0)
-            vbPrevMatched[i1]=F2.mvKeysUn[vnMatches12[i1]].pt;
+            vbPrevMatched[i1]=F2.GetKeysUn()[vnMatches12[i1]].pt;
 
     return nmatches;
 }
@@ -517,14 +547,14 @@ int ORBmatcher::SearchForInitialization(Frame &F1, Frame &F2, vector<cv::Point2f
 int ORBmatcher::SearchByBoW(KeyFrame *pKF1, KeyFrame *pKF2, vector<MapPoint *> &vpMatches12)
 {
     const vector<cv::KeyPoint> &vKeysUn1 = pKF1->mvKeysUn;
-    const DBoW2::FeatureVector &vFeatVec1 = pKF1->mFeatVec;
+    const VectorFeatures &vFeatVec1 = pKF1->mFeatVec;
     const vector<MapPoint*> vpMapPoints1 = pKF1->GetMapPointMatches();
-    const cv::Mat &Descriptors1 = pKF1->mDescriptors;
+    const Descriptores &Descriptors1 = pKF1->mDescriptors;
 
     const vector<cv::KeyPoint> &vKeysUn2 = pKF2->mvKeysUn;
-    const DBoW2::FeatureVector &vFeatVec2 = pKF2->mFeatVec;
+    const VectorFeatures &vFeatVec2 = pKF2->mFeatVec;
     const vector<MapPoint*> vpMapPoints2 = pKF2->GetMapPointMatches();
-    const cv::Mat &Descriptors2 = pKF2->mDescriptors;
+    const Descriptores &Descriptors2 = pKF2->mDescriptors;
 
     vpMatches12 = vector<MapPoint*>(vpMapPoints1.size(),static_cast<MapPoint*>(NULL));
     vector<bool> vbMatched2(vpMapPoints2.size(),false);
@@ -537,18 +567,16 @@ int ORBmatcher::SearchByBoW(KeyFrame *pKF1, KeyFrame *pKF2, vector<MapPoint *> &
 
     int nmatches = 0;
 
-    DBoW2::FeatureVector::const_iterator f1it = vFeatVec1.begin();
-    DBoW2::FeatureVector::const_iterator f2it = vFeatVec2.begin();
-    DBoW2::FeatureVector::const_iterator f1end = vFeatVec1.end();
-    DBoW2::FeatureVector::const_iterator f2end = vFeatVec2.end();
+    size_t f1it = 0, f2it = 0;
+    const size_t f1end = vFeatVec1.size(), f2end = vFeatVec2.size();
 
     while(f1it != f1end && f2it != f2end)
     {
-        if(f1it->first == f2it->first)
+        if(vFeatVec1.Nodo(f1it) == vFeatVec2.Nodo(f2it))
         {
-            for(size_t i1=0, iend1=f1it->second.size(); i1<iend1; i1++)
+            for(const unsigned int *i1=vFeatVec1.Inicio(f1it), *iend1=vFeatVec1.Fin(f1it); i1<iend1; i1++)
             {
-                const size_t idx1 = f1it->second[i1];
+                const size_t idx1 = *i1;
 
                 MapPoint* pMP1 = vpMapPoints1[idx1];
                 if(!pMP1)
@@ -556,15 +584,16 @@ int ORBmatcher::SearchByBoW(KeyFrame *pKF1, KeyFrame *pKF2, vector<MapPoint *> &
                 if(pMP1->isBad())
                     continue;
 
-                const cv::Mat &d1 = Descriptors1.row(idx1);
+                const uchar *d1 = Descriptors1.ptr(idx1);
 
                 int bestDist1=256;
                 int bestIdx2 =-1 ;
                 int bestDist2=256;
 
-                for(size_t i2=0, iend2=f2it->second.size(); i2<iend2; i2++)
+                LimpiarCandidatos();
+                for(const unsigned int *i2=vFeatVec2.Inicio(f2it), *iend2=vFeatVec2.Fin(f2it); i2<iend2; i2++)
                 {
-                    const size_t idx2 = f2it->second[i2];
+                    const size_t idx2 = *i2;
 
                     MapPoint* pMP2 = vpMapPoints2[idx2];
 
@@ -574,9 +603,14 @@ int ORBmatcher::SearchByBoW(KeyFrame *pKF1, KeyFrame *pKF2, vector<MapPoint *> &
                     if(pMP2->isBad())
                         continue;
 
-                    const cv::Mat &d2 = Descriptors2.row(idx2);
+                    AgregarCandidato(idx2, Descriptors2.ptr(idx2));
+                }
+                const int *distancias = DistanciasCandidatos(d1);
 
-                    int dist = DescriptorDistance(d1,d2);
+                for(size_t k=0; k<mvCandidatos.size(); k++)
+                {
+                    const size_t idx2 = mvCandidatos[k];
+                    int dist = distancias[k];
 
                     if(dist<bestDist1)
                     {
@@ -616,13 +650,13 @@ int ORBmatcher::SearchByBoW(KeyFrame *pKF1, KeyFrame *pKF2, vector<MapPoint *> &
             f1it++;
             f2it++;
         }
-        else if(f1it->first < f2it->first)
+        else if(vFeatVec1.Nodo(f1it) < vFeatVec2.Nodo(f2it))
         {
-            f1it = vFeatVec1.lower_bound(f2it->first);
+            f1it = vFeatVec1.LowerBound(vFeatVec2.Nodo(f2it), f1it);
         }
         else
         {
-            f2it = vFeatVec2.lower_bound(f1it->first);
+            f2it = vFeatVec2.LowerBound(vFeatVec1.Nodo(f1it), f2it);
         }
     }
 
@@ -652,8 +686,8 @@ int ORBmatcher::SearchByBoW(KeyFrame *pKF1, KeyFrame *pKF2, vector<MapPoint *> &
 int ORBmatcher::SearchForTriangulation(KeyFrame *pKF1, KeyFrame *pKF2, cv::Mat F12,
                                        vector<pair<size_t, size_t> > &vMatchedPairs)
 {    
-    const DBoW2::FeatureVector &vFeatVec1 = pKF1->mFeatVec;
-    const DBoW2::FeatureVector &vFeatVec2 = pKF2->mFeatVec;
+    const VectorFeatures &vFeatVec1 = pKF1->mFeatVec;
+    const VectorFeatures &vFeatVec2 = pKF2->mFeatVec;
 
     //Compute epipole in second image
     cv::Mat Cw = pKF1->GetCameraCenter();
@@ -678,18 +712,16 @@ int ORBmatcher::SearchForTriangulation(KeyFrame *pKF1, KeyFrame *pKF2, cv::Mat F
 
     const float factor = 1.0f/HISTO_LENGTH;
 
-    DBoW2::FeatureVector::const_iterator f1it = vFeatVec1.begin();
-    DBoW2::FeatureVector::const_iterator f2it = vFeatVec2.begin();
-    DBoW2::FeatureVector::const_iterator f1end = vFeatVec1.end();
-    DBoW2::FeatureVector::const_iterator f2end = vFeatVec2.end();
+    size_t f1it = 0, f2it = 0;
+    const size_t f1end = vFeatVec1.size(), f2end = vFeatVec2.size();
 
     while(f1it!=f1end && f2it!=f2end)
     {
-        if(f1it->first == f2it->first)
+        if(vFeatVec1.Nodo(f1it) == vFeatVec2.Nodo(f2it))
         {
-            for(size_t i1=0, iend1=f1it->second.size(); i1<iend1; i1++)
+            for(const unsigned int *i1=vFeatVec1.Inicio(f1it), *iend1=vFeatVec1.Fin(f1it); i1<iend1; i1++)
             {
-                const size_t idx1 = f1it->second[i1];
+                const size_t idx1 = *i1;
                 
                 MapPoint* pMP1 = pKF1->GetMapPoint(idx1);
                 
@@ -700,14 +732,15 @@ int ORBmatcher::SearchForTriangulation(KeyFrame *pKF1, KeyFrame *pKF2, cv::Mat F
 
                 const cv::KeyPoint &kp1 = pKF1->mvKeysUn[idx1];
                 
-                const cv::Mat &d1 = pKF1->mDescriptors.row(idx1);
+                const uchar *d1 = pKF1->mDescriptors.ptr(idx1);
                 
                 int bestDist = TH_LOW;
                 int bestIdx2 = -1;
                 
-                for(size_t i2=0, iend2=f2it->second.size(); i2<iend2; i2++)
+                LimpiarCandidatos();
+                for(const unsigned int *i2=vFeatVec2.Inicio(f2it), *iend2=vFeatVec2.Fin(f2it); i2<iend2; i2++)
                 {
-                    size_t idx2 = f2it->second[i2];
+                    size_t idx2 = *i2;
                     
                     MapPoint* pMP2 = pKF2->GetMapPoint(idx2);
                     
@@ -715,9 +748,15 @@ int ORBmatcher::SearchForTriangulation(KeyFrame *pKF1, KeyFrame *pKF2, cv::Mat F
                     if(vbMatched2[idx2] || pMP2)
                         continue;
 
-                    const cv::Mat &d2 = pKF2->mDescriptors.row(idx2);
+                    AgregarCandidato(idx2, pKF2->mDescriptors.ptr(idx2));
+                }
+                const int *distancias = DistanciasCandidatos(d1);
+
+                for(size_t k=0; k<mvCandidatos.size(); k++)
+                {
+                    size_t idx2 = mvCandidatos[k];
                     
-                    const int dist = DescriptorDistance(d1,d2);
+                    const int dist = distancias[k];
                     
                     if(dist>TH_LOW || dist>bestDist)
                         continue;
@@ -759,13 +798,13 @@ int ORBmatcher::SearchForTriangulation(KeyFrame *pKF1, KeyFrame *pKF2, cv::Mat F
             f1it++;
             f2it++;
         }
-        else if(f1it->first < f2it->first)
+        else if(vFeatVec1.Nodo(f1it) < vFeatVec2.Nodo(f2it))
         {
-            f1it = vFeatVec1.lower_bound(f2it->first);
+            f1it = vFeatVec1.LowerBound(vFeatVec2.Nodo(f2it), f1it);
         }
         else
         {
-            f2it = vFeatVec2.lower_bound(f1it->first);
+            f2it = vFeatVec2.LowerBound(vFeatVec1.Nodo(f1it), f2it);
         }
     }
 
@@ -805,8 +844,7 @@ int ORBmatcher::SearchForTriangulation(KeyFrame *pKF1, KeyFrame *pKF2, cv::Mat F
 
 int ORBmatcher::Fuse(KeyFrame *pKF, const vector<MapPoint *> &vpMapPoints, const float th)
 {
-    cv::Mat Rcw = pKF->GetRotation();
-    cv::Mat tcw = pKF->GetTranslation();
+    const SE3f Tcw = pKF->GetPose3f();
 
     const float &fx = pKF->fx;
     const float &fy = pKF->fy;
@@ -814,7 +852,7 @@ int ORBmatcher::Fuse(KeyFrame *pKF, const vector<MapPoint *> &vpMapPoints, const
     const float &cy = pKF->cy;
     //const float &bf = pKF->mbf;
 
-    cv::Mat Ow = pKF->GetCameraCenter();
+    const Eigen::Vector3f Ow = Tcw.centro();
 
     int nFused=0;
 
@@ -830,16 +868,16 @@ int ORBmatcher::Fuse(KeyFrame *pKF, const vector<MapPoint *> &vpMapPoints, const
         if(pMP->isBad() || pMP->IsInKeyFrame(pKF))
             continue;
 
-        cv::Mat p3Dw = pMP->GetWorldPos();
-        cv::Mat p3Dc = Rcw*p3Dw + tcw;
+        const Eigen::Vector3f p3Dw = pMP->GetWorldPos3f();
+        const Eigen::Vector3f p3Dc = Tcw*p3Dw;
 
         // Depth must be positive
-        if(p3Dc.at<float>(2)<0.0f)
+        if(p3Dc(2)<0.0f)
             continue;
 
-        const float invz = 1/p3Dc.at<float>(2);
-        const float x = p3Dc.at<float>(0)*invz;
-        const float y = p3Dc.at<float>(1)*invz;
+        const float invz = 1/p3Dc(2);
+        const float x = p3Dc(0)*invz;
+        const float y = p3Dc(1)*invz;
 
         const float u = fx*x+cx;
         const float v = fy*y+cy;
@@ -852,15 +890,15 @@ int ORBmatcher::Fuse(KeyFrame *pKF, const vector<MapPoint *> &vpMapPoints, const
 
         const float maxDistance = pMP->GetMaxDistanceInvariance();
         const float minDistance = pMP->GetMinDistanceInvariance();
-        cv::Mat PO = p3Dw-Ow;
-        const float dist3D = cv::norm(PO);
+        const Eigen::Vector3f PO = p3Dw-Ow;
+        const float dist3D = PO.norm();
 
         // Depth must be inside the scale pyramid of the image
         if(dist3D<minDistance || dist3D>maxDistance )
             continue;
 
         // Viewing angle must be less than 60 deg
-        cv::Mat Pn = pMP->GetNormal();
+        const Eigen::Vector3f Pn = pMP->GetNormal3f();
 
         if(PO.dot(Pn)<0.5*dist3D)
             continue;
@@ -870,17 +908,19 @@ int ORBmatcher::Fuse(KeyFrame *pKF, const vector<MapPoint *> &vpMapPoints, const
         // Search in a radius
         const float radius = th*pKF->mvScaleFactors[nPredictedLevel];
 
-        const vector<size_t> vIndices = pKF->GetFeaturesInArea(u,v,radius);
+        pKF->GetFeaturesInArea(mvIndicesArea,u,v,radius);
+        const vector<size_t> &vIndices = mvIndicesArea;
 
         if(vIndices.empty())
             continue;
 
         // Match to the most similar keypoint in the radius
 
-        const cv::Mat dMP = pMP->GetDescriptor();
+        const Descriptor dMP = pMP->GetDescriptor();
 
         int bestDist = 256;
         int bestIdx = -1;
+        LimpiarCandidatos();
         for(vector<size_t>::const_iterator vit=vIndices.begin(), vend=vIndices.end(); vit!=vend; vit++)
         {
             const size_t idx = *vit;
@@ -901,9 +941,14 @@ int ORBmatcher::Fuse(KeyFrame *pKF, const vector<MapPoint *> &vpMapPoints, const
 			if(e2*pKF->mvInvLevelSigma2[kpLevel]>5.99)
 				continue;
 
-            const cv::Mat &dKF = pKF->mDescriptors.row(idx);
+            AgregarCandidato(idx, pKF->mDescriptors.ptr(idx));
+        }
+        const int *distancias = DistanciasCandidatos(dMP.ptr());
 
-            const int dist = DescriptorDistance(dMP,dKF);
+        for(size_t k=0; k<mvCandidatos.size(); k++)
+        {
+            const size_t idx = mvCandidatos[k];
+            const int dist = distancias[k];
 
             if(dist<bestDist)
             {
@@ -947,11 +992,10 @@ int ORBmatcher::Fuse(KeyFrame *pKF, cv::Mat Scw, const vector<MapPoint *> &vpPoi
     const float &cy = pKF->cy;
 
     // Decompose Scw
-    cv::Mat sRcw = Scw.rowRange(0,3).colRange(0,3);
-    const float scw = sqrt(sRcw.row(0).dot(sRcw.row(0)));
-    cv::Mat Rcw = sRcw/scw;
-    cv::Mat tcw = Scw.rowRange(0,3).col(3)/scw;
-    cv::Mat Ow = -Rcw.t()*tcw;
+    const SE3f sTcw = Converter::toSE3f(Scw);
+    const float scw = sTcw.R.row(0).norm();
+    const SE3f Tcw(sTcw.R/scw, sTcw.t/scw);
+    const Eigen::Vector3f Ow = Tcw.centro();
 
     // Set of MapPoints already found in the KeyFrame
     const set<MapPoint*> spAlreadyFound = pKF->GetMapPoints();
@@ -970,19 +1014,19 @@ int ORBmatcher::Fuse(KeyFrame *pKF, cv::Mat Scw, const vector<MapPoint *> &vpPoi
             continue;
 
         // Get 3D Coords.
-        cv::Mat p3Dw = pMP->GetWorldPos();
+        const Eigen::Vector3f p3Dw = pMP->GetWorldPos3f();
 
         // Transform into Camera Coords.
-        cv::Mat p3Dc = Rcw*p3Dw+tcw;
+        const Eigen::Vector3f p3Dc = Tcw*p3Dw;
 
         // Depth must be positive
-        if(p3Dc.at<float>(2)<0.0f)
+        if(p3Dc(2)<0.0f)
             continue;
 
         // Project into Image
-        const float invz = 1.0/p3Dc.at<float>(2);
-        const float x = p3Dc.at<float>(0)*invz;
-        const float y = p3Dc.at<float>(1)*invz;
+        const float invz = 1.0/p3Dc(2);
+        const float x = p3Dc(0)*invz;
+        const float y = p3Dc(1)*invz;
 
         const float u = fx*x+cx;
         const float v = fy*y+cy;
@@ -994,14 +1038,14 @@ int ORBmatcher::Fuse(KeyFrame *pKF, cv::Mat Scw, const vector<MapPoint *> &vpPoi
         // Depth must be inside the scale pyramid of the image
         const float maxDistance = pMP->GetMaxDistanceInvariance();
         const float minDistance = pMP->GetMinDistanceInvariance();
-        cv::Mat PO = p3Dw-Ow;
-        const float dist3D = cv::norm(PO);
+        const Eigen::Vector3f PO = p3Dw-Ow;
+        const float dist3D = PO.norm();
 
         if(dist3D<minDistance || dist3D>maxDistance)
             continue;
 
         // Viewing angle must be less than 60 deg
-        cv::Mat Pn = pMP->GetNormal();
+        const Eigen::Vector3f Pn = pMP->GetNormal3f();
 
         if(PO.dot(Pn)<0.5*dist3D)
             continue;
@@ -1012,17 +1056,19 @@ int ORBmatcher::Fuse(KeyFrame *pKF, cv::Mat Scw, const vector<MapPoint *> &vpPoi
         // Search in a radius
         const float radius = th*pKF->mvScaleFactors[nPredictedLevel];
 
-        const vector<size_t> vIndices = pKF->GetFeaturesInArea(u,v,radius);
+        pKF->GetFeaturesInArea(mvIndicesArea,u,v,radius);
+        const vector<size_t> &vIndices = mvIndicesArea;
 
         if(vIndices.empty())
             continue;
 
         // Match to the most similar keypoint in the radius
 
-        const cv::Mat dMP = pMP->GetDescriptor();
+        const Descriptor dMP = pMP->GetDescriptor();
 
         int bestDist = INT_MAX;
         int bestIdx = -1;
+        LimpiarCandidatos();
         for(vector<size_t>::const_iterator vit=vIndices.begin(); vit!=vIndices.end(); vit++)
         {
             const size_t idx = *vit;
@@ -1031,9 +1077,14 @@ int ORBmatcher::Fuse(KeyFrame *pKF, cv::Mat Scw, const vector<MapPoint *> &vpPoi
             if(kpLevel<nPredictedLevel-1 || kpLevel>nPredictedLevel)
                 continue;
 
-            const cv::Mat &dKF = pKF->mDescriptors.row(idx);
+            AgregarCandidato(idx, pKF->mDescriptors.ptr(idx));
+        }
+        const int *distancias = DistanciasCandidatos(dMP.ptr());
 
-            int dist = DescriptorDistance(dMP,dKF);
+        for(size_t k=0; k<mvCandidatos.size(); k++)
+        {
+            const size_t idx = mvCandidatos[k];
+            int dist = distancias[k];
 
             if(dist<bestDist)
             {
@@ -1152,16 +1203,18 @@ int ORBmatcher::SearchBySim3(KeyFrame *pKF1, KeyFrame *pKF2, vector<MapPoint*> &
         // Search in a radius
         const float radius = th*pKF2->mvScaleFactors[nPredictedLevel];
 
-        const vector<size_t> vIndices = pKF2->GetFeaturesInArea(u,v,radius);
+        pKF2->GetFeaturesInArea(mvIndicesArea,u,v,radius);
+        const vector<size_t> &vIndices = mvIndicesArea;
 
         if(vIndices.empty())
             continue;
 
         // Match to the most similar keypoint in the radius
-        const cv::Mat dMP = pMP->GetDescriptor();
+        const Descriptor dMP = pMP->GetDescriptor();
 
         int bestDist = INT_MAX;
         int bestIdx = -1;
+        LimpiarCandidatos();
         for(vector<size_t>::const_iterator vit=vIndices.begin(), vend=vIndices.end(); vit!=vend; vit++)
         {
             const size_t idx = *vit;
@@ -1171,9 +1224,14 @@ int ORBmatcher::SearchBySim3(KeyFrame *pKF1, KeyFrame *pKF2, vector<MapPoint*> &
             if(kp.octave<nPredictedLevel-1 || kp.octave>nPredictedLevel)
                 continue;
 
-            const cv::Mat &dKF = pKF2->mDescriptors.row(idx);
+            AgregarCandidato(idx, pKF2->mDescriptors.ptr(idx));
+        }
+        const int *distancias = DistanciasCandidatos(dMP.ptr());
 
-            const int dist = DescriptorDistance(dMP,dKF);
+        for(size_t k=0; k<mvCandidatos.size(); k++)
+        {
+            const size_t idx = mvCandidatos[k];
+            const int dist = distancias[k];
 
             if(dist<bestDist)
             {
@@ -1232,16 +1290,18 @@ int ORBmatcher::SearchBySim3(KeyFrame *pKF1, KeyFrame *pKF2, vector<MapPoint*> &
         // Search in a radius of 2.5*sigma(ScaleLevel)
         const float radius = th*pKF1->mvScaleFactors[nPredictedLevel];
 
-        const vector<size_t> vIndices = pKF1->GetFeaturesInArea(u,v,radius);
+        pKF1->GetFeaturesInArea(mvIndicesArea,u,v,radius);
+        const vector<size_t> &vIndices = mvIndicesArea;
 
         if(vIndices.empty())
             continue;
 
         // Match to the most similar keypoint in the radius
-        const cv::Mat dMP = pMP->GetDescriptor();
+        const Descriptor dMP = pMP->GetDescriptor();
 
         int bestDist = INT_MAX;
         int bestIdx = -1;
+        LimpiarCandidatos();
         for(vector<size_t>::const_iterator vit=vIndices.begin(), vend=vIndices.end(); vit!=vend; vit++)
         {
             const size_t idx = *vit;
@@ -1251,9 +1311,14 @@ int ORBmatcher::SearchBySim3(KeyFrame *pKF1, KeyFrame *pKF2, vector<MapPoint*> &
             if(kp.octave<nPredictedLevel-1 || kp.octave>nPredictedLevel)
                 continue;
 
-            const cv::Mat &dKF = pKF1->mDescriptors.row(idx);
+            AgregarCandidato(idx, pKF1->mDescriptors.ptr(idx));
+        }
+        const int *distancias = DistanciasCandidatos(dMP.ptr());
 
-            const int dist = DescriptorDistance(dMP,dKF);
+        for(size_t k=0; k<mvCandidatos.size(); k++)
+        {
+            const size_t idx = mvCandidatos[k];
+            const int dist = distancias[k];
 
             if(dist<bestDist)
             {
@@ -1299,15 +1364,7 @@ int ORBmatcher::SearchByProjection(Frame &CurrentFrame, const Frame &LastFrame,
         rotHist[i].reserve(500);
     const float factor = 1.0f/HISTO_LENGTH;
 
-    const cv::Mat Rcw = CurrentFrame.mTcw.rowRange(0,3).colRange(0,3);
-    const cv::Mat tcw = CurrentFrame.mTcw.rowRange(0,3).col(3);
-
-    const cv::Mat twc = -Rcw.t()*tcw;
-
-    const cv::Mat Rlw = LastFrame.mTcw.rowRange(0,3).colRange(0,3);
-    const cv::Mat tlw = LastFrame.mTcw.rowRange(0,3).col(3);
-
-    const cv::Mat tlc = Rlw*twc+tlw;
+    const SE3f &Tcw = CurrentFrame.GetPose3f();
 
     // Recorre todos los puntos singulares de LastFrame
     for(int i=0; i<LastFrame.N; i++)
@@ -1321,12 +1378,12 @@ int ORBmatcher::SearchByProjection(Frame &CurrentFrame, const Frame &LastFrame,
         	if(!LastFrame.mvbOutlier[i])
             {
                 // Project
-                cv::Mat x3Dw = pMP->GetWorldPos();
-                cv::Mat x3Dc = Rcw*x3Dw+tcw;
+                const Eigen::Vector3f x3Dw = pMP->GetWorldPos3f();
+                const Eigen::Vector3f x3Dc = Tcw*x3Dw;
 
-                const float xc = x3Dc.at<float>(0);
-                const float yc = x3Dc.at<float>(1);
-                const float invzc = 1.0/x3Dc.at<float>(2);
+                const float xc = x3Dc(0);
+                const float yc = x3Dc(1);
+                const float invzc = 1.0/x3Dc(2);
 
                 // Continuar con el siguiente si la proyección no es posible
                 if(invzc<0)
@@ -1341,22 +1398,24 @@ int ORBmatcher::SearchByProjection(Frame &CurrentFrame, const Frame &LastFrame,
                 if(v<CurrentFrame.mnMinY || v>CurrentFrame.mnMaxY)
                     continue;
 
-                int nLastOctave = LastFrame.mvKeys[i].octave;
+                int nLastOctave = LastFrame.GetKeys()[i].octave;
 
                 // Search in a window. Size depends on scale
                 float radius = th*CurrentFrame.mvScaleFactors[nLastOctave];
 
-                vector<size_t> vIndices2 = CurrentFrame.GetFeaturesInArea(u,v, radius, nLastOctave-1, nLastOctave+1);
+                CurrentFrame.GetFeaturesInArea(mvIndicesArea,u,v, radius, nLastOctave-1, nLastOctave+1);
+                const vector<size_t> &vIndices2 = mvIndicesArea;
 
                 if(vIndices2.empty())
                     continue;
 
-                const cv::Mat dMP = pMP->GetDescriptor();
+                const Descriptor dMP = pMP->GetDescriptor();
 
                 int bestDist = 256;
                 int bestIdx2 = -1;
 
                 // Recorre los puntos singulares cercanos a la proyección, buscando aquél cuyo descriptor tenga la distancia
+                LimpiarCandidatos();
                 for(vector<size_t>::const_iterator vit=vIndices2.begin(), vend=vIndices2.end(); vit!=vend; vit++)
                 {
                     const size_t i2 = *vit;
@@ -1364,9 +1423,14 @@ int ORBmatcher::SearchByProjection(Frame &CurrentFrame, const Frame &LastFrame,
                         if(CurrentFrame.mvpMapPoints[i2]->Observations()>0)
                             continue;
 
-                    const cv::Mat &d = CurrentFrame.mDescriptors.row(i2);
+                    AgregarCandidato(i2, CurrentFrame.GetDescriptors().ptr(i2));
+                }
+                const int *distancias = DistanciasCandidatos(dMP.ptr());
 
-                    const int dist = DescriptorDistance(dMP,d);
+                for(size_t k=0; k<mvCandidatos.size(); k++)
+                {
+                    const size_t i2 = mvCandidatos[k];
+                    const int dist = distancias[k];
 
                     if(dist<bestDist)
                     {
@@ -1383,7 +1447,7 @@ int ORBmatcher::SearchByProjection(Frame &CurrentFrame, const Frame &LastFrame,
 
                     if(mbCheckOrientation)
                     {
-                        float rot = LastFrame.mvKeysUn[i].angle-CurrentFrame.mvKeysUn[bestIdx2].angle;
+                        float rot = LastFrame.GetKeysUn()[i].angle-CurrentFrame.GetKeysUn()[bestIdx2].angle;
                         if(rot<0.0)
                             rot+=360.0f;
                         int bin = round(rot*factor);
@@ -1426,9 +1490,8 @@ int ORBmatcher::SearchByProjection(Frame &CurrentFrame, KeyFrame *pKF, const set
 {
     int nmatches = 0;
 
-    const cv::Mat Rcw = CurrentFrame.mTcw.rowRange(0,3).colRange(0,3);
-    const cv::Mat tcw = CurrentFrame.mTcw.rowRange(0,3).col(3);
-    const cv::Mat Ow = -Rcw.t()*tcw;
+    const SE3f &Tcw = CurrentFrame.GetPose3f();
+    const Eigen::Vector3f &Ow = CurrentFrame.GetCameraCenter3f();
 
     // Rotation Histogram (to check rotation consistency)
     vector<int> rotHist[HISTO_LENGTH];
@@ -1447,12 +1510,12 @@ int ORBmatcher::SearchByProjection(Frame &CurrentFrame, KeyFrame *pKF, const set
             if(!pMP->isBad() && !sAlreadyFound.count(pMP))
             {
                 //Project
-                cv::Mat x3Dw = pMP->GetWorldPos();
-                cv::Mat x3Dc = Rcw*x3Dw+tcw;
+                const Eigen::Vector3f x3Dw = pMP->GetWorldPos3f();
+                const Eigen::Vector3f x3Dc = Tcw*x3Dw;
 
-                const float xc = x3Dc.at<float>(0);
-                const float yc = x3Dc.at<float>(1);
-                const float invzc = 1.0/x3Dc.at<float>(2);
+                const float xc = x3Dc(0);
+                const float yc = x3Dc(1);
+                const float invzc = 1.0/x3Dc(2);
 
                 const float u = CurrentFrame.fx*xc*invzc+CurrentFrame.cx;
                 const float v = CurrentFrame.fy*yc*invzc+CurrentFrame.cy;
@@ -1463,8 +1526,8 @@ int ORBmatcher::SearchByProjection(Frame &CurrentFrame, KeyFrame *pKF, const set
                     continue;
 
                 // Compute predicted scale level
-                cv::Mat PO = x3Dw-Ow;
-                float dist3D = cv::norm(PO);
+                const Eigen::Vector3f PO = x3Dw-Ow;
+                float dist3D = PO.norm();
 
                 const float maxDistance = pMP->GetMaxDistanceInvariance();
                 const float minDistance = pMP->GetMinDistanceInvariance();
@@ -1478,25 +1541,32 @@ int ORBmatcher::SearchByProjection(Frame &CurrentFrame, KeyFrame *pKF, const set
                 // Search in a window
                 const float radius = th*CurrentFrame.mvScaleFactors[nPredictedLevel];
 
-                const vector<size_t> vIndices2 = CurrentFrame.GetFeaturesInArea(u, v, radius, nPredictedLevel-1, nPredictedLevel+1);
+                CurrentFrame.GetFeaturesInArea(mvIndicesArea, u, v, radius, nPredictedLevel-1, nPredictedLevel+1);
+                const vector<size_t> &vIndices2 = mvIndicesArea;
 
                 if(vIndices2.empty())
                     continue;
 
-                const cv::Mat dMP = pMP->GetDescriptor();
+                const Descriptor dMP = pMP->GetDescriptor();
 
                 int bestDist = 256;
                 int bestIdx2 = -1;
 
+                LimpiarCandidatos();
                 for(vector<size_t>::const_iterator vit=vIndices2.begin(); vit!=vIndices2.end(); vit++)
                 {
                     const size_t i2 = *vit;
                     if(CurrentFrame.mvpMapPoints[i2])
                         continue;
 
-                    const cv::Mat &d = CurrentFrame.mDescriptors.row(i2);
+                    AgregarCandidato(i2, CurrentFrame.GetDescriptors().ptr(i2));
+                }
+                const int *distancias = DistanciasCandidatos(dMP.ptr());
 
-                    const int dist = DescriptorDistance(dMP,d);
+                for(size_t k=0; k<mvCandidatos.size(); k++)
+                {
+                    const size_t i2 = mvCandidatos[k];
+                    const int dist = distancias[k];
 
                     if(dist<bestDist)
                     {
@@ -1512,7 +1582,7 @@ int ORBmatcher::SearchByProjection(Frame &CurrentFrame, KeyFrame *pKF, const set
 
                     if(mbCheckOrientation)
                     {
-                        float rot = pKF->mvKeysUn[i].angle-CurrentFrame.mvKeysUn[bestIdx2].angle;
+                        float rot = pKF->mvKeysUn[i].angle-CurrentFrame.GetKeysUn()[bestIdx2].angle;
                         if(rot<0.0)
                             rot+=360.0f;
                         int bin = round(rot*factor);
@@ -1595,23 +1665,21 @@ void ORBmatcher::ComputeThreeMaxima(vector<int>* histo, const int L, int &ind1,
 }
 
 /**
- * Calcula la distancia de Hamming entre dos descriptores, con el algoritmo de Stanford.
- * @param a Descriptor A.
- * @param b Descriptor B.
- * @returns La distancia entre los dos descriptores binarios.
+ * Calcula la distancia de Hamming entre dos descriptores de 32 bytes, con el algoritmo de Stanford.
+ * Núcleo escalar, usado cuando el procesador no tiene popcnt.
  */
 // Bit set count operation from
 // http://graphics.stanford.edu/~seander/bithacks.html#CountBitsSetParallel
-int ORBmatcher::DescriptorDistance(const cv::Mat &a, const cv::Mat &b)
+static inline int DescriptorDistanceScalar(const uchar *a, const uchar *b)
 {
-    const int *pa = a.ptr<int32_t>();
-    const int *pb = b.ptr<int32_t>();
-
     int dist=0;
 
-    for(int i=0; i<8; i++, pa++, pb++)
+    for(int i=0; i<8; i++)
     {
-        unsigned  int v = *pa ^ *pb;
+        int32_t ia, ib;
+        memcpy(&ia, a+4*i, 4);
+        memcpy(&ib, b+4*i, 4);
+        unsigned  int v = ia ^ ib;
         v = v - ((v >> 1) & 0x55555555);
         v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
         dist += (((v + (v >> 4)) & 0xF0F0F0F) * 0x1010101) >> 24;
@@ -1620,4 +1688,109 @@ int ORBmatcher::DescriptorDistance(const cv::Mat &a, const cv::Mat &b)
     return dist;
 }
 
+static void DescriptorDistancesScalar(const uchar *a, const uchar* const* vpB, const int n, int *distancias)
+{
+    for(int i=0; i<n; i++)
+        distancias[i] = DescriptorDistanceScalar(a, vpB[i]);
+}
+
+#if defined(__x86_64__)
+
+/**
+ * Núcleo popcnt: 4 palabras de 64 bits por descriptor.
+ */
+__attribute__((target("popcnt")))
+static void DescriptorDistancesPopcnt(const uchar *a, const uchar* const* vpB, const int n, int *distancias)
+{
+    uint64_t qa[4];
+    memcpy(qa, a, 32);
+    for(int i=0; i<n; i++)
+    {
+        uint64_t qb[4];
+        memcpy(qb, vpB[i], 32);
+        distancias[i] = (int)(_mm_popcnt_u64(qa[0]^qb[0]) + _mm_popcnt_u64(qa[1]^qb[1]) +
+                              _mm_popcnt_u64(qa[2]^qb[2]) + _mm_popcnt_u64(qa[3]^qb[3]));
+    }
+}
+
+/**
+ * Distancia de Hamming AVX2 entre dos descriptores, como suma de bits por grupos de 8 bytes: 4 enteros de 64 bits.
+ * Cuenta bits con la tabla de nibbles (vpshufb) y suma bytes con vpsadbw.
+ */
+__attribute__((target("avx2")))
+static inline __m256i ContarBitsAVX2(const __m256i va, const uchar *b)
+{
+    const __m256i tabla = _mm256_setr_epi8(0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4, 0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    const __m256i x = _mm256_xor_si256(va, _mm256_loadu_si256((const __m256i*)b));
+    const __m256i bits = _mm256_add_epi8(_mm256_shuffle_epi8(tabla, _mm256_and_si256(x, nibble)),
+                                         _mm256_shuffle_epi8(tabla, _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble)));
+    return _mm256_sad_epu8(bits, _mm256_setzero_si256());
+}
+
+/**
+ * Núcleo AVX2: cada descriptor es un registro de 256 bits.
+ * Procesa 4 candidatos por iteración para reunir las 4 sumas en un único registro.
+ */
+__attribute__((target("avx2")))
+static void DescriptorDistancesAVX2(const uchar *a, const uchar* const* vpB, const int n, int *distancias)
+{
+    const __m256i va = _mm256_loadu_si256((const __m256i*)a);
+
+    int i=0;
+    for(; i+4<=n; i+=4)
+    {
+        const __m256i s0 = ContarBitsAVX2(va, vpB[i]), s1 = ContarBitsAVX2(va, vpB[i+1]),
+                      s2 = ContarBitsAVX2(va, vpB[i+2]), s3 = ContarBitsAVX2(va, vpB[i+3]);
+        const __m256i s01 = _mm256_add_epi64(_mm256_unpacklo_epi64(s0, s1), _mm256_unpackhi_epi64(s0, s1));
+        const __m256i s23 = _mm256_add_epi64(_mm256_unpacklo_epi64(s2, s3), _mm256_unpackhi_epi64(s2, s3));
+        const __m256i suma = _mm256_add_epi64(_mm256_permute2x128_si256(s01, s23, 0x20), _mm256_permute2x128_si256(s01, s23, 0x31));
+        const __m256i d = _mm256_permutevar8x32_epi32(suma, _mm256_setr_epi32(0,2,4,6,1,3,5,7));
+        _mm_storeu_si128((__m128i*)(distancias+i), _mm256_castsi256_si128(d));
+    }
+    for(; i<n; i++)
+    {
+        const __m256i s = ContarBitsAVX2(va, vpB[i]);
+        const __m128i s2 = _mm_add_epi64(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1));
+        distancias[i] = (int)(_mm_cvtsi128_si64(s2) + _mm_extract_epi64(s2, 1));
+    }
+}
+
+#endif
+
+void ORBmatcher::DescriptorDistances(const uchar *a, const uchar* const* vpB, const int n, int *distancias)
+{
+#if defined(__x86_64__)
+    enum {ESCALAR, POPCNT, AVX2};
+    static const int nucleo = __builtin_cpu_supports("avx2")? AVX2 : __builtin_cpu_supports("popcnt")? POPCNT : ESCALAR;
+
+    if(nucleo == AVX2)
+        DescriptorDistancesAVX2(a, vpB, n, distancias);
+    else if(nucleo == POPCNT)
+        DescriptorDistancesPopcnt(a, vpB, n, distancias);
+    else
+#endif
+        DescriptorDistancesScalar(a, vpB, n, distancias);
+}
+
+/**
+ * Calcula la distancia de Hamming entre dos descriptores.
+ * @param a Descriptor A.
+ * @param b Descriptor B.
+ * @returns La distancia entre los dos descriptores binarios.
+ */
+int ORBmatcher::DescriptorDistance(const uchar *a, const uchar *b)
+{
+    int dist;
+    DescriptorDistances(a, &b, 1, &dist);
+    return dist;
+}
+
+const int* ORBmatcher::DistanciasCandidatos(const uchar *a)
+{
+    mvDistancias.resize(mvCandidatos.size());
+    DescriptorDistances(a, mvpDescriptoresCandidatos.data(), mvCandidatos.size(), mvDistancias.data());
+    return mvDistancias.data();
+}
+
 } //namespace ORB_SLAM
@@ -92,7 +92,7 @@ void Optimizer::BundleAdjustment(const vector<KeyFrame *> &vpKFs, const vector<M
         if(pMP->isBad())
             continue;
         g2o::VertexSBAPointXYZ* vPoint = new g2o::VertexSBAPointXYZ();
-        vPoint->setEstimate(Converter::toVector3d(pMP->GetWorldPos()));
+        vPoint->setEstimate(pMP->GetWorldPos3f().cast<double>());
         const int id = pMP->mnId+maxKFid+1;
         vPoint->setId(id);
         vPoint->setMarginalized(true);
@@ -190,7 +190,7 @@ void Optimizer::BundleAdjustment(const vector<KeyFrame *> &vpKFs, const vector<M
 
         if(nLoopKF==0)
         {
-            pMP->SetWorldPos(Converter::toCvMat(vPoint->estimate()));
+            pMP->SetWorldPos(Eigen::Vector3f(vPoint->estimate().cast<float>()));
             pMP->UpdateNormalAndDepth();
         }
         else
@@ -246,7 +246,7 @@ int Optimizer::PoseOptimization(Frame *pFrame)
 			pFrame->mvbOutlier[i] = false;
 
 			Eigen::Matrix<double,2,1> obs;
-			const cv::KeyPoint &kpUn = pFrame->mvKeysUn[i];
+			const cv::KeyPoint &kpUn = pFrame->GetKeysUn()[i];
 			obs << kpUn.pt.x, kpUn.pt.y;
 
 			g2o::EdgeSE3ProjectXYZOnlyPose* e = new g2o::EdgeSE3ProjectXYZOnlyPose();
@@ -264,10 +264,7 @@ int Optimizer::PoseOptimization(Frame *pFrame)
 			e->fy = pFrame->fy;
 			e->cx = pFrame->cx;
 			e->cy = pFrame->cy;
-			cv::Mat Xw = pMP->GetWorldPos();
-			e->Xw[0] = Xw.at<float>(0);
-			e->Xw[1] = Xw.at<float>(1);
-			e->Xw[2] = Xw.at<float>(2);
+			e->Xw = pMP->GetWorldPos3f().cast<double>();
 
 			optimizer.addEdge(e);
 
@@ -451,7 +448,7 @@ void Optimizer::LocalBundleAdjustment(KeyFrame *pKF, bool* pbStopFlag, Map* pMap
     {
         MapPoint* pMP = *lit;
         g2o::VertexSBAPointXYZ* vPoint = new g2o::VertexSBAPointXYZ();
-        vPoint->setEstimate(Converter::toVector3d(pMP->GetWorldPos()));
+        vPoint->setEstimate(pMP->GetWorldPos3f().cast<double>());
         int id = pMP->mnId+maxKFid+1;
         vPoint->setId(id);
         vPoint->setMarginalized(true);
@@ -582,7 +579,7 @@ void Optimizer::LocalBundleAdjustment(KeyFrame *pKF, bool* pbStopFlag, Map* pMap
     {
         MapPoint* pMP = *lit;
         g2o::VertexSBAPointXYZ* vPoint = static_cast<g2o::VertexSBAPointXYZ*>(optimizer.vertex(pMP->mnId+maxKFid+1));
-        pMP->SetWorldPos(Converter::toCvMat(vPoint->estimate()));
+        pMP->SetWorldPos(Eigen::Vector3f(vPoint->estimate().cast<float>()));
         pMP->UpdateNormalAndDepth();
     }
 }
@@ -535,34 +535,11 @@ void Osmap::rebuild(bool noSetBad){
 
 		/*
 		 * Rebuilding grid.
-		 * Code from Frame::AssignFeaturesToGrid()
+		 * Same as Frame::AssignFeaturesToGrid()
 		 */
-		std::vector<std::size_t> grid[pKF->mnGridCols][pKF->mnGridRows];
-		int nReserve = 0.5f*pKF->N/(pKF->mnGridCols*pKF->mnGridRows);
-		for(int i=0; i<pKF->mnGridCols;i++)
-			for (int j=0; j<pKF->mnGridRows;j++)
-				grid[i][j].reserve(nReserve);
+		pKF->mGrid.Construir(pKF->mvKeysUn, pKF->mnMinX, pKF->mnMinY, pKF->mfGridElementWidthInv, pKF->mfGridElementHeightInv);
 		log("Grid built");
 
-		for(int i=0;i<pKF->N;i++){
-			const cv::KeyPoint &kp = pKF->mvKeysUn[i];
-			int posX = round((kp.pt.x-pKF->mnMinX)*pKF->mfGridElementWidthInv);
-			int posY = round((kp.pt.y-pKF->mnMinY)*pKF->mfGridElementHeightInv);
-
-			//Keypoint's coordinates are undistorted, which could cause to go out of the image
-			if(!(posX<0 || posX>=pKF->mnGridCols || posY<0 || posY>=pKF->mnGridRows))
-				grid[posX][posY].push_back(i);
-		}
-		log("Grid full");
-
-		pKF->mGrid.resize(pKF->mnGridCols);
-		for(int i=0; i < pKF->mnGridCols;i++){
-			pKF->mGrid[i].resize(pKF->mnGridRows);
-			for(int j=0; j < pKF->mnGridRows; j++)
-				pKF->mGrid[i][j] = grid[i][j];
-		}
-		log("Grid fitted");
-
 		// Append keyframe to the database
 		keyFrameDatabase.add(pKF);
 
@@ -815,6 +792,18 @@ void Osmap::deserialize(const SerializedPosition &serializedPosition, Mat &m){
   m.at<float>(2,0) = serializedPosition.z();
 }
 
+#ifndef OSMAP_DUMMY_MAP
+void Osmap::serialize(const Eigen::Vector3f &v, SerializedPosition *serializedPosition){
+  serializedPosition->set_x(v(0));
+  serializedPosition->set_y(v(1));
+  serializedPosition->set_z(v(2));
+}
+
+void Osmap::deserialize(const SerializedPosition &serializedPosition, Eigen::Vector3f &v){
+  v = Eigen::Vector3f(serializedPosition.x(), serializedPosition.y(), serializedPosition.z());
+}
+#endif
+
 // KeyPoint ================================================================================================
 void Osmap::serialize(const KeyPoint &kp, SerializedKeypoint *serializedKeypoint){
   serializedKeypoint->set_ptx(kp.pt.x);
@@ -839,7 +828,7 @@ void Osmap::serialize(const OsmapMapPoint &mappoint, SerializedMappoint *seriali
   serializedMappoint->set_visible(mappoint.mnVisible);
   serializedMappoint->set_found(mappoint.mnFound);
   //if(options[NO_FEATURES_DESCRIPTORS])	// This is the only descriptor to serialize	** This line is disable to force mappoint descriptor serialization, while it's not being reconstructed in rebuild. **
-    serialize(mappoint.mDescriptor, serializedMappoint->mutable_briefdescriptor());
+    serialize(mappoint.mDescriptor.toMat(), serializedMappoint->mutable_briefdescriptor());
 }
 
 OsmapMapPoint *Osmap::deserialize(const SerializedMappoint &serializedMappoint){
@@ -848,7 +837,11 @@ OsmapMapPoint *Osmap::deserialize(const SerializedMappoint &serializedMappoint){
   pMappoint->mnId        = serializedMappoint.id();
   pMappoint->mnVisible   = serializedMappoint.visible();
   pMappoint->mnFound     = serializedMappoint.found();
-  if(serializedMappoint.has_briefdescriptor()) deserialize(serializedMappoint.briefdescriptor(), pMappoint->mDescriptor);
+  if(serializedMappoint.has_briefdescriptor()){
+	Mat descriptor;
+	deserialize(serializedMappoint.briefdescriptor(), descriptor);
+	pMappoint->mDescriptor = Descriptor(descriptor);
+  }
   if(serializedMappoint.has_position())        deserialize(serializedMappoint.position(),        pMappoint->mWorldPos  );
 
   return pMappoint;
@@ -950,7 +943,7 @@ void Osmap::serialize(const OsmapKeyFrame &keyframe, SerializedKeyframeFeatures
 
 		// Serialize descriptor but skip if chosen to not do so.
 		if(!options[NO_FEATURES_DESCRIPTORS])	//
-		  serialize(keyframe.mDescriptors.row(i), serializedFeature.mutable_briefdescriptor());
+		  serialize(keyframe.mDescriptors.toMat().row(i), serializedFeature.mutable_briefdescriptor());
 	}
   }
 }
@@ -963,7 +956,7 @@ OsmapKeyFrame *Osmap::deserialize(const SerializedKeyframeFeatures &serializedKe
 	  const_cast<int&>(pKF->N) = n;
 	  const_cast<std::vector<cv::KeyPoint>&>(pKF->mvKeysUn).resize(n);
 	  pKF->mvpMapPoints.resize(n);
-	  const_cast<cv::Mat&>(pKF->mDescriptors) = Mat(n, 32, CV_8UC1);	// n descriptors
+	  const_cast<Descriptores&>(pKF->mDescriptors).create(n);	// n descriptors
 
 // ORB-SLAM2 needs to have set mvuRight and mvDepth even though they are not used in monocular.  DUMMY_MAP and OS1 don't have these properties.
 #if !defined OSMAP_DUMMY_MAP && !defined OS1
@@ -977,7 +970,7 @@ OsmapKeyFrame *Osmap::deserialize(const SerializedKeyframeFeatures &serializedKe
 		if(feature.has_briefdescriptor()){
 			Mat descriptor;
 			deserialize(feature.briefdescriptor(), descriptor);
-			descriptor.copyTo(pKF->mDescriptors.row(i));
+			memcpy(const_cast<uchar*>(pKF->mDescriptors.ptr(i)), descriptor.ptr(), Descriptor::BYTES);
 		}
 	  }
   } else {
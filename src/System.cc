@@ -96,8 +96,21 @@ System::System(const string &strVocFile, const string &strSettingsFile, const eS
 
 
     //Load ORB Vocabulary
-    cout << endl << "Loading ORB Vocabulary. This could take a while..." << endl;
-    bool bVocLoad = mpVocabulary->loadFromBinaryFile(strVocFile);
+    // Primero el vocabulario plano, que se mapea en memoria sin construir el árbol.
+    // Si no existe o no corresponde al binario, se carga el binario y se regenera el plano para los próximos arranques.
+    const string strVocPlano = strVocFile + ".plano";
+    bool bVocLoad = mpVocabulary->CargarPlano(strVocPlano, strVocFile);
+    if(bVocLoad)
+        cout << endl << "Vocabulario plano mapeado: " << strVocPlano << endl;
+    else {
+        cout << endl << "Loading ORB Vocabulary. This could take a while..." << endl;
+        bVocLoad = mpVocabulary->loadFromBinaryFile(strVocFile);
+        if(bVocLoad){
+            mpVocabulary->Aplanar();
+            if(mpVocabulary->GuardarPlano(strVocPlano, strVocFile))
+                cout << "Vocabulario plano guardado en " << strVocPlano << endl;
+        }
+    }
     if(!bVocLoad){
         cerr << "Wrong path to vocabulary. " << endl;
         cerr << "Falied to open at: " << strVocFile << endl;
@@ -105,6 +118,12 @@ System::System(const string &strVocFile, const string &strSettingsFile, const eS
         exit(-1);
     }
     mpKeyFrameDatabase->resizeInvertedFile(mpVocabulary->size());
+
+    // Hilos de Transformar.  0 (o ausente) usa todos los núcleos.
+    int nHilosVocabulario = fsSettings["Vocabulary.threads"];
+    if(nHilosVocabulario<1)
+    	nHilosVocabulario = max(1u, thread::hardware_concurrency());
+    mpVocabulary->SetHilos(nHilosVocabulario);
     cout << "Vocabulary loaded!" << endl << endl;
 
 
@@ -0,0 +1,69 @@
+/*
+ * TablaAntidistorsion.cc
+ *
+ *  Created on: 17 oct. 2026
+ *      Author: alejandro
+ */
+
+#include "TablaAntidistorsion.h"
+#include <cmath>
+#include <iostream>
+
+using namespace std;
+
+namespace ORB_SLAM2{
+
+void TablaAntidistorsion::Construir(const cv::Size &tamano, const Antidistorsionador &antidistorsionar, const float errorMaximo){
+	for(int paso = 8; paso >= 1; paso /= 2){
+		// Nodos que cubren la imagen, con una fila y una columna más allá del borde
+		const int columnas = tamano.width/paso + 2;
+		const int filas = tamano.height/paso + 2;
+
+		cv::Mat nodos(filas*columnas, 1, CV_32FC2);
+		cv::Vec2f *pNodo = nodos.ptr<cv::Vec2f>();
+		for(int i=0; i<filas; i++)
+			for(int j=0; j<columnas; j++)
+				*pNodo++ = cv::Vec2f(j*paso, i*paso);
+		antidistorsionar(nodos);
+
+		mTabla = nodos.reshape(2, filas);
+		mnPaso = paso;
+		mfPasoInv = 1.0f/paso;
+
+		// Error en el centro de cada celda, donde la interpolación bilineal se aleja más de los nodos
+		cv::Mat centros((filas-1)*(columnas-1), 1, CV_32FC2);
+		cv::Vec2f *pCentro = centros.ptr<cv::Vec2f>();
+		for(int i=0; i<filas-1; i++)
+			for(int j=0; j<columnas-1; j++)
+				*pCentro++ = cv::Vec2f((j+0.5f)*paso, (i+0.5f)*paso);
+		cv::Mat exactos = centros.clone();
+		antidistorsionar(exactos);
+
+		mfError = 0;
+		const cv::Vec2f *pC = centros.ptr<cv::Vec2f>(), *pE = exactos.ptr<cv::Vec2f>();
+		for(int k=0; k<centros.rows; k++){
+			const cv::Point2f interpolado = Antidistorsionar(cv::Point2f(pC[k][0], pC[k][1]));
+			const float error = max(fabs(interpolado.x - pE[k][0]), fabs(interpolado.y - pE[k][1]));
+			if(error > mfError)
+				mfError = error;
+		}
+
+		if(mfError <= errorMaximo){
+			cout << "Tabla de antidistorsión: paso " << mnPaso << " px, error máximo " << mfError << " px" << endl;
+			return;
+		}
+	}
+
+	// Ni con paso 1 se alcanza la precisión pedida (ej. fisheye cuyo campo visual se acerca a 180º): se usará el modelo exacto
+	cout << "Tabla de antidistorsión descartada, error " << mfError << " px con paso 1" << endl;
+	Liberar();
+}
+
+void TablaAntidistorsion::Liberar(){
+	mTabla.release();
+	mnPaso = 0;
+	mfPasoInv = 0;
+	mfError = 0;
+}
+
+}// namespace ORB_SLAM2
@@ -23,6 +23,8 @@
 
 #include<opencv2/core/core.hpp>
 #include<opencv2/features2d/features2d.hpp>
+#include<opencv2/video/tracking.hpp>
+#include<opencv2/calib3d/calib3d.hpp>
 
 #include"ORBmatcher.h"
 #include"FrameDrawer.h"
@@ -37,6 +39,9 @@
 #include<iostream>
 
 #include<mutex>
+#include<atomic>
+#include<thread>
+#include<chrono>
 
 
 using namespace std;
@@ -62,9 +67,14 @@ Tracking::Tracking(System *pSys, ORBVocabulary* pVoc, FrameDrawer *pFrameDrawer,
     int fIniThFAST = fSettings["ORBextractor.iniThFAST"];
     int fMinThFAST = fSettings["ORBextractor.minThFAST"];
 
-    mpORBextractorLeft = new ORBextractor(nFeatures,fScaleFactor,nLevels,fIniThFAST,fMinThFAST);
+    // Hilos para procesar los niveles de la pirámide en paralelo.  Si no se especifica, se procesa con un único hilo.
+    int nThreads = fSettings["ORBextractor.nThreads"];
+    if(nThreads<1)
+    	nThreads = 1;
 
-    mpIniORBextractor = new ORBextractor(2*nFeatures,fScaleFactor,nLevels,fIniThFAST,fMinThFAST);
+    mpORBextractorLeft = new ORBextractor(nFeatures,fScaleFactor,nLevels,fIniThFAST,fMinThFAST,nThreads);
+
+    mpIniORBextractor = new ORBextractor(2*nFeatures,fScaleFactor,nLevels,fIniThFAST,fMinThFAST,nThreads);
 
     cout << endl  << "ORB Extractor Parameters: " << endl;
     cout << "- Number of Features: " << nFeatures << endl;
@@ -72,6 +82,38 @@ Tracking::Tracking(System *pSys, ORBVocabulary* pVoc, FrameDrawer *pFrameDrawer,
     cout << "- Scale Factor: " << fScaleFactor << endl;
     cout << "- Initial Fast Threshold: " << fIniThFAST << endl;
     cout << "- Minimum Fast Threshold: " << fMinThFAST << endl;
+    cout << "- Threads: " << nThreads << endl;
+
+    // Pipeline: extracción del cuadro siguiente en paralelo con el tracking del actual
+    int nPipeline = fSettings["Tracking.pipeline"];
+    if(nPipeline>0)
+    	mpPipeline = new WorkerPool(2, "Pipeline");
+    cout << "- Pipeline: " << (mpPipeline? "on" : "off") << endl;
+
+    // Relocalización: candidatos en paralelo.  0 (o ausente) usa todos los núcleos.
+    int nHilosRelocalizacion = fSettings["Tracking.relocalizationThreads"];
+    if(nHilosRelocalizacion<1)
+    	nHilosRelocalizacion = max(1u, thread::hardware_concurrency());
+    mpPoolRelocalizacion = new WorkerPool(nHilosRelocalizacion, "Relocalizacion");
+    cout << "- Relocalization threads: " << nHilosRelocalizacion << endl;
+
+    // Flujo óptico entre keyframes, sólo sin pipeline
+    int nFlujo = fSettings["Tracking.klt"];
+    mbFlujo = nFlujo>0 && !mpPipeline;
+    cout << "- KLT: " << (mbFlujo? "on" : (nFlujo>0? "off (incompatible with pipeline)" : "off")) << endl;
+
+    // Extracción en regiones de interés, sólo sin pipeline
+    int nROI = fSettings["Tracking.roi"];
+    mbROI = nROI>0 && !mpPipeline;
+    cout << "- ROI: " << (mbROI? "on" : (nROI>0? "off (incompatible with pipeline)" : "off")) << endl;
+
+    // Control de presupuesto por plazo.  0 (o ausente) lo desactiva.
+    float fPlazo = fSettings["Tracking.deadlineMs"];
+    mControlPresupuesto.Configurar(fPlazo, nFeatures, nLevels);
+    if(mControlPresupuesto.Activo())
+    	cout << "- Deadline: " << fPlazo << " ms" << endl;
+    else
+    	cout << "- Deadline: off" << endl;
 }
 
 void Tracking::SetLocalMapper(LocalMapping *pLocalMapper)
@@ -89,35 +131,120 @@ void Tracking::SetViewer(Viewer *pViewer)
     mpViewer=pViewer;
 }
 
-cv::Mat Tracking::GrabImageMonocular(const cv::Mat &im, const double &timestamp)
+cv::Mat Tracking::ConvertirAGrises(const cv::Mat &im)
 {
-    mImGray = im;
+    cv::Mat imGray = im;
 
-    if(mImGray.channels()==3)
+    if(imGray.channels()==3)
     {
         if(mbRGB)
-            cvtColor(mImGray,mImGray,cv::COLOR_RGB2GRAY);//CV_RGB2GRAY
+            cvtColor(imGray,imGray,cv::COLOR_RGB2GRAY);//CV_RGB2GRAY
         else
-            cvtColor(mImGray,mImGray,cv::COLOR_BGR2GRAY);//CV_BGR2GRAY
+            cvtColor(imGray,imGray,cv::COLOR_BGR2GRAY);//CV_BGR2GRAY
     }
-    else if(mImGray.channels()==4)
+    else if(imGray.channels()==4)
     {
         if(mbRGB)
-            cvtColor(mImGray,mImGray,cv::COLOR_RGB2GRAY);//CV_RGBA2GRAY
+            cvtColor(imGray,imGray,cv::COLOR_RGB2GRAY);//CV_RGBA2GRAY
         else
-            cvtColor(mImGray,mImGray,cv::COLOR_BGR2GRAY);//CV_BGRA2GRAY
+            cvtColor(imGray,imGray,cv::COLOR_BGR2GRAY);//CV_BGRA2GRAY
     }
 
-    if(mState==NOT_INITIALIZED || mState==NO_IMAGES_YET)
-    	// Inicialización, pide el doble de features a través de mpIniORBextractor
-        mCurrentFrame = Frame(mImGray,timestamp,mpIniORBextractor,mpORBVocabulary,mK,mDistCoef);//,mbf,mThDepth);
-    else
-    	// Tracking y mapping, estado normal, usa ORBextractorLeft (ORBextractorRight se usa solamente en estéreo).
-        mCurrentFrame = Frame(mImGray,timestamp,mpORBextractorLeft,mpORBVocabulary,mK,mDistCoef);//,mbf);//,mThDepth);
+    return imGray;
+}
+
+cv::Mat Tracking::GrabImageMonocular(const cv::Mat &im, const double &timestamp)
+{
+    if(!mControlPresupuesto.Activo())
+        return ProcesarImagen(im, timestamp);
+
+    // Control de presupuesto: ajusta el extractor, mide el cuadro y decide el presupuesto del siguiente
+    mpORBextractorLeft->SetPresupuesto(mControlPresupuesto.Features(), mControlPresupuesto.Niveles());
+    const auto inicio = chrono::steady_clock::now();
+    cv::Mat Tcw = ProcesarImagen(im, timestamp);
+    const float tiempo = chrono::duration<float, milli>(chrono::steady_clock::now() - inicio).count();
+    mControlPresupuesto.Registrar(tiempo, mnMatchesInliers, mState==OK);
+
+    return Tcw;
+}
+
+cv::Mat Tracking::ProcesarImagen(const cv::Mat &im, const double &timestamp)
+{
+    // Inicialización, pide el doble de features a través de mpIniORBextractor.
+    // Tracking y mapping, estado normal, usa ORBextractorLeft (ORBextractorRight se usa solamente en estéreo).
+    ORBextractor* pExtractor = (mState==NOT_INITIALIZED || mState==NO_IMAGES_YET)? mpIniORBextractor : mpORBextractorLeft;
+
+    if(!mpPipeline || mState==NO_IMAGES_YET)
+    {
+        // En secuencia: extrae y rastrea el mismo cuadro
+        mbHayPendiente = false;
+        mImGray = ConvertirAGrises(im);
+
+        // Flujo óptico: si sigue al cuadro anterior no hace falta extraer ORB
+        bool bFlujo = false;
+        if(mbFlujo)
+        {
+            cv::buildOpticalFlowPyramid(mImGray, mvPiramideFlujo, cv::Size(21,21), 3);
+            bFlujo = RastrearFlujo(timestamp);
+        }
+
+        if(!bFlujo)
+        {
+            // Regiones de interés: si el tracking es bueno, extrae sólo donde se espera ver el mapa local
+            const bool bROI = mbROI && ConstruirMascaraROI(mImGray.size());
+            mCurrentFrame = Frame(mImGray,timestamp,pExtractor,mpORBVocabulary,mK,mDistCoef,bROI? mMascaraROI : cv::Mat());//,mbf,mThDepth);
+            Track();
+        }
+
+        if(mbResetSolicitado)
+        {
+            Reset();
+            return cv::Mat();
+        }
+
+        // La pirámide de esta imagen sirve de anterior para el próximo cuadro, sin reconstruirla
+        if(mbFlujo)
+            mvPiramideFlujoAnterior.swap(mvPiramideFlujo);
+
+        return mCurrentFrame.mTcw.clone();
+    }
+
+    // Pipeline: una etapa extrae el cuadro nuevo mientras la otra rastrea el pendiente.
+    // La extracción no toca el mapa ni el estado de Tracking: sólo lee mK y mDistCoef, que Track no modifica.
+    // El extractor se elige según el estado antes de rastrear el pendiente.
+    const bool bRastrear = mbHayPendiente;
+    if(bRastrear)
+    {
+        mCurrentFrame = std::move(mFramePendiente);
+        mImGray = mImGrayPendiente;
+        mpSystem->imagenEntrada = mImagenPendiente;	// La imagen del cuadro que se rastrea, para keyframes y visualización
+    }
+
+    cv::Mat imGray;
+    Frame frameNuevo;
+    mpPipeline->ParallelFor(2, [&](int etapa){
+    	if(etapa==0){
+    		imGray = ConvertirAGrises(im);
+    		frameNuevo = Frame(imGray,timestamp,pExtractor,mpORBVocabulary,mK,mDistCoef);
+    	} else if(bRastrear)
+    		Track();
+    });
+
+    // Inicialización fallida: se resetea con ambas etapas terminadas, y el cuadro nuevo se descarta
+    // porque su mnId es anterior al reseteo
+    if(mbResetSolicitado)
+    {
+        Reset();
+        return cv::Mat();
+    }
 
-    Track();
+    // Las imágenes se copian porque el invocante puede reutilizar el buffer de im para el próximo cuadro
+    mFramePendiente = std::move(frameNuevo);
+    mImGrayPendiente = imGray.data==im.data? imGray.clone() : imGray;
+    mImagenPendiente = im.clone();
+    mbHayPendiente = true;
 
-    return mCurrentFrame.mTcw.clone();
+    return bRastrear? mCurrentFrame.mTcw.clone() : cv::Mat();
 }
 
 void Tracking::Track()
@@ -276,15 +403,7 @@ void Tracking::Track()
         if(bOK)
         {
             // Update motion model
-            if(!mLastFrame.mTcw.empty())
-            {
-                cv::Mat LastTwc = cv::Mat::eye(4,4,CV_32F);
-                mLastFrame.GetRotationInverse().copyTo(LastTwc.rowRange(0,3).colRange(0,3));
-                mLastFrame.GetCameraCenter().copyTo(LastTwc.rowRange(0,3).col(3));
-                mVelocity = mCurrentFrame.mTcw*LastTwc;
-            }
-            else
-                mVelocity = cv::Mat();
+            ActualizarModeloMovimiento();
 
             mpMapDrawer->SetCurrentCameraPose(mCurrentFrame.mTcw);
 
@@ -348,13 +467,13 @@ void Tracking::MonocularInitialization()
     if(!mpInitializer)
     {
         // Set Reference Frame
-        if(mCurrentFrame.mvKeys.size() > static_cast<size_t>(minMatches))
+        if(mCurrentFrame.GetKeys().size() > static_cast<size_t>(minMatches))
         {
             mInitialFrame = Frame(mCurrentFrame);
             mLastFrame = Frame(mCurrentFrame);
-            mvbPrevMatched.resize(mCurrentFrame.mvKeysUn.size());
-            for(size_t i=0; i<mCurrentFrame.mvKeysUn.size(); i++)
-                mvbPrevMatched[i]=mCurrentFrame.mvKeysUn[i].pt;
+            mvbPrevMatched.resize(mCurrentFrame.GetKeysUn().size());
+            for(size_t i=0; i<mCurrentFrame.GetKeysUn().size(); i++)
+                mvbPrevMatched[i]=mCurrentFrame.GetKeysUn()[i].pt;
 
             if(mpInitializer)
                 delete mpInitializer;
@@ -365,14 +484,14 @@ void Tracking::MonocularInitialization()
 
             return;
         } //else
-        	//cout << "Pocos keypoints en el 1º cuadro: " << mCurrentFrame.mvKeys.size() << endl;
+        	//cout << "Pocos keypoints en el 1º cuadro: " << mCurrentFrame.GetKeys().size() << endl;
     }
     else
     {
         // Try to initialize
-        if((int)mCurrentFrame.mvKeys.size() <= minMatches)
+        if((int)mCurrentFrame.GetKeys().size() <= minMatches)
         {
-            //cout << "Pocos keypoints en el 2º cuadro: " << mCurrentFrame.mvKeys.size() << endl;
+            //cout << "Pocos keypoints en el 2º cuadro: " << mCurrentFrame.GetKeys().size() << endl;
             delete mpInitializer;
             mpInitializer = static_cast<Initializer*>(NULL);
             fill(mvIniMatches.begin(),mvIniMatches.end(),-1);
@@ -476,7 +595,7 @@ void Tracking::CreateInitialMapMonocular()
     if(medianDepth<0 || pKFcur->TrackedMapPoints(1)<100)
     {
         cout << "Wrong initialization, reseting..." << endl;
-        Reset();
+        mbResetSolicitado = true;	// ProcesarImagen resetea al terminar Track
         return;
     }
 
@@ -603,8 +722,8 @@ bool Tracking::TrackWithMotionModel()
 
     fill(mCurrentFrame.mvpMapPoints.begin(),mCurrentFrame.mvpMapPoints.end(),static_cast<MapPoint*>(NULL));
 
-    // Project points seen in previous frame
-    int th=15;
+    // Project points seen in previous frame.  El radio se ajusta según el presupuesto.
+    const float th=15*mControlPresupuesto.FactorRadio();
     int nmatches = matcher.SearchByProjection(mCurrentFrame,mLastFrame,th);
 
     // If few matches, uses a wider window search
@@ -650,6 +769,216 @@ bool Tracking::TrackWithMotionModel()
     return nmatchesMap>=10;
 }
 
+bool Tracking::RastrearFlujo(const double &timestamp)
+{
+    // Mínimo de puntos seguidos e inliers, y fracción de los puntos del cuadro anterior que deben sobrevivir como inliers
+    const int nMinimo = 50;
+    const float fFraccionMinima = 0.7f;
+
+    if(mState!=OK || mbVO || mVelocity.empty() || mvPiramideFlujoAnterior.empty() || Frame::nNextId<mnLastRelocFrameId+2)
+        return false;
+
+    mLastProcessedState=mState;
+
+    // Get Map Mutex -> Map cannot be changed
+    unique_lock<mutex> lock(mpMap->mMutexMapUpdate);
+
+    CheckReplacedInLastFrame();
+
+    // Puntos singulares del cuadro anterior asociados a puntos del mapa
+    mvIndicesFlujo.clear();
+    mvPuntosFlujoAnterior.clear();
+    const vector<cv::KeyPoint> &vKeys = mLastFrame.GetKeys();
+    for(int i=0; i<mLastFrame.N; i++)
+    {
+        MapPoint* pMP = mLastFrame.mvpMapPoints[i];
+        if(pMP && !pMP->isBad())
+        {
+            mvIndicesFlujo.push_back(i);
+            mvPuntosFlujoAnterior.push_back(vKeys[i].pt);
+        }
+    }
+    const int nAnterior = mvIndicesFlujo.size();
+    if(nAnterior<nMinimo)
+        return false;
+
+    // Lucas-Kanade piramidal sobre las imágenes distorsionadas, donde están los puntos singulares
+    cv::calcOpticalFlowPyrLK(mvPiramideFlujoAnterior, mvPiramideFlujo, mvPuntosFlujoAnterior, mvPuntosFlujo,
+    		mvEstadoFlujo, mvErrorFlujo, cv::Size(21,21), 3,
+			cv::TermCriteria(cv::TermCriteria::COUNT+cv::TermCriteria::EPS, 30, 0.01));
+
+    // Descarta los puntos perdidos o que salieron de la imagen, compactando los vectores
+    const float ancho = mImGray.cols, alto = mImGray.rows;
+    int nSeguidos = 0;
+    for(int i=0; i<nAnterior; i++)
+    {
+        const cv::Point2f &p = mvPuntosFlujo[i];
+        if(mvEstadoFlujo[i] && p.x>=0 && p.y>=0 && p.x<ancho && p.y<alto)
+        {
+            mvIndicesFlujo[nSeguidos] = mvIndicesFlujo[i];
+            mvPuntosFlujo[nSeguidos] = p;
+            nSeguidos++;
+        }
+    }
+    if(nSeguidos<nMinimo)
+        return false;
+    mvIndicesFlujo.resize(nSeguidos);
+    mvPuntosFlujo.resize(nSeguidos);
+
+    // Pose inicial según el modelo de movimiento, como en TrackWithMotionModel
+    UpdateLastFrame();
+    Frame frame(mLastFrame, mvIndicesFlujo, mvPuntosFlujo, timestamp);
+    frame.SetPose((cv::Mat)(mVelocity*mLastFrame.mTcw));
+    frame.mpReferenceKF = mpReferenceKF;
+
+    Optimizer::PoseOptimization(&frame);
+
+    // Discard outliers
+    int nInliers = 0;
+    for(int i=0; i<frame.N; i++)
+    {
+        MapPoint* pMP = frame.mvpMapPoints[i];
+        if(!pMP)
+            continue;
+        if(frame.mvbOutlier[i])
+        {
+            frame.mvpMapPoints[i]=static_cast<MapPoint*>(NULL);
+            frame.mvbOutlier[i]=false;
+        }
+        else if(pMP->Observations()>0)
+            nInliers++;
+    }
+
+    // Cae la calidad del flujo: se extraerá ORB
+    if(nInliers<nMinimo || nInliers<fFraccionMinima*nAnterior)
+        return false;
+
+    // Si se necesita un keyframe, se extraerá ORB para crearlo.  El cuadro de flujo se descarta.
+    mCurrentFrame = std::move(frame);
+    mnMatchesInliers = nInliers;
+    if(NeedNewKeyFrame())
+        return false;
+
+    // Tracking bueno: mismas tareas que Track, sin keyframe.
+    // Las estadísticas de los puntos se actualizan como en SearchLocalPoints y TrackLocalMap, para no sesgar el culling.
+    for(int i=0; i<mCurrentFrame.N; i++)
+    {
+        MapPoint* pMP = mCurrentFrame.mvpMapPoints[i];
+        if(pMP)
+        {
+            pMP->IncreaseVisible();
+            pMP->IncreaseFound();
+            pMP->mnLastFrameSeen = mCurrentFrame.mnId;
+        }
+    }
+
+    mpFrameDrawer->Update(this);
+
+    ActualizarModeloMovimiento();
+
+    mpMapDrawer->SetCurrentCameraPose(mCurrentFrame.mTcw);
+
+    mLastFrame = Frame(mCurrentFrame);
+
+    return true;
+}
+
+bool Tracking::ConstruirMascaraROI(const cv::Size &tamano)
+{
+    // Lado del cuadrado alrededor de cada proyección: el extractor activa celdas de 30 píxeles que lo tocan
+    const int radio = 15;
+    // Mínimo de puntos proyectados en la imagen para confiar en la predicción
+    const int nMinimo = 100;
+    // Bloques de la cuota de descubrimiento, y fracción de ellos marcados completos en cada cuadro
+    const int nBloquesX = 8, nBloquesY = 6;
+    const float fCuota = 0.2f;
+    // Por encima de esta fracción de la imagen conviene la pasada única de FAST
+    const float fCoberturaMaxima = 0.7f;
+
+    if(mState!=OK || mVelocity.empty() || mLastFrame.mTcw.empty() || Frame::nNextId<mnLastRelocFrameId+2)
+        return false;
+
+    // Pose predicha por el modelo de movimiento
+    const SE3f Tcw = Converter::toSE3f((cv::Mat)(mVelocity*mLastFrame.mTcw));
+
+    // Puntos del mapa local delante de la cámara predicha
+    mvPuntosCamaraROI.clear();
+    {
+        unique_lock<mutex> lock(mpMap->mMutexMapUpdate);
+        for(MapPoint* pMP : mvpLocalMapPoints)
+        {
+            if(!pMP || pMP->isBad())
+                continue;
+            const Eigen::Vector3f Pc = Tcw*pMP->GetWorldPos3f();
+            if(Pc(2)>0)
+                mvPuntosCamaraROI.push_back(cv::Point3f(Pc(0), Pc(1), Pc(2)));
+        }
+    }
+    if((int)mvPuntosCamaraROI.size()<nMinimo)
+        return false;
+
+    // Proyección con distorsión, a la imagen donde se extrae
+    const cv::Vec3d cero(0,0,0);
+    if(camaraModo == 1)
+        // Fisheye de proyección equidistante, sin coeficientes
+        cv::fisheye::projectPoints(mvPuntosCamaraROI, mvProyeccionesROI, cero, cero, mK, cv::Vec4d(0,0,0,0));
+    else
+        cv::projectPoints(mvPuntosCamaraROI, cero, cero, mK, mDistCoef, mvProyeccionesROI);
+
+    // Cuadrados alrededor de las proyecciones, contando las proyecciones de cada bloque
+    mMascaraROI.create(tamano, CV_8U);
+    mMascaraROI.setTo(0);
+    const cv::Rect imagen(0, 0, tamano.width, tamano.height);
+    const float anchoBloque = (float)tamano.width/nBloquesX, altoBloque = (float)tamano.height/nBloquesY;
+    vector<int> vConteo(nBloquesX*nBloquesY, 0);
+    int nDentro = 0;
+    for(const cv::Point2f &p : mvProyeccionesROI)
+    {
+        if(p.x<0 || p.y<0 || p.x>=tamano.width || p.y>=tamano.height)
+            continue;
+        nDentro++;
+        vConteo[min((int)(p.y/altoBloque), nBloquesY-1)*nBloquesX + min((int)(p.x/anchoBloque), nBloquesX-1)]++;
+        mMascaraROI(cv::Rect(cvRound(p.x)-radio, cvRound(p.y)-radio, 2*radio+1, 2*radio+1) & imagen).setTo(255);
+    }
+    if(nDentro<nMinimo)
+        return false;
+
+    // Cuota de descubrimiento: los bloques menos cubiertos, desempatando con un orden que rota cuadro a cuadro
+    const int nBloques = nBloquesX*nBloquesY;
+    const int rotacion = mnCuadrosROI++ % nBloques;
+    vector<int> vBloques(nBloques);
+    for(int b=0; b<nBloques; b++)
+        vBloques[b] = b;
+    const int nCuota = ceil(fCuota*nBloques);
+    partial_sort(vBloques.begin(), vBloques.begin()+nCuota, vBloques.end(), [&](int a, int b){
+        if(vConteo[a]!=vConteo[b])
+            return vConteo[a]<vConteo[b];
+        return (a-rotacion+nBloques)%nBloques < (b-rotacion+nBloques)%nBloques;
+    });
+    for(int k=0; k<nCuota; k++)
+    {
+        const int b = vBloques[k];
+        const int x0 = (b%nBloquesX)*anchoBloque, y0 = (b/nBloquesX)*altoBloque;
+        const int x1 = (b%nBloquesX+1)*anchoBloque, y1 = (b/nBloquesX+1)*altoBloque;
+        mMascaraROI(cv::Rect(x0, y0, x1-x0, y1-y0) & imagen).setTo(255);
+    }
+
+    return cv::countNonZero(mMascaraROI) < fCoberturaMaxima*tamano.area();
+}
+
+void Tracking::ActualizarModeloMovimiento()
+{
+    if(!mLastFrame.mTcw.empty())
+    {
+        cv::Mat LastTwc = cv::Mat::eye(4,4,CV_32F);
+        mLastFrame.GetRotationInverse().copyTo(LastTwc.rowRange(0,3).colRange(0,3));
+        mLastFrame.GetCameraCenter().copyTo(LastTwc.rowRange(0,3).col(3));
+        mVelocity = mCurrentFrame.mTcw*LastTwc;
+    }
+    else
+        mVelocity = cv::Mat();
+}
+
 bool Tracking::TrackLocalMap()
 {
     // We have an estimation of the camera pose and some map points tracked in the frame.
@@ -795,28 +1124,17 @@ void Tracking::SearchLocalPoints()
         }
     }
 
-    int nToMatch=0;
-
     // Project points in frame and check its visibility
-    for(vector<MapPoint*>::iterator vit=mvpLocalMapPoints.begin(), vend=mvpLocalMapPoints.end(); vit!=vend; vit++)
-    {
-        MapPoint* pMP = *vit;
-        if(pMP->mnLastFrameSeen == mCurrentFrame.mnId)
-            continue;
-        if(pMP->isBad())
-            continue;
-        // Project (this fills MapPoint variables for matching)
-        if(mCurrentFrame.isInFrustum(pMP,0.5))
-        {
-            pMP->IncreaseVisible();
-            nToMatch++;
-        }
-    }
+    // Prueba de frustum por lotes, equivalente a mCurrentFrame.isInFrustum(pMP,0.5) para cada punto
+    mFrustumLocal.Cargar(mvpLocalMapPoints, mCurrentFrame.mnId);
+    const int nToMatch = mFrustumLocal.Proyectar(mCurrentFrame, 0.5);
+    for(MapPoint* pMP : mFrustumLocal.Visibles())
+        pMP->IncreaseVisible();
 
     if(nToMatch>0)
     {
         ORBmatcher matcher(0.8);
-        int th = 1;
+        float th = mControlPresupuesto.FactorRadio();
 
         // If the camera has been relocalised recently, perform a coarser search
         if(mCurrentFrame.mnId<mnLastRelocFrameId+2)
@@ -859,7 +1177,8 @@ void Tracking::UpdateLocalPoints()
 void Tracking::UpdateLocalKeyFrames()
 {
     // Each map point vote for the keyframes in which it has been observed
-    map<KeyFrame*,int> keyframeCounter;
+    ContadorKeyFrames &keyframeCounter = mContadorKF;
+    keyframeCounter.Iniciar();
     for(int i=0; i<mCurrentFrame.N; i++)
     {
         if(mCurrentFrame.mvpMapPoints[i])
@@ -867,9 +1186,9 @@ void Tracking::UpdateLocalKeyFrames()
             MapPoint* pMP = mCurrentFrame.mvpMapPoints[i];
             if(!pMP->isBad())
             {
-                const map<KeyFrame*,size_t> observations = pMP->GetObservations();
-                for(map<KeyFrame*,size_t>::const_iterator it=observations.begin(), itend=observations.end(); it!=itend; it++)
-                    keyframeCounter[it->first]++;
+                pMP->GetKeyFramesObservadores(mvpObservadores);
+                for(KeyFrame* pKFi : mvpObservadores)
+                    keyframeCounter.Incrementar(pKFi);
             }
             else
             {
@@ -885,23 +1204,22 @@ void Tracking::UpdateLocalKeyFrames()
     KeyFrame* pKFmax= static_cast<KeyFrame*>(NULL);
 
     mvpLocalKeyFrames.clear();
-    mvpLocalKeyFrames.reserve(3*keyframeCounter.size());
+    mvpLocalKeyFrames.reserve(3*keyframeCounter.KeyFrames().size());
 
     // All keyframes that observe a map point are included in the local map. Also check which keyframe shares most points
-    for(map<KeyFrame*,int>::const_iterator it=keyframeCounter.begin(), itEnd=keyframeCounter.end(); it!=itEnd; it++)
+    for(KeyFrame* pKF : keyframeCounter.KeyFrames())
     {
-        KeyFrame* pKF = it->first;
-
         if(pKF->isBad())
             continue;
 
-        if(it->second>max)
+        const int votos = keyframeCounter.Valor(pKF);
+        if(votos>max)
         {
-            max=it->second;
+            max=votos;
             pKFmax=pKF;
         }
 
-        mvpLocalKeyFrames.push_back(it->first);
+        mvpLocalKeyFrames.push_back(pKF);
         pKF->mnTrackReferenceForFrame = mCurrentFrame.mnId;
     }
 
@@ -981,142 +1299,121 @@ bool Tracking::Relocalization()
 
     const int nKFs = vpCandidateKFs.size();
 
-    // We perform first an ORB matching with each candidate
-    // If enough matches are found we setup a PnP solver
-    ORBmatcher matcher(0.75,true);
-
-    vector<PnPsolver*> vpPnPsolvers;
-    vpPnPsolvers.resize(nKFs);
+    // Cada candidato es una tarea del pool: macheo BoW, RANSAC PnP y refinamiento de pose sobre su propia copia del cuadro.
+    // La copia comparte los puntos singulares con mCurrentFrame (CaracteristicasFrame), y sólo duplica pose y asociaciones.
+    // El primer candidato que logra 50 inliers gana, y los demás abandonan en su próximo lote de RANSAC.
+    atomic<int> ganador(-1);
+    Frame frameGanador;
 
-    vector<vector<MapPoint*> > vvpMapPointMatches;
-    vvpMapPointMatches.resize(nKFs);
-
-    vector<bool> vbDiscarded;
-    vbDiscarded.resize(nKFs);
-
-    int nCandidates=0;
+    mpPoolRelocalizacion->ParallelFor(nKFs, [&](int i){
+        if(ganador.load()>=0)
+            return;
 
-    for(int i=0; i<nKFs; i++)
-    {
         KeyFrame* pKF = vpCandidateKFs[i];
         if(pKF->isBad())
-            vbDiscarded[i] = true;
-        else
-        {
-            int nmatches = matcher.SearchByBoW(pKF,mCurrentFrame,vvpMapPointMatches[i]);
-            if(nmatches<15)
-            {
-                vbDiscarded[i] = true;
-                continue;
-            }
-            else
-            {
-                PnPsolver* pSolver = new PnPsolver(mCurrentFrame,vvpMapPointMatches[i]);
-                pSolver->SetRansacParameters(0.99,10,300,4,0.5,5.991);
-                vpPnPsolvers[i] = pSolver;
-                nCandidates++;
-            }
-        }
-    }
+            return;
 
-    // Alternatively perform some iterations of P4P RANSAC
-    // Until we found a camera pose supported by enough inliers
-    bool bMatch = false;
-    ORBmatcher matcher2(0.9,true);
+        // We perform first an ORB matching with each candidate
+        // If enough matches are found we setup a PnP solver
+        ORBmatcher matcher(0.75,true);
+        vector<MapPoint*> vpMapPointMatches;
+        int nmatches = matcher.SearchByBoW(pKF,mCurrentFrame,vpMapPointMatches);
+        if(nmatches<15)
+            return;
 
-    while(nCandidates>0 && !bMatch)
-    {
-        for(int i=0; i<nKFs; i++)
-        {
-            if(vbDiscarded[i])
-                continue;
+        PnPsolver solver(mCurrentFrame,vpMapPointMatches);
+        solver.SetRansacParameters(0.99,10,300,4,0.5,5.991);
+
+        Frame F(mCurrentFrame);
+        ORBmatcher matcher2(0.9,true);
 
-            // Perform 5 Ransac Iterations
+        // Perform 5 Ransac Iterations at a time
+        // Until we found a camera pose supported by enough inliers, RANSAC reachs max. iterations or another candidate wins
+        bool bNoMore = false;
+        while(!bNoMore && ganador.load()<0)
+        {
             vector<bool> vbInliers;
             int nInliers;
-            bool bNoMore;
 
-            PnPsolver* pSolver = vpPnPsolvers[i];
-            cv::Mat Tcw = pSolver->iterate(5,bNoMore,vbInliers,nInliers);
-
-            // If Ransac reachs max. iterations discard keyframe
-            if(bNoMore)
-            {
-                vbDiscarded[i]=true;
-                nCandidates--;
-            }
+            cv::Mat Tcw = solver.iterate(5,bNoMore,vbInliers,nInliers);
 
             // If a Camera Pose is computed, optimize
-            if(!Tcw.empty())
-            {
-                Tcw.copyTo(mCurrentFrame.mTcw);
+            if(Tcw.empty())
+                continue;
 
-                set<MapPoint*> sFound;
+            F.SetPose(Tcw);
 
-                const int np = vbInliers.size();
+            set<MapPoint*> sFound;
 
-                for(int j=0; j<np; j++)
+            const int np = vbInliers.size();
+
+            for(int j=0; j<np; j++)
+            {
+                if(vbInliers[j])
                 {
-                    if(vbInliers[j])
-                    {
-                        mCurrentFrame.mvpMapPoints[j]=vvpMapPointMatches[i][j];
-                        sFound.insert(vvpMapPointMatches[i][j]);
-                    }
-                    else
-                        mCurrentFrame.mvpMapPoints[j]=NULL;
+                    F.mvpMapPoints[j]=vpMapPointMatches[j];
+                    sFound.insert(vpMapPointMatches[j]);
                 }
+                else
+                    F.mvpMapPoints[j]=NULL;
+            }
 
-                int nGood = Optimizer::PoseOptimization(&mCurrentFrame);
+            int nGood = Optimizer::PoseOptimization(&F);
 
-                if(nGood<10)
-                    continue;
+            if(nGood<10)
+                continue;
 
-                for(int io =0; io<mCurrentFrame.N; io++)
-                    if(mCurrentFrame.mvbOutlier[io])
-                        mCurrentFrame.mvpMapPoints[io]=static_cast<MapPoint*>(NULL);
+            for(int io =0; io<F.N; io++)
+                if(F.mvbOutlier[io])
+                    F.mvpMapPoints[io]=static_cast<MapPoint*>(NULL);
 
-                // If few inliers, search by projection in a coarse window and optimize again
-                if(nGood<50)
+            // If few inliers, search by projection in a coarse window and optimize again
+            if(nGood<50)
+            {
+                int nadditional =matcher2.SearchByProjection(F,pKF,sFound,10,100);
+
+                if(nadditional+nGood>=50)
                 {
-                    int nadditional =matcher2.SearchByProjection(mCurrentFrame,vpCandidateKFs[i],sFound,10,100);
+                    nGood = Optimizer::PoseOptimization(&F);
 
-                    if(nadditional+nGood>=50)
+                    // If many inliers but still not enough, search by projection again in a narrower window
+                    // the camera has been already optimized with many points
+                    if(nGood>30 && nGood<50)
                     {
-                        nGood = Optimizer::PoseOptimization(&mCurrentFrame);
-
-                        // If many inliers but still not enough, search by projection again in a narrower window
-                        // the camera has been already optimized with many points
-                        if(nGood>30 && nGood<50)
+                        sFound.clear();
+                        for(int ip =0; ip<F.N; ip++)
+                            if(F.mvpMapPoints[ip])
+                                sFound.insert(F.mvpMapPoints[ip]);
+                        nadditional =matcher2.SearchByProjection(F,pKF,sFound,3,64);
+
+                        // Final optimization
+                        if(nGood+nadditional>=50)
                         {
-                            sFound.clear();
-                            for(int ip =0; ip<mCurrentFrame.N; ip++)
-                                if(mCurrentFrame.mvpMapPoints[ip])
-                                    sFound.insert(mCurrentFrame.mvpMapPoints[ip]);
-                            nadditional =matcher2.SearchByProjection(mCurrentFrame,vpCandidateKFs[i],sFound,3,64);
-
-                            // Final optimization
-                            if(nGood+nadditional>=50)
-                            {
-                                nGood = Optimizer::PoseOptimization(&mCurrentFrame);
+                            nGood = Optimizer::PoseOptimization(&F);
 
-                                for(int io =0; io<mCurrentFrame.N; io++)
-                                    if(mCurrentFrame.mvbOutlier[io])
-                                        mCurrentFrame.mvpMapPoints[io]=NULL;
-                            }
+                            for(int io =0; io<F.N; io++)
+                                if(F.mvbOutlier[io])
+                                    F.mvpMapPoints[io]=NULL;
                         }
                     }
                 }
+            }
 
-
-                // If the pose is supported by enough inliers stop ransacs and continue
-                if(nGood>=50)
-                {
-                    bMatch = true;
-                    break;
-                }
+            // If the pose is supported by enough inliers stop ransacs and continue
+            if(nGood>=50)
+            {
+                // Sólo el primero registra su cuadro
+                int nadie = -1;
+                if(ganador.compare_exchange_strong(nadie, i))
+                    frameGanador = F;
+                return;
             }
         }
-    }
+    });
+
+    const bool bMatch = ganador.load()>=0;
+    if(bMatch)
+        mCurrentFrame = frameGanador;
 
     if(!bMatch)
     {
@@ -1159,6 +1456,9 @@ void Tracking::Reset()
     KeyFrame::nNextId = 0;
     Frame::nNextId = 0;
     mState = NO_IMAGES_YET;
+    mbHayPendiente = false;
+    mbResetSolicitado = false;
+    mvPiramideFlujoAnterior.clear();
 
     if(mpInitializer)
     {
@@ -1256,6 +1556,12 @@ void Tracking::ChangeCalibration(const string &strSettingPath)
     mMinFrames = 0;
     mMaxFrames = fps;
 
+    // El cuadro pendiente del pipeline se extrajo con la calibración anterior
+    mbHayPendiente = false;
+
+    // La imagen anterior del flujo óptico puede tener otro tamaño
+    mvPiramideFlujoAnterior.clear();
+
     cout << endl << "Camera Parameters: " << endl;
     cout << "- fx: " << fx << endl;
     cout << "- fy: " << fy << endl;
@@ -1287,6 +1593,7 @@ void Tracking::ChangeCalibration(const string &strSettingPath)
         cout << "- color order: BGR (ignored if grayscale)" << endl;
 
 
+    // El próximo Frame recalcula los límites de la imagen, la grilla y la tabla de antidistorsión con la nueva calibración
     Frame::mbInitialComputations = true;
 }
 
@@ -0,0 +1,109 @@
+/*
+ * VectorBow.cc
+ *
+ *  Created on: 17 oct. 2026
+ *      Author: alejandro
+ */
+
+#include "VectorBow.h"
+#include <cmath>
+
+using namespace std;
+
+namespace ORB_SLAM2{
+
+void VectorBow::Construir(const DBoW2::BowVector &v){
+	mvPalabras.resize(v.size());
+	mvPesos.resize(v.size());
+	size_t i = 0;
+	for(const auto &par : v){
+		mvPalabras[i] = par.first;
+		mvPesos[i] = par.second;
+		i++;
+	}
+}
+
+void VectorBow::Construir(const vector<DBoW2::WordId> &palabras, const vector<DBoW2::WordValue> &pesos){
+	// Ordenar por palabra, y por índice dentro de cada palabra: los pesos se suman en el mismo orden que DBoW2
+	const size_t n = palabras.size();
+	vector<pair<DBoW2::WordId, unsigned int> > orden(n);
+	for(size_t i=0; i<n; i++)
+		orden[i] = make_pair(palabras[i], (unsigned int)i);
+	sort(orden.begin(), orden.end());
+
+	clear();
+	for(size_t i=0; i<n; i++){
+		const DBoW2::WordId palabra = orden[i].first;
+		const DBoW2::WordValue peso = pesos[orden[i].second];
+		if(!mvPalabras.empty() && mvPalabras.back() == palabra)
+			mvPesos.back() += peso;
+		else {
+			mvPalabras.push_back(palabra);
+			mvPesos.push_back(peso);
+		}
+	}
+
+	// Normalización L1
+	double norma = 0;
+	for(size_t i=0; i<mvPesos.size(); i++)
+		norma += fabs(mvPesos[i]);
+	if(norma > 0)
+		for(size_t i=0; i<mvPesos.size(); i++)
+			mvPesos[i] /= norma;
+}
+
+double VectorBow::PuntajeL1(const VectorBow &v, const VectorBow &w){
+	const DBoW2::WordId *pv = v.mvPalabras.data(), *pw = w.mvPalabras.data();
+	const size_t nv = v.size(), nw = w.size();
+
+	double puntaje = 0;
+	size_t i = 0, j = 0;
+	while(i<nv && j<nw){
+		if(pv[i] == pw[j]){
+			const double vi = v.mvPesos[i], wj = w.mvPesos[j];
+			puntaje += fabs(vi - wj) - fabs(vi) - fabs(wj);
+			i++;
+			j++;
+		} else if(pv[i] < pw[j])
+			i++;
+		else
+			j++;
+	}
+
+	return -puntaje/2.0;
+}
+
+void VectorFeatures::Construir(const DBoW2::FeatureVector &fv){
+	mvNodos.resize(fv.size());
+	mvInicio.resize(fv.size()+1);
+	mvIndices.clear();
+	size_t i = 0;
+	for(const auto &par : fv){
+		mvNodos[i] = par.first;
+		mvInicio[i] = mvIndices.size();
+		mvIndices.insert(mvIndices.end(), par.second.begin(), par.second.end());
+		i++;
+	}
+	mvInicio[i] = mvIndices.size();
+}
+
+void VectorFeatures::Construir(const vector<DBoW2::NodeId> &nodos){
+	const size_t n = nodos.size();
+	vector<pair<DBoW2::NodeId, unsigned int> > orden(n);
+	for(size_t i=0; i<n; i++)
+		orden[i] = make_pair(nodos[i], (unsigned int)i);
+	sort(orden.begin(), orden.end());
+
+	clear();
+	mvIndices.resize(n);
+	for(size_t i=0; i<n; i++){
+		if(mvNodos.empty() || mvNodos.back() != orden[i].first){
+			mvNodos.push_back(orden[i].first);
+			mvInicio.push_back(i);
+		}
+		mvIndices[i] = orden[i].second;
+	}
+	mvInicio.push_back(n);
+}
+
+}// namespace ORB_SLAM2
@@ -0,0 +1,92 @@
+/*
+ * WorkerPool.cc
+ *
+ *  Created on: 17 oct. 2026
+ *      Author: alejandro
+ */
+
+#include "WorkerPool.h"
+#include <pthread.h>
+
+using namespace std;
+
+namespace ORB_SLAM2{
+
+WorkerPool::WorkerPool(int nThreads, const string &nombre):
+	mnThreads(nThreads>1? nThreads : 1), mnSiguiente(0)
+{
+	for(int i=1; i<mnThreads; i++){
+		mvThreads.push_back(thread(&WorkerPool::Run, this));
+		pthread_setname_np(mvThreads.back().native_handle(), nombre.substr(0,15).c_str());
+	}
+}
+
+WorkerPool::~WorkerPool(){
+	{
+		unique_lock<mutex> lock(mMutex);
+		mbFinish = true;
+	}
+	mcvLote.notify_all();
+	for(size_t i=0; i<mvThreads.size(); i++)
+		mvThreads[i].join();
+}
+
+void WorkerPool::ParallelFor(int n, const function<void(int)> &tarea){
+	// Un único hilo o una única iteración: no vale la pena despertar a nadie.
+	if(mvThreads.empty() || n<=1){
+		for(int i=0; i<n; i++)
+			tarea(i);
+		return;
+	}
+
+	unique_lock<mutex> lockParallelFor(mMutexParallelFor);
+	{
+		unique_lock<mutex> lock(mMutex);
+		mpTarea = &tarea;
+		mnIteraciones = n;
+		mnSiguiente = 0;
+		mnActivos = mvThreads.size();
+		mnLote++;
+	}
+	mcvLote.notify_all();
+
+	// El invocante también trabaja
+	Work();
+
+	// Espera a que todos los hilos abandonen el lote, antes de que tarea salga de ámbito.
+	unique_lock<mutex> lock(mMutex);
+	while(mnActivos>0)
+		mcvFin.wait(lock);
+	mpTarea = NULL;
+}
+
+void WorkerPool::Work(){
+	const function<void(int)> &tarea = *mpTarea;
+	const int n = mnIteraciones;
+	for(int i = mnSiguiente++; i<n; i = mnSiguiente++)
+		tarea(i);
+}
+
+void WorkerPool::Run(){
+	unsigned long loteVisto = 0;
+	while(true){
+		{
+			unique_lock<mutex> lock(mMutex);
+			while(!mbFinish && mnLote==loteVisto)
+				mcvLote.wait(lock);
+			if(mbFinish)
+				return;
+			loteVisto = mnLote;
+		}
+
+		Work();
+
+		{
+			unique_lock<mutex> lock(mMutex);
+			if(--mnActivos==0)
+				mcvFin.notify_one();
+		}
+	}
+}
+
+}// namespace ORB_SLAM2